@@ -17,13 +17,40 @@ SOURCES += main.cpp\
     mainview.cpp \
     user_input.cpp \
     model.cpp \
-    utility.cpp
+    utility.cpp \
+    texturestreamer.cpp \
+    initgraph.cpp \
+    shadercache.cpp \
+    shaderbuilder.cpp \
+    shaderpermutations.cpp \
+    gpuprofiler.cpp \
+    trace.cpp \
+    alloctracker.cpp \
+    framestats.cpp \
+    statsoverlay.cpp \
+    inputlog.cpp \
+    gldebug.cpp \
+    scenegenerator.cpp
 
 HEADERS  += mainwindow.h \
     mainview.h \
     model.h \
     vertex.h \
-    object.h
+    object.h \
+    texturestreamer.h \
+    initgraph.h \
+    shadercache.h \
+    shaderbuilder.h \
+    shaderpermutations.h \
+    gpuprofiler.h \
+    trace.h \
+    alloctracker.h \
+    framestats.h \
+    statsoverlay.h \
+    inputlog.h \
+    gldebug.h \
+    scenegenerator.h \
+    simulation.h
 
 FORMS    += mainwindow.ui
 
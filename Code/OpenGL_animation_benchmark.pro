@@ -0,0 +1,64 @@
+#-------------------------------------------------
+#
+# Headless frame time benchmark of the animation scene,
+# see benchmark.cpp
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = OpenGL_animation_benchmark
+TEMPLATE = app
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+DEFINES += BENCHMARK_SCENE=\\\"animation\\\"
+
+# Fails the run when a steady-state frame allocates, see alloctracker.h
+DEFINES += ALLOC_TRACKING
+
+# Accepts the scene options of the application, see scenegenerator.h
+DEFINES += SCENE_GENERATOR
+
+SOURCES += benchmark.cpp \
+    mainview.cpp \
+    user_input.cpp \
+    model.cpp \
+    utility.cpp \
+    texturestreamer.cpp \
+    initgraph.cpp \
+    shadercache.cpp \
+    shaderbuilder.cpp \
+    shaderpermutations.cpp \
+    gpuprofiler.cpp \
+    trace.cpp \
+    alloctracker.cpp \
+    framestats.cpp \
+    statsoverlay.cpp \
+    inputlog.cpp \
+    gldebug.cpp \
+    scenegenerator.cpp
+
+HEADERS  += mainview.h \
+    model.h \
+    vertex.h \
+    object.h \
+    texturestreamer.h \
+    initgraph.h \
+    shadercache.h \
+    shaderbuilder.h \
+    shaderpermutations.h \
+    gpuprofiler.h \
+    trace.h \
+    alloctracker.h \
+    framestats.h \
+    statsoverlay.h \
+    inputlog.h \
+    gldebug.h \
+    scenegenerator.h \
+    simulation.h
+
+RESOURCES += \
+    resources.qrc
@@ -0,0 +1,64 @@
+#-------------------------------------------------
+#
+# CPU microbenchmarks of the animation and water scenes,
+# see microbench.cpp
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = OpenGL_animation_microbench
+TEMPLATE = app
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+# Counts allocations per case, see alloctracker.h
+DEFINES += ALLOC_TRACKING
+
+SOURCES += microbench.cpp \
+    mainview.cpp \
+    user_input.cpp \
+    model.cpp \
+    utility.cpp \
+    texturestreamer.cpp \
+    initgraph.cpp \
+    shadercache.cpp \
+    shaderbuilder.cpp \
+    shaderpermutations.cpp \
+    gpuprofiler.cpp \
+    trace.cpp \
+    alloctracker.cpp \
+    framestats.cpp \
+    statsoverlay.cpp \
+    inputlog.cpp \
+    gldebug.cpp \
+    scenegenerator.cpp \
+    watergrid.cpp \
+    sinewaves.cpp
+
+HEADERS  += mainview.h \
+    model.h \
+    vertex.h \
+    object.h \
+    texturestreamer.h \
+    initgraph.h \
+    shadercache.h \
+    shaderbuilder.h \
+    shaderpermutations.h \
+    gpuprofiler.h \
+    trace.h \
+    alloctracker.h \
+    framestats.h \
+    statsoverlay.h \
+    inputlog.h \
+    gldebug.h \
+    scenegenerator.h \
+    simulation.h \
+    watergrid.h \
+    simdmath.h \
+    sinewaves.h
+
+RESOURCES += \
+    resources.qrc
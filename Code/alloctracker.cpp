@@ -0,0 +1,114 @@
+#include "alloctracker.h"
+
+#ifdef ALLOC_TRACKING
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<quint64> processAllocations(0);
+std::atomic<quint64> processBytes(0);
+
+// Plain thread_locals, no constructors, so they are safe inside malloc.
+thread_local quint64 threadAllocations = 0;
+thread_local quint64 threadBytes = 0;
+
+inline void countAllocation(size_t size)
+{
+    processAllocations.fetch_add(1, std::memory_order_relaxed);
+    processBytes.fetch_add(size, std::memory_order_relaxed);
+    ++threadAllocations;
+    threadBytes += size;
+}
+}
+
+#ifdef __GLIBC__
+// operator new ends up in malloc as well. A realloc counts as an
+// allocation, since it usually is one.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept
+{
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+void *operator new(size_t size)
+{
+    countAllocation(size);
+    if (void *pointer = std::malloc(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+bool AllocTracker::isEnabled()
+{
+    return true;
+}
+
+AllocTracker::Counts AllocTracker::process()
+{
+    Counts counts = { processAllocations.load(std::memory_order_relaxed),
+                      processBytes.load(std::memory_order_relaxed) };
+    return counts;
+}
+
+AllocTracker::Counts AllocTracker::thread()
+{
+    Counts counts = { threadAllocations, threadBytes };
+    return counts;
+}
+
+#else
+
+bool AllocTracker::isEnabled()
+{
+    return false;
+}
+
+AllocTracker::Counts AllocTracker::process()
+{
+    Counts counts = { 0, 0 };
+    return counts;
+}
+
+AllocTracker::Counts AllocTracker::thread()
+{
+    Counts counts = { 0, 0 };
+    return counts;
+}
+
+#endif // ALLOC_TRACKING
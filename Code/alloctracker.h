@@ -0,0 +1,52 @@
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <QtGlobal>
+
+/**
+ * @brief The AllocTracker class
+ *
+ * Counts heap allocations, per thread and for the whole process. Opt-in:
+ * the allocation hooks are only compiled in with DEFINES += ALLOC_TRACKING,
+ * otherwise every count stays zero.
+ *
+ * With glibc the hooks sit on malloc, calloc and realloc, which also catches
+ * the Qt containers (they allocate with malloc, not operator new); elsewhere
+ * only global operator new is hooked. The malloc hooks cannot tell the app
+ * from the libraries it calls, so they also count what the GL driver
+ * allocates inside GL calls on the same thread.
+ */
+class AllocTracker
+{
+public:
+    struct Counts
+    {
+        quint64 allocations;
+        quint64 bytes;
+
+        Counts operator-(const Counts &other) const
+        {
+            Counts difference = { allocations - other.allocations, bytes - other.bytes };
+            return difference;
+        }
+    };
+
+    // Counts allocations of the calling thread from construction on.
+    class Scope
+    {
+    public:
+        Scope() : begin(AllocTracker::thread()) {}
+        Counts counts() const { return AllocTracker::thread() - begin; }
+
+    private:
+        Counts begin;
+    };
+
+    static bool isEnabled();
+
+    // Totals since the program started.
+    static Counts process();
+    static Counts thread();
+};
+
+#endif // ALLOCTRACKER_H
@@ -0,0 +1,877 @@
+#include "gldebug.h"
+#include "inputlog.h"
+// A quoted include finds this directory first, so other projects name their own view.
+#ifdef BENCHMARK_MAINVIEW
+#include BENCHMARK_MAINVIEW
+#else
+#include "mainview.h"
+#endif
+#ifdef SCENE_GENERATOR
+#include "scenegenerator.h"
+#endif
+#include "trace.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+// Set per project in the benchmark .pro file.
+#ifndef BENCHMARK_SCENE
+#define BENCHMARK_SCENE "animation"
+#endif
+
+/**
+ * @brief The Benchmark class
+ *
+ * Renders the MainView scene into a framebuffer object on an offscreen
+ * surface, without ever showing a window. Every shading mode gets the same
+ * fixed number of warm-up and measured frames, and the scene only advances
+ * per rendered frame, so every run renders exactly the same frames and the
+ * timings of different commits can be compared directly.
+ *
+ * Built with SCENE_GENERATOR, the scene options of the application select a
+ * generated scene; the layout and object count are part of every result, so
+ * runs over a range of counts can be concatenated into one scaling chart.
+ * Built with WATER_GRID, --grid and --strips select the water grid instead,
+ * --lod a level-of-detail surface of the given extent, --ocean an FFT ocean,
+ * --cpu-waves the grid displaced on the CPU, --waves or --wave-count a
+ * Gerstner wave set, --displacement-pass the grid displaced by transform
+ * feedback, --ripples a ripple simulation, which is kept busy by a drop
+ * every few frames, --boats floating boats and --spray GPU spray particles
+ * thrown off the steep waves. The water results also give
+ * the GPU time per vertex, so runs over a range of wave counts show what
+ * every wave costs. The displacement pass and the water query of the boats
+ * are first checked against WaveSet::displace(); a run whose surface
+ * differs fails. --soak days moves the water clock ahead by that much
+ * uptime, checks the surface there the same way and then measures there.
+ *
+ * Built with ALLOC_TRACKING, it also counts the heap allocations of every
+ * measured paintGL; the steady-state render loop is expected not to allocate.
+ * With glibc this includes what the GL driver allocates inside GL calls on
+ * the render thread, which the code cannot avoid; --allow-allocations lets
+ * such a driver pass.
+ *
+ * Every GL debug tier in glDebugTiers gets its own context and its own set
+ * of runs, so measuring all of them shows the overhead of debug output.
+ *
+ * With an InputLog it instead replays a recorded session once, in its
+ * recorded shading mode, and reports the time of every single frame. Two
+ * replays of the same log render the same frames, so their timings can be
+ * compared frame by frame.
+ */
+class Benchmark
+{
+public:
+    struct Result
+    {
+        QString shading;
+        QString glDebug;
+        QString layout;
+        int objects;
+        quint64 vertices; // per frame, 0 if the scene does not count them
+        int frames;
+        double mean, p50, p90, p99, max; // milliseconds
+        double gpuMean; // milliseconds, from the GPU profiler's frame scope
+        int allocatingFrames; // measured frames in which paintGL allocated
+        quint64 allocations;  // summed over the measured frames
+        quint64 debugMessages; // GL debug messages received while measuring
+    };
+
+    struct FrameTiming
+    {
+        double cpu; // milliseconds, paintGL until glFinish
+        double gpu; // milliseconds, 0 if the profiler had no result
+    };
+
+    Benchmark(int width, int height, int warmupFrames, int frames)
+        : width(width), height(height), warmupFrames(warmupFrames), frames(frames) {}
+
+    bool run(QVector<Result> &results);
+    bool replay(const InputLog &log, QVector<FrameTiming> &timings);
+
+    static QString toCsv(const QVector<Result> &results, const QString &renderer, int width, int height);
+    static QByteArray toJson(const QVector<Result> &results, const QString &renderer, int width, int height);
+    static QString toCsv(const QVector<FrameTiming> &timings);
+    static bool readCsv(const QString &file, QVector<FrameTiming> &timings);
+
+    QString renderer;
+    QVector<GlDebug::Tier> glDebugTiers = { GlDebug::OFF }; // replays use the first
+#ifdef SCENE_GENERATOR
+    SceneGenerator::Config scene;
+#endif
+#ifdef WATER_GRID
+    int gridResolution = 99;
+    bool gridStrips = false;
+    float lodExtent = 0;
+    bool oceanEnabled = false;
+    OceanFft::Config ocean;
+    bool cpuWaves = false;
+    QVector<WaveSet::Wave> waves; // empty for the default sines
+    bool displacementPass = false;
+    bool ripplesEnabled = false;
+    Ripples::Config ripples;
+    bool boatsEnabled = false;
+    Floaters::Config boats;
+    bool sprayEnabled = false;
+    Spray::Config spray;
+    double soakDays = 0;
+#endif
+
+private:
+    bool createContext();
+    void destroyContext();
+    bool runTier(QVector<Result> &results);
+
+    Result measure(MainView &view, QOpenGLFunctions *gl, MainView::ShadingMode shading, const QString &name);
+    static double percentile(const QVector<double> &sorted, double fraction);
+    static double gpuPerVertex(const Result &result);
+#ifdef WATER_GRID
+    static double displacementError(MainView &view, WaterDisplacement &pass, double t);
+    static double cpuWavesError(MainView &view, double t);
+    static double queryError(MainView &view, double t);
+    bool soak(MainView &view);
+    static void dropRipple(MainView &view, int frame);
+#endif
+
+    int width;
+    int height;
+    int warmupFrames;
+    int frames;
+
+    QOffscreenSurface surface;
+    QOpenGLContext *context = nullptr;
+    QOpenGLFunctions *gl = nullptr;
+    QOpenGLFramebufferObject *framebuffer = nullptr;
+};
+
+bool Benchmark::run(QVector<Result> &results)
+{
+    for (GlDebug::Tier tier : glDebugTiers) {
+        GlDebug::setTier(tier);
+        bool passed = createContext() && runTier(results);
+        destroyContext();
+        if (!passed)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Benchmark::runTier
+ *
+ * Builds the view in the current context, verifies it and measures every
+ * shading mode. The view is gone, with its GL objects, when this returns.
+ */
+bool Benchmark::runTier(QVector<Result> &results)
+{
+    MainView view;
+#ifdef SCENE_GENERATOR
+    view.setScene(scene);
+#endif
+#ifdef WATER_GRID
+    view.setGrid(gridResolution, gridStrips);
+    view.setLod(lodExtent);
+    if (oceanEnabled)
+        view.setOcean(ocean);
+    view.setCpuWaves(cpuWaves);
+    if (!waves.isEmpty())
+        view.setWaves(waves);
+    view.setDisplacementPass(displacementPass);
+    if (ripplesEnabled)
+        view.setRipples(ripples);
+    if (boatsEnabled)
+        view.setBoats(boats);
+    if (sprayEnabled)
+        view.setSpray(spray);
+#endif
+    view.resize(width, height);
+    view.initializeGL();
+    view.finishLoading();
+    view.gpuProfiler.setLogInterval(0);
+#ifdef WATER_GRID
+    if (view.displacementPass) {
+        const double tolerance = 1e-3;
+        for (double t : { 0.0, 1.0, 37.5 }) {
+            double error = displacementError(view, view.displacement, t);
+            qDebug() << ":: Displacement pass at t =" << t << "differs by" << error;
+            if (error > tolerance) {
+                qWarning() << ":: The displacement pass differs from WaveSet::displace by more than" << tolerance;
+                return false;
+            }
+        }
+    }
+    if (view.boatsEnabled && !view.oceanEnabled) {
+        const double tolerance = 1e-3;
+        for (double t : { 0.0, 1.0, 37.5 }) {
+            double error = queryError(view, t);
+            qDebug() << ":: Water query at t =" << t << "differs by" << error;
+            if (error > tolerance) {
+                qWarning() << ":: The water query differs from WaveSet::displace by more than" << tolerance;
+                return false;
+            }
+        }
+    }
+    if (soakDays > 0 && !soak(view))
+        return false;
+#endif
+
+    results.append(measure(view, gl, MainView::PHONG, "phong"));
+    results.append(measure(view, gl, MainView::NORMAL, "normal"));
+    results.append(measure(view, gl, MainView::GOURAUD, "gouraud"));
+    return true;
+}
+
+/**
+ * @brief Benchmark::replay
+ *
+ * Renders log.length() frames, applying the recorded input at the ticks it
+ * happened in. GPU times arrive some frames late; they are stored with the
+ * frame they were measured in.
+ */
+bool Benchmark::replay(const InputLog &log, QVector<FrameTiming> &timings)
+{
+    GlDebug::setTier(glDebugTiers.value(0, GlDebug::OFF));
+    if (!createContext()) {
+        destroyContext();
+        return false;
+    }
+
+    {
+        MainView view;
+#ifdef SCENE_GENERATOR
+        view.setScene(scene);
+#endif
+#ifdef WATER_GRID
+        view.setGrid(gridResolution, gridStrips);
+        view.setLod(lodExtent);
+        if (oceanEnabled)
+            view.setOcean(ocean);
+        view.setCpuWaves(cpuWaves);
+        if (!waves.isEmpty())
+            view.setWaves(waves);
+        view.setDisplacementPass(displacementPass);
+        if (ripplesEnabled)
+            view.setRipples(ripples);
+        if (boatsEnabled)
+            view.setBoats(boats);
+        if (sprayEnabled)
+            view.setSpray(spray);
+#endif
+        view.resize(width, height);
+        view.initializeGL();
+        view.finishLoading();
+        view.gpuProfiler.setLogInterval(0);
+
+        timings.fill({ 0, 0 }, log.length());
+        quint64 firstFrame = view.gpuProfiler.currentFrame() + 1;
+        quint64 gpuFrame = view.gpuProfiler.resultFrame();
+        QElapsedTimer timer;
+
+        view.startReplay(&log);
+        for (quint32 frame = 0; frame < log.length(); ++frame) {
+            timer.start();
+            view.paintGL();
+            gl->glFinish();
+            timings[frame].cpu = timer.nsecsElapsed() / 1e6;
+
+            const QVector<GpuProfiler::Timing> &gpuTimes = view.gpuProfiler.results();
+            if (view.gpuProfiler.resultFrame() != gpuFrame && !gpuTimes.isEmpty()) {
+                gpuFrame = view.gpuProfiler.resultFrame();
+                if (gpuFrame >= firstFrame && gpuFrame - firstFrame < log.length())
+                    timings[gpuFrame - firstFrame].gpu = gpuTimes.first().milliseconds;
+            }
+        }
+    }
+
+    destroyContext();
+    return true;
+}
+
+// A new context per run, since a debug context has to be asked for up front.
+bool Benchmark::createContext()
+{
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    GlDebug::configureFormat(format);
+
+    surface.create();
+    context = new QOpenGLContext();
+    context->setFormat(format);
+    if (!context->create() || !context->makeCurrent(&surface)) {
+        qWarning() << ":: Could not create an OpenGL context";
+        return false;
+    }
+
+    gl = context->functions();
+    renderer = reinterpret_cast<const char *>(gl->glGetString(GL_RENDERER));
+    qDebug() << ":: Benchmarking on" << qPrintable(renderer);
+
+    framebuffer = new QOpenGLFramebufferObject(width, height, QOpenGLFramebufferObject::Depth);
+    framebuffer->bind();
+    gl->glViewport(0, 0, width, height);
+    return true;
+}
+
+// Also after a createContext() that failed halfway.
+void Benchmark::destroyContext()
+{
+    if (framebuffer) {
+        framebuffer->release();
+        delete framebuffer;
+        framebuffer = nullptr;
+    }
+    if (context) {
+        context->doneCurrent();
+        delete context;
+        context = nullptr;
+    }
+    gl = nullptr;
+    surface.destroy();
+}
+
+Benchmark::Result Benchmark::measure(MainView &view, QOpenGLFunctions *gl,
+                                     MainView::ShadingMode shading, const QString &name)
+{
+    view.setShadingMode(shading);
+
+    for (int frame = 0; frame < warmupFrames; ++frame) {
+#ifdef WATER_GRID
+        dropRipple(view, frame);
+#endif
+        view.paintGL();
+    }
+    gl->glFinish();
+
+    quint64 debugMessages = view.glDebug.messageCount();
+    QVector<double> times;
+    times.reserve(frames);
+    double gpuTotal = 0;
+    int gpuFrames = 0;
+    int allocatingFrames = 0;
+    quint64 allocations = 0;
+    quint64 gpuFrame = view.gpuProfiler.resultFrame();
+    QElapsedTimer timer;
+    for (int frame = 0; frame < frames; ++frame) {
+#ifdef WATER_GRID
+        dropRipple(view, frame);
+#endif
+        timer.start();
+        view.paintGL();
+        gl->glFinish();
+        times.append(timer.nsecsElapsed() / 1e6);
+
+        if (view.frameAllocations.allocations > 0) {
+            ++allocatingFrames;
+            allocations += view.frameAllocations.allocations;
+        }
+
+        const QVector<GpuProfiler::Timing> &gpuTimes = view.gpuProfiler.results();
+        if (view.gpuProfiler.resultFrame() != gpuFrame && !gpuTimes.isEmpty()) {
+            gpuFrame = view.gpuProfiler.resultFrame();
+            gpuTotal += gpuTimes.first().milliseconds;
+            ++gpuFrames;
+        }
+    }
+
+    Result result;
+    result.shading = name;
+    result.glDebug = GlDebug::tierName(GlDebug::tier());
+    result.debugMessages = view.glDebug.messageCount() - debugMessages;
+#ifdef SCENE_GENERATOR
+    result.layout = SceneGenerator::layoutName(scene.layout);
+    result.objects = view.objects.size();
+    result.vertices = 0;
+#elif defined(WATER_GRID)
+    if (view.lodExtent > 0)
+        result.layout = QString("lod %1 %2 levels").arg(view.lodExtent).arg(view.waterLod.levels());
+    else
+        result.layout = QString("%1x%1 %2").arg(view.gridResolution).arg(view.gridStrips ? "strips" : "triangles");
+    if (view.oceanEnabled)
+        result.layout += QString(" ocean %1").arg(view.ocean.config().size);
+    if (view.cpuWavesEnabled)
+        result.layout += " cpu waves";
+    else if (!view.oceanEnabled)
+        result.layout += QString(" %1 waves").arg(view.waveSet.count());
+    if (view.displacementPass)
+        result.layout += " displacement pass";
+    if (view.ripplesEnabled)
+        result.layout += QString(" ripples %1 %2").arg(view.ripples.config().resolution)
+                                                   .arg(view.ripples.config().gpu ? "gpu" : "cpu");
+    if (view.boatsEnabled)
+        result.layout += QString(" %1 boats").arg(view.boats.bodies().size());
+    if (view.sprayEnabled)
+        result.layout += QString(" spray capacity %1").arg(view.spray.capacity());
+    if (soakDays > 0)
+        result.layout += QString(" after %1 days").arg(soakDays);
+    result.objects = 1;
+    if (view.lodExtent > 0)
+        result.vertices = static_cast<quint64>(view.waterLod.patchCount()) * (WaterLod::patchQuads + 1) * (WaterLod::patchQuads + 1);
+    else
+        result.vertices = static_cast<quint64>(view.gridResolution + 1) * (view.gridResolution + 1);
+#else
+    result.layout = "preset";
+    result.objects = 1;
+    result.vertices = 0;
+#endif
+    result.frames = frames;
+    result.mean = 0;
+    for (double time : times)
+        result.mean += time;
+    result.mean /= qMax(1, frames);
+    result.gpuMean = gpuTotal / qMax(1, gpuFrames);
+    result.allocatingFrames = allocatingFrames;
+    result.allocations = allocations;
+
+    std::sort(times.begin(), times.end());
+    result.p50 = percentile(times, 0.50);
+    result.p90 = percentile(times, 0.90);
+    result.p99 = percentile(times, 0.99);
+    result.max = times.isEmpty() ? 0 : times.last();
+    return result;
+}
+
+// Nearest-rank percentile of an ascending list.
+double Benchmark::percentile(const QVector<double> &sorted, double fraction)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int rank = qBound(0, static_cast<int>(std::ceil(fraction * sorted.size())) - 1, sorted.size() - 1);
+    return sorted[rank];
+}
+
+#ifdef WATER_GRID
+/**
+ * @brief Benchmark::displacementError
+ *
+ * Runs a displacement pass at time t, reads the vertices back and returns
+ * the largest difference of a position or normal component from the double
+ * precision WaveSet::displace() of the undisplaced vertex.
+ */
+double Benchmark::displacementError(MainView &view, WaterDisplacement &pass, double t)
+{
+    view.waveSet.update(t);
+    view.waveSet.bind();
+    pass.update();
+
+    QVector<float> displaced;
+    pass.readBack(displaced);
+    const QVector<float> &rest = view.grid.vertices();
+    double error = 0;
+    for (int idx = 0; idx + 8 <= qMin(displaced.size(), rest.size()); idx += 8) {
+        QVector3D normal;
+        QVector3D position = WaveSet::displace(view.waveSet.waves(), QVector2D(rest[idx], rest[idx + 1]), t, &normal);
+        for (int axis = 0; axis < 3; ++axis) {
+            error = qMax(error, double(qAbs(displaced[idx + axis] - position[axis])));
+            error = qMax(error, double(qAbs(displaced[idx + 3 + axis] - normal[axis])));
+        }
+    }
+    return error;
+}
+
+/**
+ * @brief Benchmark::queryError
+ *
+ * Displaces every grid vertex with the double precision WaveSet::displace()
+ * at time t, queries the water above where it went and returns the largest
+ * difference of the height or a normal component. The ripples are still
+ * flat, so only the waves count.
+ */
+double Benchmark::queryError(MainView &view, double t)
+{
+    const QVector<float> &rest = view.grid.vertices();
+    int count = rest.size() / 8;
+    QVector<QVector3D> positions(count);
+    QVector<QVector3D> normals(count);
+    WaterQuery::Batch batch;
+    batch.resize(count);
+    for (int idx = 0; idx < count; ++idx) {
+        QVector2D point(rest[8 * idx], rest[8 * idx + 1]);
+        positions[idx] = WaveSet::displace(view.waveSet.waves(), point, t, &normals[idx]);
+        batch.x[idx] = positions[idx].x();
+        batch.y[idx] = positions[idx].y();
+    }
+    view.waterQuery.query(batch, t);
+
+    double error = 0;
+    for (int idx = 0; idx < count; ++idx) {
+        error = qMax(error, double(qAbs(batch.height[idx] - positions[idx].z())));
+        error = qMax(error, double(qAbs(batch.normalX[idx] - normals[idx].x())));
+        error = qMax(error, double(qAbs(batch.normalY[idx] - normals[idx].y())));
+        error = qMax(error, double(qAbs(batch.normalZ[idx] - normals[idx].z())));
+    }
+    return error;
+}
+
+// Evaluates the CPU waves at time t against the double precision SineWaves::height().
+double Benchmark::cpuWavesError(MainView &view, double t)
+{
+    view.cpuWaves.evaluate(t);
+    const QVector<float> &vertices = view.cpuWaves.vertices();
+    double error = 0;
+    for (int idx = 0; idx + 8 <= vertices.size(); idx += 8) {
+        double slope;
+        double height = SineWaves::height(view.cpuWaves.waves(), vertices[idx], t, &slope);
+        double length = std::sqrt(slope * slope + 1);
+        error = qMax(error, qAbs(vertices[idx + 2] - height));
+        error = qMax(error, qAbs(vertices[idx + 3] + slope / length));
+        error = qMax(error, qAbs(vertices[idx + 5] - 1 / length));
+    }
+    return error;
+}
+
+/**
+ * @brief Benchmark::soak
+ *
+ * Moves the water clock ahead by soakDays of uptime at 60 frames per
+ * second and checks the surface there as at the start: the wave set through
+ * a displacement pass of its own, the CPU waves and the water query of the
+ * boats against their double precision references. A float clock would be
+ * off by whole waves after a few hours; the wrapped phases are not. The
+ * ocean is not checked, it has no reference.
+ */
+bool Benchmark::soak(MainView &view)
+{
+    const double tolerance = 1e-3;
+    const double perDay = 24 * 3600 * 60 * (2.0 / 60); // t advances 2/60 per frame
+    double start = soakDays * perDay;
+
+    WaterDisplacement probe;
+    bool probing = false;
+    if (!view.oceanEnabled) {
+        ShaderPermutations::Features features = { ShaderPermutations::FALLBACK, false, view.waveSet.count() };
+        features.displace = true;
+        probing = probe.initialize(view.shaderPermutations.vertexShader(features));
+        if (probing)
+            probe.setSource(view.grid.vertexBuffer(), view.grid.vertexCount());
+    }
+
+    bool passed = true;
+    for (double offset : { 0.0, 1.0, 37.5 }) {
+        double t = start + offset;
+        double error = 0;
+        if (probing)
+            error = qMax(error, displacementError(view, probe, t));
+        if (view.cpuWavesEnabled)
+            error = qMax(error, cpuWavesError(view, t));
+        if (view.boatsEnabled && !view.oceanEnabled)
+            error = qMax(error, queryError(view, t));
+        qDebug() << ":: After" << soakDays << "days, at t =" << qPrintable(QString::number(t, 'f', 2))
+                 << "the water differs by" << error;
+        if (error > tolerance) {
+            qWarning() << ":: After" << soakDays << "days the water differs from its reference by more than"
+                       << tolerance;
+            passed = false;
+            break;
+        }
+    }
+    probe.destroy();
+
+    view.t = start;
+    return passed;
+}
+
+// A drop every ten frames, on points spread by the golden angle; the same in every run.
+void Benchmark::dropRipple(MainView &view, int frame)
+{
+    if (!view.ripplesEnabled || frame % 10 != 0)
+        return;
+    int drop = frame / 10;
+    float angle = 2.3999632f * drop;
+    float distance = 0.2f + 0.1f * (drop % 7);
+    view.addImpulse(distance * std::cos(angle), distance * std::sin(angle), -0.03f);
+}
+#endif
+
+// Nanoseconds of GPU frame time per vertex drawn, 0 without a vertex count.
+double Benchmark::gpuPerVertex(const Result &result)
+{
+    return result.vertices > 0 ? result.gpuMean * 1e6 / result.vertices : 0;
+}
+
+QString Benchmark::toCsv(const QVector<Result> &results, const QString &renderer, int width, int height)
+{
+    QString csv;
+    QTextStream out(&csv);
+    out << "scene,layout,objects,shading,gl_debug,renderer,width,height,frames,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+           "gpu_mean_ms,gpu_ns_per_vertex,allocating_frames,allocations,gl_messages\n";
+    for (const Result &result : results) {
+        out << BENCHMARK_SCENE << ',' << result.layout << ',' << result.objects << ','
+            << result.shading << ',' << result.glDebug << ",\"" << renderer << "\","
+            << width << ',' << height << ',' << result.frames << ','
+            << result.mean << ',' << result.p50 << ',' << result.p90 << ','
+            << result.p99 << ',' << result.max << ',' << result.gpuMean << ','
+            << gpuPerVertex(result) << ','
+            << result.allocatingFrames << ',' << result.allocations << ',' << result.debugMessages << '\n';
+    }
+    return csv;
+}
+
+QByteArray Benchmark::toJson(const QVector<Result> &results, const QString &renderer, int width, int height)
+{
+    QJsonArray runs;
+    for (const Result &result : results) {
+        QJsonObject run;
+        run["scene"] = BENCHMARK_SCENE;
+        run["layout"] = result.layout;
+        run["objects"] = result.objects;
+        run["shading"] = result.shading;
+        run["gl_debug"] = result.glDebug;
+        run["frames"] = result.frames;
+        run["mean_ms"] = result.mean;
+        run["p50_ms"] = result.p50;
+        run["p90_ms"] = result.p90;
+        run["p99_ms"] = result.p99;
+        run["max_ms"] = result.max;
+        run["gpu_mean_ms"] = result.gpuMean;
+        run["vertices"] = double(result.vertices);
+        run["gpu_ns_per_vertex"] = gpuPerVertex(result);
+        run["allocating_frames"] = result.allocatingFrames;
+        run["allocations"] = double(result.allocations);
+        run["gl_messages"] = double(result.debugMessages);
+        runs.append(run);
+    }
+
+    QJsonObject root;
+    root["renderer"] = renderer;
+    root["width"] = width;
+    root["height"] = height;
+    root["runs"] = runs;
+    return QJsonDocument(root).toJson();
+}
+
+QString Benchmark::toCsv(const QVector<FrameTiming> &timings)
+{
+    QString csv;
+    QTextStream out(&csv);
+    out << "frame,cpu_ms,gpu_ms\n";
+    for (int frame = 0; frame < timings.size(); ++frame)
+        out << frame << ',' << timings[frame].cpu << ',' << timings[frame].gpu << '\n';
+    return csv;
+}
+
+// Reads the per-frame CSV written by toCsv(const QVector<FrameTiming> &).
+bool Benchmark::readCsv(const QString &file, QVector<FrameTiming> &timings)
+{
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << ":: Could not read" << file;
+        return false;
+    }
+
+    QTextStream stream(&in);
+    stream.readLine(); // header
+    while (!stream.atEnd()) {
+        QStringList fields = stream.readLine().split(',');
+        if (fields.size() != 3)
+            continue;
+        timings.append({ fields[1].toDouble(), fields[2].toDouble() });
+    }
+    return true;
+}
+
+/**
+ * @brief compareFrames
+ *
+ * Reports every frame whose CPU or GPU time exceeds the baseline by more
+ * than threshold (a fraction). Frames that take less than a tenth of a
+ * millisecond in the baseline are too noisy to compare and are skipped.
+ */
+static int compareFrames(const QVector<Benchmark::FrameTiming> &timings,
+                         const QVector<Benchmark::FrameTiming> &baseline, double threshold)
+{
+    if (timings.size() != baseline.size())
+        qWarning() << ":: The baseline has" << baseline.size() << "frames, the replay" << timings.size();
+
+    const double minimum = 0.1;
+    int regressions = 0;
+    for (int frame = 0; frame < qMin(timings.size(), baseline.size()); ++frame) {
+        const Benchmark::FrameTiming &now = timings[frame];
+        const Benchmark::FrameTiming &then = baseline[frame];
+        bool cpu = then.cpu >= minimum && now.cpu > then.cpu * (1 + threshold);
+        bool gpu = then.gpu >= minimum && now.gpu > then.gpu * (1 + threshold);
+        if (cpu || gpu) {
+            qWarning().nospace() << ":: Frame " << frame << " regressed: cpu " << then.cpu << " -> " << now.cpu
+                                 << " ms, gpu " << then.gpu << " -> " << now.gpu << " ms";
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    // Without a display, fall back to the offscreen platform plugin; software
+    // rendering is forced through Mesa's llvmpipe unless --hardware is given.
+    bool hardware = false;
+    for (int i = 1; i < argc; ++i)
+        hardware = hardware || qstrcmp(argv[i], "--hardware") == 0;
+    if (!hardware) {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+        qputenv("GALLIUM_DRIVER", "llvmpipe");
+    }
+    if (qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless frame time benchmark of the " BENCHMARK_SCENE " scene");
+    parser.addHelpOption();
+    QCommandLineOption hardwareOption("hardware", "Use the default GL driver instead of llvmpipe.");
+    QCommandLineOption framesOption("frames", "Measured frames per shading mode.", "count", "300");
+    QCommandLineOption warmupOption("warmup", "Unmeasured frames per shading mode.", "count", "30");
+    QCommandLineOption sizeOption("size", "Framebuffer size.", "WxH", "1280x720");
+    QCommandLineOption formatOption("format", "Output format, csv or json.", "format", "csv");
+    QCommandLineOption outputOption("output", "Write results to a file instead of stdout.", "file");
+    QCommandLineOption allocationsOption("allow-allocations", "Do not fail when paintGL allocates. With glibc the "
+                                         "count includes the GL driver's own allocations inside GL calls.");
+    QCommandLineOption traceOption("trace", "Record a Chrome trace of the run and write it to file.", "file");
+    QCommandLineOption replayOption("replay", "Replay a recorded input log and report per-frame CSV times; "
+                                    "the size defaults to the recorded viewport.", "file");
+    QCommandLineOption baselineOption("baseline", "Compare the replay frame by frame against an earlier "
+                                      "replay's output.", "file");
+    QCommandLineOption thresholdOption("threshold", "Slowdown per frame that counts as a regression, in percent.",
+                                       "percent", "20");
+    QCommandLineOption glDebugOption("gl-debug", "GL debug tiers to measure, comma separated (off, async, sync), "
+                                     "or all to compare their overhead.", "tiers", "off");
+    parser.addOptions({ hardwareOption, framesOption, warmupOption, sizeOption, formatOption, outputOption,
+                        allocationsOption, traceOption, replayOption, baselineOption, thresholdOption,
+                        glDebugOption });
+#ifdef SCENE_GENERATOR
+    SceneGenerator::addOptions(parser);
+#endif
+#ifdef WATER_GRID
+    parser.addOption({ "grid", "Quads per side of the water grid.", "resolution", "99" });
+    parser.addOption({ "strips", "Draw the water grid as triangle strips with primitive restart." });
+    parser.addOption({ "lod", "Draw a level-of-detail water surface over [-extent, extent] instead of the grid.", "extent" });
+    OceanFft::addOptions(parser);
+    parser.addOption({ "cpu-waves", "Displace the water grid on the CPU and stream it every frame." });
+    WaveSet::addOptions(parser);
+    parser.addOption({ "displacement-pass", "Displace the water grid once per frame with transform feedback." });
+    Ripples::addOptions(parser);
+    Floaters::addOptions(parser);
+    Spray::addOptions(parser);
+    parser.addOption({ "soak", "Check and measure the water after this many days of uptime.", "days" });
+#endif
+    parser.process(app);
+    Trace::setEnabled(parser.isSet(traceOption));
+
+    InputLog inputLog;
+    if (parser.isSet(replayOption) && !inputLog.load(parser.value(replayOption)))
+        return 2;
+
+    QStringList size = parser.value(sizeOption).split('x');
+    if (parser.isSet(replayOption) && !parser.isSet(sizeOption) && !inputLog.viewport().isEmpty())
+        size = QStringList({ QString::number(inputLog.viewport().width()),
+                             QString::number(inputLog.viewport().height()) });
+    int width = size.value(0).toInt();
+    int height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        qWarning() << ":: Invalid size" << parser.value(sizeOption);
+        return 2;
+    }
+
+    // Same format as the application, see main.cpp.
+    QSurfaceFormat glFormat;
+    glFormat.setProfile(QSurfaceFormat::CoreProfile);
+    glFormat.setVersion(3, 3);
+    glFormat.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(glFormat);
+
+    Benchmark benchmark(width, height, parser.value(warmupOption).toInt(), parser.value(framesOption).toInt());
+#ifdef SCENE_GENERATOR
+    if (!SceneGenerator::configure(parser, benchmark.scene))
+        return 2;
+#endif
+#ifdef WATER_GRID
+    benchmark.gridResolution = parser.value("grid").toInt();
+    benchmark.gridStrips = parser.isSet("strips");
+    benchmark.lodExtent = parser.value("lod").toFloat();
+    if (!OceanFft::configure(parser, benchmark.ocean))
+        return 2;
+    benchmark.oceanEnabled = parser.isSet("ocean");
+    benchmark.cpuWaves = parser.isSet("cpu-waves");
+    if (!WaveSet::configure(parser, benchmark.waves))
+        return 2;
+    benchmark.displacementPass = parser.isSet("displacement-pass");
+    if (!Ripples::configure(parser, benchmark.ripples))
+        return 2;
+    benchmark.ripplesEnabled = parser.isSet("ripples");
+    if (!Floaters::configure(parser, benchmark.boats))
+        return 2;
+    benchmark.boatsEnabled = parser.isSet("boats");
+    if (!Spray::configure(parser, benchmark.spray))
+        return 2;
+    benchmark.sprayEnabled = parser.isSet("spray");
+    benchmark.soakDays = parser.value("soak").toDouble();
+#endif
+
+    QString tiers = parser.value(glDebugOption) == "all" ? "off,async,sync" : parser.value(glDebugOption);
+    benchmark.glDebugTiers.clear();
+    for (const QString &name : tiers.split(',')) {
+        GlDebug::Tier tier;
+        if (!GlDebug::parseTier(name, tier))
+            return 2;
+        benchmark.glDebugTiers.append(tier);
+    }
+    QVector<Benchmark::Result> results;
+    QVector<Benchmark::FrameTiming> timings;
+    bool replaying = parser.isSet(replayOption);
+    if (replaying ? !benchmark.replay(inputLog, timings) : !benchmark.run(results))
+        return 1;
+    if (parser.isSet(traceOption))
+        Trace::writeChromeJson(parser.value(traceOption));
+
+    QByteArray report;
+    if (replaying)
+        report = Benchmark::toCsv(timings).toUtf8();
+    else if (parser.value(formatOption) == "json")
+        report = Benchmark::toJson(results, benchmark.renderer, width, height);
+    else
+        report = Benchmark::toCsv(results, benchmark.renderer, width, height).toUtf8();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << ":: Could not write" << file.fileName();
+            return 1;
+        }
+        file.write(report);
+    } else {
+        QTextStream(stdout) << report;
+    }
+
+    if (replaying && parser.isSet(baselineOption)) {
+        QVector<Benchmark::FrameTiming> baseline;
+        if (!Benchmark::readCsv(parser.value(baselineOption), baseline))
+            return 2;
+        int regressions = compareFrames(timings, baseline, parser.value(thresholdOption).toDouble() / 100);
+        if (regressions > 0) {
+            qWarning() << ":: Replay regressed in" << regressions << "of" << timings.size() << "frames";
+            return 4;
+        }
+    }
+
+    // Keep the render loop allocation-free.
+    for (const Benchmark::Result &result : results) {
+        // Printing debug messages allocates; only a quiet run has to be clean.
+        if (result.allocatingFrames > 0 && result.debugMessages == 0 && !parser.isSet(allocationsOption)) {
+            qWarning() << ":: paintGL allocated in" << result.allocatingFrames << "of" << result.frames
+                       << "steady-state frames with" << qPrintable(result.shading) << "shading"
+                       << "(" << result.allocations << "allocations )";
+            return 3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "floaters.h"
+
+#include "trace.h"
+
+#include <QDebug>
+#include <cmath>
+#include <random>
+
+namespace {
+using Simulation::uniform;
+}
+
+Floaters::Floaters()
+{
+}
+
+void Floaters::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "boats", "Float count boats on the water.", "count" },
+        { "boat-seed", "Seed of the boat placement.", "seed" }
+    });
+}
+
+bool Floaters::configure(const QCommandLineParser &parser, Config &config)
+{
+    if (parser.isSet("boats"))
+        config.count = parser.value("boats").toInt();
+    if (parser.isSet("boat-seed"))
+        config.seed = parser.value("boat-seed").toUInt();
+
+    if (config.count < 1 || config.count > maxCount) {
+        qWarning() << ":: The boat count must be between 1 and" << maxCount;
+        return false;
+    }
+    return true;
+}
+
+void Floaters::initialize(const Config &config)
+{
+    settings = config;
+    std::mt19937 rng(settings.seed);
+
+    // Centred at the depth they float at on flat water.
+    list.resize(settings.count);
+    for (Body &body : list) {
+        body.position = QVector3D(uniform(rng, -settings.extent, settings.extent),
+                                  uniform(rng, -settings.extent, settings.extent),
+                                  (0.5f - settings.density) * settings.height);
+        body.heading = uniform(rng, 0, 360);
+        body.velocity = 0;
+        body.orientation = QQuaternion::fromAxisAndAngle(0, 0, 1, body.heading);
+    }
+
+    hull.resize(0);
+    for (int row = 0; row < samplesPerSide; ++row) {
+        for (int column = 0; column < samplesPerSide; ++column) {
+            hull.append(QVector3D(((column + 0.5f) / samplesPerSide - 0.5f) * settings.length,
+                                  ((row + 0.5f) / samplesPerSide - 0.5f) * settings.width,
+                                  -0.5f * settings.height));
+        }
+    }
+    batch.resize(list.size() * hull.size());
+    keel.resize(batch.size());
+    clock.reset();
+
+    qDebug() << ":: Floaters:" << list.size() << "bodies," << batch.size() << "water samples";
+}
+
+/**
+ * @brief Floaters::update
+ *
+ * Semi-implicit Euler on the height: the velocity takes the acceleration
+ * first, the position the new velocity, which stays stable for the stiff
+ * springs of light and shallow hulls.
+ */
+void Floaters::update(WaterQuery &water, double t)
+{
+    TRACE_SCOPE("floaters");
+    float dt = clock.advance(t);
+    if (dt <= 0)
+        return;
+
+    int idx = 0;
+    for (const Body &body : list) {
+        for (const QVector3D &sample : hull) {
+            QVector3D point = body.position + body.orientation.rotatedVector(sample);
+            batch.x[idx] = point.x();
+            batch.y[idx] = point.y();
+            keel[idx] = point.z();
+            ++idx;
+        }
+    }
+
+    water.query(batch, t);
+
+    idx = 0;
+    for (Body &body : list) {
+        float submerged = 0;
+        QVector3D normal;
+        for (int sample = 0; sample < hull.size(); ++sample, ++idx) {
+            submerged += qBound(0.0f, (batch.height[idx] - keel[idx]) / settings.height, 1.0f);
+            normal += QVector3D(batch.normalX[idx], batch.normalY[idx], batch.normalZ[idx]);
+        }
+        submerged /= hull.size();
+
+        float acceleration = Simulation::gravity * (submerged / settings.density - 1) - settings.damping * body.velocity;
+        body.velocity += acceleration * dt;
+        body.position.setZ(body.position.z() + body.velocity * dt);
+
+        QQuaternion level = QQuaternion::rotationTo(QVector3D(0, 0, 1), normal.normalized());
+        QQuaternion target = level * QQuaternion::fromAxisAndAngle(0, 0, 1, body.heading);
+        body.orientation = QQuaternion::slerp(body.orientation, target, 1 - std::exp(-settings.righting * dt));
+    }
+}
+
+const Floaters::Config &Floaters::config() const
+{
+    return settings;
+}
+
+const QVector<Floaters::Body> &Floaters::bodies() const
+{
+    return list;
+}
+
+QMatrix4x4 Floaters::transform(int body) const
+{
+    QMatrix4x4 matrix;
+    matrix.translate(list[body].position);
+    matrix.rotate(list[body].orientation);
+    return matrix;
+}
+
+int Floaters::samples() const
+{
+    return batch.size();
+}
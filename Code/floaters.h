@@ -0,0 +1,83 @@
+#ifndef FLOATERS_H
+#define FLOATERS_H
+
+#include "simulation.h"
+#include "waterquery.h"
+
+#include <QCommandLineParser>
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector>
+#include <QVector3D>
+
+/**
+ * @brief The Floaters class
+ *
+ * Boats and debris riding the water. Every body is a box of hull samples,
+ * samplesPerSide x samplesPerSide over its length and width, and the
+ * samples of all bodies go to the WaterQuery as one batch per update().
+ *
+ * Each sample of the keel is submerged by the water above it, clamped to
+ * the hull height. Buoyancy is proportional to the mean submerged fraction
+ * and balances gravity when that fraction is the density; the vertical
+ * velocity is damped so that bodies settle instead of bouncing. The deck
+ * turns towards the mean normal of the samples, at a rate rather than at
+ * once, so small ripples do not make it shiver.
+ *
+ * Bodies anchor where initialize() placed them; only height and tilt move.
+ * Time running backwards or standing still leaves them as they are.
+ */
+class Floaters
+{
+public:
+    struct Config
+    {
+        int count = 8;
+        float length = 0.16f;   // grid units, along the heading
+        float width = 0.06f;    // grid units
+        float height = 0.04f;   // grid units, keel to deck
+        float density = 0.4f;   // submerged fraction at rest
+        float damping = 3;      // of the vertical velocity, per unit of t
+        float righting = 4;     // rate the deck follows the water, per unit of t
+        float extent = 0.8f;    // bodies are placed in [-extent, extent]
+        quint32 seed = 1;
+    };
+
+    struct Body
+    {
+        QVector3D position;     // grid units, the centre of the hull
+        float heading;          // degrees around z
+        float velocity;         // vertical, grid units per unit of t
+        QQuaternion orientation;
+    };
+
+    static const int samplesPerSide = 4;
+    static const int maxCount = 4096;
+
+    Floaters();
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills config from the options added by addOptions().
+    static bool configure(const QCommandLineParser &parser, Config &config);
+
+    void initialize(const Config &config);
+    // Samples the water at time t and moves the bodies by the time since the last update.
+    void update(WaterQuery &water, double t);
+
+    const Config &config() const;
+    const QVector<Body> &bodies() const;
+    // From hull space, x along the length and z up, to the grid.
+    QMatrix4x4 transform(int body) const;
+    // Water samples per update.
+    int samples() const;
+
+private:
+    Config settings;
+    QVector<Body> list;
+    QVector<QVector3D> hull; // sample offsets on the keel, in hull space
+    WaterQuery::Batch batch;
+    QVector<float> keel;     // height of every sample, in batch order
+    Simulation::StepClock clock;
+};
+
+#endif // FLOATERS_H
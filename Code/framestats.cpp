@@ -0,0 +1,14 @@
+#include "framestats.h"
+
+void FrameStats::beginFrame()
+{
+    counters = FrameCounters();
+    cpuTimer.start();
+}
+
+void FrameStats::endFrame(double gpuMilliseconds)
+{
+    counters.cpuMilliseconds = cpuTimer.nsecsElapsed() / 1e6;
+    counters.gpuMilliseconds = gpuMilliseconds;
+    previous = counters;
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/**
+ * @brief The FrameCounters struct
+ *
+ * What one frame submitted. Byte counts are what the CPU handed to GL.
+ */
+struct FrameCounters
+{
+    quint32 drawCalls = 0;
+    quint64 triangles = 0;
+    quint32 stateChanges = 0;  // program, VAO and texture binds
+    quint64 uniformBytes = 0;
+    quint64 bufferBytes = 0;   // vertex data uploaded
+    quint64 textureBytes = 0;  // texel data uploaded
+    quint32 culledObjects = 0;
+    quint32 particles = 0;              // alive on the GPU, counted a few steps late
+    quint32 particleCapacity = 0;       // simulated on the GPU, alive or not
+    double simulationMilliseconds = 0;  // GPU time of their step, as late as gpuMilliseconds
+    double cpuMilliseconds = 0;
+    double gpuMilliseconds = 0; // of a frame a few frames back, see GpuProfiler
+};
+
+/**
+ * @brief The FrameStats class
+ *
+ * Collects FrameCounters while a frame is being rendered. Render code adds
+ * to current(); last() holds the counters of the previous complete frame
+ * and is what should be queried or displayed.
+ */
+class FrameStats
+{
+public:
+    void beginFrame();
+    void endFrame(double gpuMilliseconds);
+
+    FrameCounters &current() { return counters; }
+    const FrameCounters &last() const { return previous; }
+
+    void addDraw(quint64 triangles) { ++counters.drawCalls; counters.triangles += triangles; }
+    void addStateChange() { ++counters.stateChanges; }
+    void addUniformBytes(quint64 bytes) { counters.uniformBytes += bytes; }
+    // Counts an upload to location only if the program has it; GL ignores location -1.
+    void addUniformBytes(int location, quint64 bytes) { if (location != -1) counters.uniformBytes += bytes; }
+
+private:
+    FrameCounters counters;
+    FrameCounters previous;
+    QElapsedTimer cpuTimer;
+};
+
+#endif // FRAMESTATS_H
@@ -0,0 +1,160 @@
+#include "gldebug.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+namespace {
+GlDebug::Tier currentTier = GlDebug::defaultTier();
+}
+
+void GlDebug::setTier(Tier tier)
+{
+    currentTier = tier;
+}
+
+GlDebug::Tier GlDebug::tier()
+{
+    return currentTier;
+}
+
+GlDebug::Tier GlDebug::defaultTier()
+{
+#ifdef QT_NO_DEBUG
+    return OFF;
+#else
+    return ASYNC;
+#endif
+}
+
+bool GlDebug::parseTier(const QString &name, Tier &tier)
+{
+    for (Tier candidate : { OFF, ASYNC, SYNC }) {
+        if (name == tierName(candidate)) {
+            tier = candidate;
+            return true;
+        }
+    }
+    qWarning() << ":: Unknown GL debug tier" << name << "(off, async or sync)";
+    return false;
+}
+
+QString GlDebug::tierName(Tier tier)
+{
+    switch (tier) {
+    case OFF: return "off";
+    case ASYNC: return "async";
+    case SYNC: return "sync";
+    }
+    return QString();
+}
+
+void GlDebug::configureFormat(QSurfaceFormat &format)
+{
+    format.setOption(QSurfaceFormat::DebugContext, currentTier != OFF);
+}
+
+GlDebug::GlDebug()
+{
+}
+
+void GlDebug::initialize()
+{
+    if (currentTier == OFF)
+        return;
+
+    logger = new QOpenGLDebugLogger();
+    connect(logger, SIGNAL(messageLogged(QOpenGLDebugMessage)),
+            this, SLOT(onMessageLogged(QOpenGLDebugMessage)), Qt::DirectConnection);
+
+    if (!logger->initialize()) {
+        qWarning() << ":: GL debug output is not available";
+        delete logger;
+        logger = nullptr;
+        return;
+    }
+
+    if (currentTier == SYNC) {
+        logger->startLogging(QOpenGLDebugLogger::SynchronousLogging);
+        logger->enableMessages();
+    } else {
+        logger->startLogging(QOpenGLDebugLogger::AsynchronousLogging);
+        logger->disableMessages(QOpenGLDebugMessage::AnySource, QOpenGLDebugMessage::AnyType,
+                                QOpenGLDebugMessage::LowSeverity | QOpenGLDebugMessage::NotificationSeverity);
+    }
+    // Trace scopes push debug groups every frame.
+    logger->disableMessages(QOpenGLDebugMessage::AnySource,
+                            QOpenGLDebugMessage::GroupPushType | QOpenGLDebugMessage::GroupPopType);
+
+    window.start();
+    qDebug() << ":: GL debug output:" << qPrintable(tierName(currentTier));
+}
+
+void GlDebug::destroy()
+{
+    if (!logger)
+        return;
+
+    logger->stopLogging();
+    delete logger;
+    logger = nullptr;
+
+    QMutexLocker lock(&mutex);
+    reportSuppressed();
+}
+
+quint64 GlDebug::messageCount() const
+{
+    QMutexLocker lock(&mutex);
+    return messages;
+}
+
+quint64 GlDebug::suppressedCount() const
+{
+    QMutexLocker lock(&mutex);
+    return suppressed;
+}
+
+/**
+ * @brief GlDebug::onMessageLogged
+ *
+ * Synchronous logging prints everything. Otherwise a message is printed the
+ * first time it is seen, unless maxMessagesPerSecond were already printed in
+ * the current second; the rest is counted and summarised once per second.
+ */
+void GlDebug::onMessageLogged(const QOpenGLDebugMessage &message)
+{
+    QMutexLocker lock(&mutex);
+    ++messages;
+
+    if (currentTier == SYNC) {
+        qDebug() << " → Log:" << message;
+        return;
+    }
+
+    if (window.elapsed() >= 1000) {
+        reportSuppressed();
+        window.start();
+        windowMessages = 0;
+    }
+
+    quint64 key = (quint64(message.source()) << 48) ^ (quint64(message.type()) << 32) ^ message.id();
+    quint32 &seen = repeats[key];
+    if (seen++ > 0 || windowMessages >= maxMessagesPerSecond) {
+        ++suppressed;
+        return;
+    }
+
+    ++windowMessages;
+    qDebug() << " → Log:" << message;
+}
+
+// --- Helpers
+
+// Must be called with the mutex held.
+void GlDebug::reportSuppressed()
+{
+    if (suppressed == reportedSuppressed)
+        return;
+    qDebug() << ":: GL debug: suppressed" << suppressed - reportedSuppressed << "repeated or excess messages";
+    reportedSuppressed = suppressed;
+}
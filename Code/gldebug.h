@@ -0,0 +1,73 @@
+#ifndef GLDEBUG_H
+#define GLDEBUG_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QOpenGLDebugLogger>
+#include <QSurfaceFormat>
+
+/**
+ * @brief The GlDebug class
+ *
+ * GL debug output in three tiers, chosen once per process with setTier():
+ *
+ *   off    no debug context at all, so the driver does no extra checking
+ *   async  asynchronous logging of high and medium severity messages; every
+ *          message is logged once, repeats are only counted, and at most
+ *          maxMessagesPerSecond distinct messages are printed
+ *   sync   synchronous logging of everything, in call order, for debugging
+ *
+ * Release builds default to off, debug builds to async. Asynchronous
+ * messages may arrive on a driver thread, so the filter takes a lock.
+ *
+ * initialize() and destroy() must be called with the GL context current.
+ */
+class GlDebug : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Tier
+    {
+        OFF = 0, ASYNC, SYNC
+    };
+
+    static const int maxMessagesPerSecond = 20;
+
+    static void setTier(Tier tier);
+    static Tier tier();
+    static Tier defaultTier();
+    static bool parseTier(const QString &name, Tier &tier);
+    static QString tierName(Tier tier);
+
+    // Requests a debug context only for the tiers that log.
+    static void configureFormat(QSurfaceFormat &format);
+
+    GlDebug();
+
+    void initialize();
+    void destroy();
+
+    quint64 messageCount() const;    // received, after the severity filter
+    quint64 suppressedCount() const; // repeats and rate-limited messages
+
+private slots:
+    void onMessageLogged(const QOpenGLDebugMessage &message);
+
+private:
+    void reportSuppressed();
+
+    QOpenGLDebugLogger *logger = nullptr;
+
+    mutable QMutex mutex;
+    QHash<quint64, quint32> repeats; // by source, type and id
+    QElapsedTimer window;
+    int windowMessages = 0;
+    quint64 messages = 0;
+    quint64 suppressed = 0;
+    quint64 reportedSuppressed = 0;
+};
+
+#endif // GLDEBUG_H
@@ -0,0 +1,220 @@
+#include "gpuprofiler.h"
+
+#include <QDebug>
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+/**
+ * @brief GpuProfiler::initialize
+ *
+ * @param latency Number of frames recorded before the first is read back.
+ * @param maxScopes Scopes per frame, further scopes are not measured.
+ */
+void GpuProfiler::initialize(int latency, int maxScopes)
+{
+    initializeOpenGLFunctions();
+
+    this->maxScopes = maxScopes;
+    frames.resize(qMax(2, latency));
+    for (Frame &frame : frames) {
+        frame.queries.resize(2 * maxScopes);
+        glGenQueries(frame.queries.size(), frame.queries.data());
+        frame.records.reserve(maxScopes);
+        frame.queriesUsed = 0;
+        frame.number = 0;
+        frame.pending = false;
+    }
+    openScopes.reserve(maxScopes);
+    latest.reserve(maxScopes);
+    averages.reserve(maxScopes);
+    averageStack.reserve(maxScopes);
+    initialized = true;
+}
+
+void GpuProfiler::destroy()
+{
+    if (!initialized)
+        return;
+
+    for (Frame &frame : frames)
+        glDeleteQueries(frame.queries.size(), frame.queries.data());
+    frames.clear();
+    initialized = false;
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (!initialized)
+        return;
+
+    current = (current + 1) % frames.size();
+    Frame &frame = frames[current];
+    if (frame.pending)
+        readBack(frame);
+
+    // resize(0) keeps the reserved capacity, clear() would free it.
+    frame.records.resize(0);
+    frame.queriesUsed = 0;
+    frame.number = ++frameNumber;
+    frame.pending = true;
+    openScopes.resize(0);
+
+    begin("frame");
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!initialized)
+        return;
+
+    // Close whatever was left open, including the frame scope.
+    while (!openScopes.isEmpty())
+        end();
+}
+
+void GpuProfiler::begin(const char *name)
+{
+    if (!initialized)
+        return;
+
+    Frame &frame = frames[current];
+    Record record = { name, openScopes.size(), -1, -1 };
+    if (frame.queriesUsed + 2 <= frame.queries.size() && frame.records.size() < maxScopes) {
+        record.beginQuery = frame.queriesUsed++;
+        glQueryCounter(frame.queries[record.beginQuery], GL_TIMESTAMP);
+    } else {
+        ++overflowedScopes;
+    }
+    openScopes.append(frame.records.size());
+    frame.records.append(record);
+}
+
+void GpuProfiler::end()
+{
+    if (!initialized || openScopes.isEmpty())
+        return;
+
+    Frame &frame = frames[current];
+    Record &record = frame.records[openScopes.takeLast()];
+    if (record.beginQuery >= 0) {
+        record.endQuery = frame.queriesUsed++;
+        glQueryCounter(frame.queries[record.endQuery], GL_TIMESTAMP);
+    }
+}
+
+const QVector<GpuProfiler::Timing> &GpuProfiler::results() const
+{
+    return latest;
+}
+
+double GpuProfiler::milliseconds(const char *name) const
+{
+    for (const Timing &timing : latest) {
+        if (qstrcmp(timing.name, name) == 0)
+            return timing.milliseconds;
+    }
+    return 0;
+}
+
+quint64 GpuProfiler::resultFrame() const
+{
+    return latestFrame;
+}
+
+quint64 GpuProfiler::currentFrame() const
+{
+    return frameNumber;
+}
+
+void GpuProfiler::setLogInterval(int frames)
+{
+    logInterval = frames;
+}
+
+// --- Helpers
+
+/**
+ * @brief GpuProfiler::readBack
+ *
+ * Reads the timestamps of a frame recorded one ring length ago. Queries
+ * complete in order, so only the last one has to be checked.
+ */
+void GpuProfiler::readBack(Frame &frame)
+{
+    frame.pending = false;
+    if (frame.queriesUsed == 0)
+        return;
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(frame.queries[frame.queriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        ++droppedFrames;
+        return;
+    }
+
+    latest.resize(0);
+    for (const Record &record : frame.records) {
+        if (record.beginQuery < 0 || record.endQuery < 0)
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[record.beginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[record.endQuery], GL_QUERY_RESULT, &end);
+        Timing timing = { record.name, record.depth, (end - begin) / 1e6 };
+        latest.append(timing);
+    }
+    latestFrame = frame.number;
+
+    if (logInterval > 0) {
+        accumulate();
+        if (++framesLogged >= logInterval)
+            log();
+    }
+}
+
+// Sums the latest results per scope path, e.g. "frame/objects/draw".
+// Looks scopes up by name pointer and parent, so it does not allocate
+// once every path has been seen.
+void GpuProfiler::accumulate()
+{
+    for (const Timing &timing : latest) {
+        averageStack.resize(timing.depth);
+        int parent = timing.depth > 0 ? averageStack.last() : -1;
+
+        int idx = 0;
+        while (idx < averages.size() && (averages[idx].name != timing.name || averages[idx].parent != parent))
+            ++idx;
+        if (idx == averages.size()) {
+            Average average = { timing.name, parent, timing.depth, 0, 0 };
+            averages.append(average);
+        }
+        averages[idx].milliseconds += timing.milliseconds;
+        ++averages[idx].count;
+        averageStack.append(idx);
+    }
+}
+
+void GpuProfiler::log()
+{
+    qDebug() << ":: GPU time over" << framesLogged << "frames"
+             << "(" << droppedFrames << "dropped," << overflowedScopes << "scopes over the limit )";
+    for (const Average &average : averages) {
+        QByteArray path = average.name;
+        for (int parent = average.parent; parent >= 0; parent = averages[parent].parent)
+            path = averages[parent].name + QByteArray("/") + path;
+
+        // Time per frame, and per occurrence for scopes that repeat.
+        double perFrame = average.milliseconds / framesLogged;
+        int perFrameCount = qMax(1, average.count / framesLogged);
+        qDebug().noquote() << QString(2 * (average.depth + 1), ' ') + path
+                           << QString::number(perFrame, 'f', 3) << "ms"
+                           << (perFrameCount > 1 ? QString("(%1x)").arg(perFrameCount) : QString());
+    }
+
+    averages.resize(0);
+    framesLogged = 0;
+    droppedFrames = 0;
+    overflowedScopes = 0;
+}
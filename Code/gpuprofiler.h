@@ -0,0 +1,115 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QVector>
+
+/**
+ * @brief The GpuProfiler class
+ *
+ * Measures GPU time of nested scopes with GL_TIMESTAMP queries. Every frame
+ * records into its own set of queries from a ring that is several frames
+ * deep; a frame is read back once the ring comes around to it again, by
+ * which time the GPU has long finished it, so reading never stalls. A frame
+ * whose queries are still not available then is dropped instead of waited on.
+ *
+ * Timestamps are used rather than GL_TIME_ELAPSED because elapsed queries
+ * cannot be nested.
+ *
+ * All functions must be called with the GL context current.
+ */
+class GpuProfiler : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Timing
+    {
+        const char *name;
+        int depth;           // 0 for the frame itself
+        double milliseconds;
+    };
+
+    // Begins a scope on construction and ends it on destruction.
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler &profiler, const char *name) : profiler(profiler) { profiler.begin(name); }
+        ~Scope() { profiler.end(); }
+
+    private:
+        GpuProfiler &profiler;
+    };
+
+    GpuProfiler();
+
+    void initialize(int latency = 4, int maxScopes = 128);
+    void destroy();
+
+    // A frame is a scope named "frame" around everything between these two.
+    void beginFrame();
+    void endFrame();
+
+    // Names must outlive the profiler, string literals are intended.
+    void begin(const char *name);
+    void end();
+
+    // Scopes of the most recent frame that was read back, in begin order.
+    const QVector<Timing> &results() const;
+    // Time of the first scope of that name in results(), 0 if there is none.
+    double milliseconds(const char *name) const;
+    quint64 resultFrame() const;
+    // Number of the last frame begun, frames are numbered from 1.
+    quint64 currentFrame() const;
+
+    // Logs average times per scope path every so many frames, 0 disables.
+    void setLogInterval(int frames);
+
+private:
+    struct Record
+    {
+        const char *name;
+        int depth;
+        int beginQuery;
+        int endQuery; // -1 while the scope is open
+    };
+
+    struct Frame
+    {
+        QVector<GLuint> queries;
+        QVector<Record> records;
+        int queriesUsed;
+        quint64 number;
+        bool pending;
+    };
+
+    struct Average
+    {
+        const char *name;
+        int parent; // index in averages, -1 for the frame
+        int depth;
+        double milliseconds; // summed over the log interval
+        int count;
+    };
+
+    void readBack(Frame &frame);
+    void accumulate();
+    void log();
+
+    bool initialized = false;
+    QVector<Frame> frames;
+    int current = 0;
+    quint64 frameNumber = 0;
+    int maxScopes = 0;
+    QVector<int> openScopes; // record indices
+
+    QVector<Timing> latest;
+    quint64 latestFrame = 0;
+    quint64 droppedFrames = 0;
+    quint64 overflowedScopes = 0;
+
+    int logInterval = 300;
+    int framesLogged = 0;
+    QVector<Average> averages;
+    QVector<int> averageStack;
+};
+
+#endif // GPUPROFILER_H
@@ -0,0 +1,158 @@
+#include "initgraph.h"
+
+#include <QDebug>
+#include <QRunnable>
+#include <QThreadPool>
+
+class InitGraphRunnable : public QRunnable
+{
+public:
+    InitGraphRunnable(InitGraph *graph, int idx) : graph(graph), idx(idx) {}
+
+    void run()
+    {
+        graph->execute(idx);
+        graph->complete(idx);
+    }
+
+private:
+    InitGraph *graph;
+    int idx;
+};
+
+InitGraph::InitGraph()
+{
+}
+
+int InitGraph::addTask(QString name, Affinity affinity, Task task, QVector<int> dependencies)
+{
+    int idx = nodes.size();
+
+    Node node;
+    node.name = name;
+    node.affinity = affinity;
+    node.task = task;
+    node.dependencies = dependencies;
+    node.pendingDependencies = dependencies.size();
+    node.startNs = 0;
+    node.endNs = 0;
+    nodes.append(node);
+
+    for (int dependency : dependencies) {
+        Q_ASSERT(dependency < idx);
+        nodes[dependency].dependents.append(idx);
+    }
+    return idx;
+}
+
+/**
+ * @brief InitGraph::run
+ *
+ * Starts every task without dependencies, then serves context tasks on the
+ * calling thread until the whole graph has completed.
+ */
+void InitGraph::run()
+{
+    clock.start();
+    remaining = nodes.size();
+
+    mutex.lock();
+    for (int idx = 0; idx != nodes.size(); ++idx) {
+        if (nodes[idx].pendingDependencies == 0)
+            dispatch(idx);
+    }
+
+    while (remaining > 0) {
+        if (contextQueue.isEmpty()) {
+            contextReady.wait(&mutex);
+            continue;
+        }
+
+        int idx = contextQueue.dequeue();
+        mutex.unlock();
+        execute(idx);
+        complete(idx);
+        mutex.lock();
+    }
+    mutex.unlock();
+
+    wallNs = clock.nsecsElapsed();
+}
+
+// Must be called with the mutex held.
+void InitGraph::dispatch(int idx)
+{
+    if (nodes[idx].affinity == WORKER) {
+        QThreadPool::globalInstance()->start(new InitGraphRunnable(this, idx));
+    } else {
+        contextQueue.enqueue(idx);
+        contextReady.wakeAll();
+    }
+}
+
+void InitGraph::execute(int idx)
+{
+    Node &node = nodes[idx];
+    node.startNs = clock.nsecsElapsed();
+    node.task();
+    node.endNs = clock.nsecsElapsed();
+}
+
+void InitGraph::complete(int idx)
+{
+    QMutexLocker locker(&mutex);
+
+    for (int dependent : nodes[idx].dependents) {
+        if (--nodes[dependent].pendingDependencies == 0)
+            dispatch(dependent);
+    }
+
+    --remaining;
+    contextReady.wakeAll();
+}
+
+/**
+ * @brief InitGraph::printReport
+ *
+ * The critical path is found by walking back from the last task to finish,
+ * each time following the dependency that finished last.
+ */
+void InitGraph::printReport() const
+{
+    if (nodes.isEmpty())
+        return;
+
+    qint64 summedNs = 0;
+    int last = 0;
+    int slowest = 0;
+    for (int idx = 0; idx != nodes.size(); ++idx) {
+        const Node &node = nodes[idx];
+        summedNs += node.endNs - node.startNs;
+        if (node.endNs > nodes[last].endNs)
+            last = idx;
+        if (node.endNs - node.startNs > nodes[slowest].endNs - nodes[slowest].startNs)
+            slowest = idx;
+    }
+
+    QVector<int> path;
+    for (int idx = last; idx >= 0; ) {
+        path.prepend(idx);
+        int next = -1;
+        for (int dependency : nodes[idx].dependencies) {
+            if (next < 0 || nodes[dependency].endNs > nodes[next].endNs)
+                next = dependency;
+        }
+        idx = next;
+    }
+
+    qDebug() << ":: Startup took" << wallNs / 1e6 << "ms," << summedNs / 1e6 << "ms of work in"
+             << nodes.size() << "tasks";
+    qDebug() << ":: Slowest task:" << qPrintable(nodes[slowest].name)
+             << (nodes[slowest].endNs - nodes[slowest].startNs) / 1e6 << "ms";
+    qDebug() << ":: Critical path:";
+    for (int idx : path) {
+        const Node &node = nodes[idx];
+        qDebug() << "   " << qPrintable(node.name) << (node.affinity == WORKER ? "[worker]" : "[context]")
+                 << "start" << node.startNs / 1e6 << "ms, took" << (node.endNs - node.startNs) / 1e6 << "ms";
+    }
+}
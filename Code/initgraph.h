@@ -0,0 +1,72 @@
+#ifndef INITGRAPH_H
+#define INITGRAPH_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+
+/**
+ * @brief The InitGraph class
+ *
+ * Runs startup work as a dependency graph. Worker tasks (file reads, OBJ
+ * parsing, image decoding) run concurrently on the global thread pool, while
+ * context tasks (anything touching GL) run one at a time on the thread that
+ * calls run(), as soon as their inputs are ready.
+ *
+ * Dependencies must be added before the tasks that use them, so task ids are
+ * always in topological order.
+ */
+class InitGraph
+{
+public:
+    enum Affinity
+    {
+        WORKER = 0, CONTEXT
+    };
+
+    typedef std::function<void()> Task;
+
+    InitGraph();
+
+    int addTask(QString name, Affinity affinity, Task task, QVector<int> dependencies = QVector<int>());
+
+    // Blocks until every task has finished; context tasks run on the calling thread.
+    void run();
+
+    // Prints wall time, summed task time and the critical path through the graph.
+    void printReport() const;
+
+private:
+    struct Node
+    {
+        QString name;
+        Affinity affinity;
+        Task task;
+        QVector<int> dependents;
+        int pendingDependencies;
+        QVector<int> dependencies;
+        qint64 startNs;
+        qint64 endNs;
+    };
+
+    friend class InitGraphRunnable;
+
+    void dispatch(int idx);
+    void execute(int idx);
+    void complete(int idx);
+
+    QVector<Node> nodes;
+    QElapsedTimer clock;
+    qint64 wallNs = 0;
+
+    QMutex mutex;
+    QWaitCondition contextReady;
+    QQueue<int> contextQueue;
+    int remaining = 0;
+};
+
+#endif // INITGRAPH_H
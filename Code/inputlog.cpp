@@ -0,0 +1,149 @@
+#include "inputlog.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+namespace {
+const quint32 logMagic = 0x494e504c; // "INPL"
+const quint32 logVersion = 1;
+}
+
+InputLog::InputLog()
+{
+}
+
+void InputLog::startRecording()
+{
+    log.clear();
+    ticks = 0;
+    clock.start();
+}
+
+void InputLog::record(quint32 tick, Action action, float x, float y, float z)
+{
+    Event event = { tick, static_cast<quint32>(clock.elapsed()), action, { x, y, z } };
+    log.append(event);
+}
+
+void InputLog::finish(quint32 tick, QSize viewport)
+{
+    ticks = tick;
+    viewportSize = viewport;
+}
+
+/**
+ * @brief InputLog::save
+ *
+ * Header (magic, version, viewport, length in ticks, event count), then per
+ * event its tick, time, action and only the values that action uses.
+ */
+bool InputLog::save(const QString &file) const
+{
+    QSaveFile out(file);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << ":: Could not write input log" << file;
+        return false;
+    }
+
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << logMagic << logVersion << viewportSize << ticks << quint32(log.size());
+    for (const Event &event : log) {
+        stream << event.tick << event.milliseconds << quint8(event.action);
+        for (int i = 0; i < valueCount(event.action); ++i)
+            stream << event.values[i];
+    }
+
+    if (!out.commit()) {
+        qWarning() << ":: Could not write input log" << file;
+        return false;
+    }
+    qDebug() << ":: Recorded" << log.size() << "input events over" << ticks << "frames to" << file;
+    return true;
+}
+
+bool InputLog::load(const QString &file)
+{
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        qWarning() << ":: Could not read input log" << file;
+        return false;
+    }
+
+    QDataStream stream(&in);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic, version, count;
+    stream >> magic >> version;
+    if (magic != logMagic || version != logVersion) {
+        qWarning() << ":: Not an input log, or of another version:" << file;
+        return false;
+    }
+    stream >> viewportSize >> ticks >> count;
+
+    // Every event takes at least its tick, time and action, so a count the
+    // rest of the file cannot hold is corrupt; do not reserve for it.
+    const qint64 minEventBytes = 2 * sizeof(quint32) + sizeof(quint8);
+    if (stream.status() != QDataStream::Ok || count > in.bytesAvailable() / minEventBytes) {
+        qWarning() << ":: Corrupt input log" << file;
+        return false;
+    }
+
+    log.clear();
+    log.reserve(count);
+    for (quint32 idx = 0; idx < count && stream.status() == QDataStream::Ok; ++idx) {
+        Event event = { 0, 0, VIEW_ROTATION, { 0, 0, 0 } };
+        quint8 action;
+        stream >> event.tick >> event.milliseconds >> action;
+        if (action > IMPULSE)
+            break;
+        event.action = static_cast<Action>(action);
+        for (int i = 0; i < valueCount(event.action); ++i)
+            stream >> event.values[i];
+        log.append(event);
+    }
+
+    if (stream.status() != QDataStream::Ok || log.size() != int(count)) {
+        qWarning() << ":: Corrupt input log" << file;
+        log.clear();
+        return false;
+    }
+    return true;
+}
+
+const QVector<InputLog::Event> &InputLog::events() const
+{
+    return log;
+}
+
+quint32 InputLog::length() const
+{
+    return ticks;
+}
+
+QSize InputLog::viewport() const
+{
+    return viewportSize;
+}
+
+// --- Helpers
+
+int InputLog::valueCount(Action action)
+{
+    switch (action) {
+    case VIEW_ROTATION: return 3;
+    case VIEW_DISTANCE: return 1;
+    case ROTATION: return 3;
+    case SCALE: return 1;
+    case SHADING_MODE: return 1;
+    case TOGGLE_STATS: return 0;
+    case TOGGLE_ANIMATION: return 0;
+    case GRID: return 2;
+    case IMPULSE: return 3;
+    }
+    return 0;
+}
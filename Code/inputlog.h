@@ -0,0 +1,67 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <QElapsedTimer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The InputLog class
+ *
+ * A recorded user session: every call that changes the view (mouse, wheel,
+ * keys, and the dials, slider and buttons of the MainWindow) together with
+ * the simulation tick it happened in. A tick is one paintGL; the scene only
+ * advances per tick, so applying each event right before the frame with the
+ * same tick reproduces the session exactly, at any frame rate.
+ *
+ * Stored as a small binary file through QDataStream.
+ */
+class InputLog
+{
+public:
+    enum Action : quint8
+    {
+        VIEW_ROTATION = 0, // x, y, z deltas
+        VIEW_DISTANCE,     // wheel delta
+        ROTATION,          // x, y, z
+        SCALE,             // percentage
+        SHADING_MODE,      // MainView::ShadingMode
+        TOGGLE_STATS,
+        TOGGLE_ANIMATION,
+        GRID,              // resolution, strips
+        IMPULSE            // grid x, y, strength
+    };
+
+    struct Event
+    {
+        quint32 tick;
+        quint32 milliseconds; // wall time since recording started, informational
+        Action action;
+        float values[3];
+    };
+
+    InputLog();
+
+    void startRecording();
+    void record(quint32 tick, Action action, float x = 0, float y = 0, float z = 0);
+    // Marks the tick the session ended on, and the viewport it was viewed in.
+    void finish(quint32 tick, QSize viewport);
+
+    bool save(const QString &file) const;
+    bool load(const QString &file);
+
+    const QVector<Event> &events() const;
+    quint32 length() const; // in ticks
+    QSize viewport() const;
+
+private:
+    static int valueCount(Action action);
+
+    QVector<Event> log;
+    quint32 ticks = 0;
+    QSize viewportSize;
+    QElapsedTimer clock;
+};
+
+#endif // INPUTLOG_H
@@ -1,5 +1,8 @@
 #include "mainwindow.h"
+#include "mainview.h"
+#include "trace.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 #include <ctime>
 
@@ -8,11 +11,35 @@ int main(int argc, char *argv[])
     std::srand(std::time(nullptr));
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption traceOption("trace", "Record a Chrome trace and write it to file on exit.", "file");
+    parser.addOption(traceOption);
+    QCommandLineOption recordOption("record", "Record the input of this session to file, for replay by the benchmark.", "file");
+    parser.addOption(recordOption);
+    QCommandLineOption onDemandOption("on-demand", "Only repaint when something changed; space pauses the animation.");
+    parser.addOption(onDemandOption);
+    QCommandLineOption glDebugOption("gl-debug", "GL debug output: off, async or sync.", "tier",
+                                     GlDebug::tierName(GlDebug::defaultTier()));
+    parser.addOption(glDebugOption);
+    SceneGenerator::addOptions(parser);
+    parser.process(a);
+    Trace::setEnabled(parser.isSet(traceOption));
+
+    GlDebug::Tier glDebugTier;
+    if (!GlDebug::parseTier(parser.value(glDebugOption), glDebugTier))
+        return 1;
+    GlDebug::setTier(glDebugTier);
+
+    SceneGenerator::Config scene;
+    if (!SceneGenerator::configure(parser, scene))
+        return 1;
+
     // Request OpenGL 3.3 Core
     QSurfaceFormat glFormat;
     glFormat.setProfile(QSurfaceFormat::CoreProfile);
     glFormat.setVersion(3, 3);
-    glFormat.setOption(QSurfaceFormat::DebugContext);
+    GlDebug::configureFormat(glFormat);
 
     // Some platforms need to explicitly set the depth buffer size (24 bits)
     glFormat.setDepthBufferSize(24);
@@ -20,7 +47,21 @@ int main(int argc, char *argv[])
     QSurfaceFormat::setDefaultFormat(glFormat);
 
     MainWindow w;
+    w.mainView()->setRenderOnDemand(parser.isSet(onDemandOption));
+    w.mainView()->setScene(scene);
+    InputLog inputLog;
+    if (parser.isSet(recordOption))
+        w.mainView()->startRecording(&inputLog);
     w.show();
 
-    return a.exec();
+    int result = a.exec();
+
+    if (parser.isSet(recordOption)) {
+        w.mainView()->stopRecording();
+        inputLog.save(parser.value(recordOption));
+    }
+
+    if (parser.isSet(traceOption))
+        Trace::writeChromeJson(parser.value(traceOption));
+    return result;
 }
@@ -1,10 +1,16 @@
 #include "mainview.h"
 #include "model.h"
+#include "trace.h"
 #include "vertex.h"
 
 #include <math.h>
+#include <memory>
 #include <QDateTime>
 
+namespace {
+const int frameInterval = 1000 / 60; // milliseconds
+}
+
 /**
  * @brief MainView::MainView
  *
@@ -15,7 +21,10 @@
 MainView::MainView(QWidget *parent) : QOpenGLWidget(parent) {
     qDebug() << "MainView constructor";
 
-    connect(&timer, SIGNAL(timeout()), this, SLOT(update()));
+    connect(&timer, SIGNAL(timeout()), this, SLOT(onTimer()));
+    // Keep the framebuffer between frames, so paintGL() can skip a frame
+    // that would look the same when rendering on demand.
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
     viewTransform.translate(0, 0, -4);
 }
 
@@ -28,11 +37,18 @@ MainView::MainView(QWidget *parent) : QOpenGLWidget(parent) {
  *
  */
 MainView::~MainView() {
-    debugLogger->stopLogging();
-
     qDebug() << "MainView destructor";
 
-    glDeleteTextures(numObjects, texturePtr);
+    makeCurrent();
+
+    glDebug.destroy();
+    statsOverlay.destroy();
+    gpuProfiler.destroy();
+    textureStreamer.destroy();
+    while (!shaderBuilder.isIdle())
+        shaderBuilder.poll();
+    shaderPermutations.destroy();
+    glDeleteTextures(numTextures, texturePtr);
 
     destroyModelBuffers();
 }
@@ -49,15 +65,8 @@ void MainView::initializeGL() {
     qDebug() << ":: Initializing OpenGL";
     initializeOpenGLFunctions();
 
-    debugLogger = new QOpenGLDebugLogger();
-    connect( debugLogger, SIGNAL( messageLogged( QOpenGLDebugMessage ) ),
-             this, SLOT( onMessageLogged( QOpenGLDebugMessage ) ), Qt::DirectConnection );
-
-    if ( debugLogger->initialize() ) {
-        qDebug() << ":: Logging initialized";
-        debugLogger->startLogging( QOpenGLDebugLogger::SynchronousLogging );
-        debugLogger->enableMessages();
-    }
+    glDebug.initialize();
+    Trace::initializeGL();
 
     QString glVersion;
     glVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
@@ -68,104 +77,122 @@ void MainView::initializeGL() {
     glDepthFunc(GL_LEQUAL);
     glClearColor(0.0, 1.0, 0.0, 1.0);
 
-    createShaderProgram();
-    loadObjects();
-
-    // Specify object movement
-    object[0].rotationSpeed = 1.5;
-    object[1].rotationSpeed = 1.0;
-    object[2].rotationSpeed = 1.0;
-    object[3].rotationSpeed = 1.3;
-    object[0].scale = 1.2;
-    object[1].scale = 0.5;
-    object[2].scale = 1.1;
-    object[3].scale = 0.9;
+    shaderCache.initialize();
+    shaderBuilder.initialize(&shaderCache);
+    textureStreamer.initialize();
+    gpuProfiler.initialize();
+    statsOverlay.initialize();
+
+    // File reads, parsing and decoding run on worker threads; GL work stays here.
+    InitGraph startup;
+    createShaderProgram(startup);
+    loadObjects(startup);
+    startup.run();
+    startup.printReport();
+    updateModelTransforms();
 
     // Initialize transformations
     updateProjectionTransform();
 
 
-    timer.start(1000.0/60.0);
+    timer.start(frameInterval);
 }
 
-void MainView::loadObjects ()
+/**
+ * @brief MainView::loadObjects
+ *
+ * Loads every mesh and texture once; the objects, preset or generated, only
+ * refer to them by index.
+ */
+void MainView::loadObjects(InitGraph &startup)
 {
-    numObjects = 4;
-    object = new Object[numObjects];
-    meshVBO = new GLuint[numObjects];
-    meshVAO = new GLuint[numObjects];
-    texturePtr = new GLuint[numObjects];
-    glGenBuffers(numObjects, meshVBO);
-    glGenVertexArrays(numObjects, meshVAO);
-    glGenTextures(numObjects, texturePtr);
-    meshSize = new GLuint[numObjects];
-    loadMesh (":/models/cat.obj", 1);
-    loadMesh (":/models/cat.obj", 0);
-    loadMesh (":/models/sphere.obj", 2);
-    loadMesh (":/models/sphere.obj", 3);
-    loadTexture (":/textures/cat_diff.png", texturePtr[0]);
-    loadTexture (":/textures/cat_spec.png", texturePtr[1]);
-    loadTexture (":/textures/wood1.jpg", texturePtr[2]);
-    loadTexture (":/textures/wood2.jpg", texturePtr[3]);
+    const char *meshes[] = { ":/models/cat.obj", ":/models/sphere.obj", ":/models/cube.obj" };
+    const char *textures[] = { ":/textures/cat_diff.png", ":/textures/cat_spec.png",
+                               ":/textures/wood1.jpg", ":/textures/wood2.jpg", ":/textures/rug_logo.png" };
+
+    numMeshes = sizeof(meshes) / sizeof(meshes[0]);
+    numTextures = sizeof(textures) / sizeof(textures[0]);
+    meshVBO = new GLuint[numMeshes];
+    meshVAO = new GLuint[numMeshes];
+    texturePtr = new GLuint[numTextures];
+    glGenBuffers(numMeshes, meshVBO);
+    glGenVertexArrays(numMeshes, meshVAO);
+    glGenTextures(numTextures, texturePtr);
+    meshSize = new GLuint[numMeshes];
+
+    objects = SceneGenerator::generate(sceneConfig, numMeshes, numTextures);
+    qDebug() << ":: Scene:" << objects.size() << "objects," << SceneGenerator::layoutName(sceneConfig.layout) << "layout";
+
+    for (GLuint idx = 0; idx < numMeshes; ++idx)
+    {
+        QString file = meshes[idx];
+        auto meshData = std::make_shared<QVector<float>>();
+        int parse = startup.addTask("parse " + file, InitGraph::WORKER,
+                                    [=] { *meshData = parseMesh(file); });
+        startup.addTask("upload mesh " + QString::number(idx), InitGraph::CONTEXT,
+                        [=] { loadMesh(*meshData, idx); }, {parse});
+    }
 
-    updateModelTransforms();
+    for (GLuint idx = 0; idx < numTextures; ++idx)
+    {
+        QString file = textures[idx];
+        auto mips = std::make_shared<TextureStreamer::MipChain>();
+        int decode = startup.addTask("decode " + file, InitGraph::WORKER,
+                                     [=] { *mips = decodeTexture(file); });
+        startup.addTask("upload texture " + QString::number(idx), InitGraph::CONTEXT,
+                        [=] { loadTexture(*mips, texturePtr[idx]); }, {decode});
+    }
+}
+
+/**
+ * @brief MainView::createShaderProgram
+ *
+ * Reads the uber-shader sources on a worker, then links the fallback variant
+ * and submits the variants of all shading modes, the selected one first.
+ */
+void MainView::createShaderProgram(InitGraph &startup)
+{
+    auto sources = std::make_shared<QPair<QByteArray, QByteArray>>();
+    int read = startup.addTask("read uber shaders", InitGraph::WORKER, [=] {
+        sources->first = readFile(":/shaders/vertshader_uber.glsl");
+        sources->second = readFile(":/shaders/fragshader_uber.glsl");
+    });
+
+    startup.addTask("submit shader variants", InitGraph::CONTEXT, [=] {
+        shaderPermutations.initialize(&shaderCache, &shaderBuilder, sources->first, sources->second);
+        for (ShadingMode shading : { GOURAUD, NORMAL, PHONG, currentShader })
+            shaderPermutations.variant(shaderFeaturesFor(shading));
+    }, {read});
+}
+
+ShaderPermutations::Features MainView::shaderFeaturesFor(ShadingMode shading)
+{
+    switch (shading) {
+    case NORMAL: return { ShaderPermutations::NORMAL, false, 0 };
+    case GOURAUD: return { ShaderPermutations::GOURAUD, true, 0 };
+    case PHONG: return { ShaderPermutations::PHONG, true, 0 };
+    }
+    return { ShaderPermutations::FALLBACK, false, 0 };
 }
 
-void MainView::createShaderProgram()
-{
-    // Create Normal Shader program
-    normalShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                           ":/shaders/vertshader_normal.glsl");
-    normalShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                           ":/shaders/fragshader_normal.glsl");
-    normalShaderProgram.link();
-
-    // Create Gouraud Shader program
-    gouraudShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                           ":/shaders/vertshader_gouraud.glsl");
-    gouraudShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                           ":/shaders/fragshader_gouraud.glsl");
-    gouraudShaderProgram.link();
-
-    // Create Phong Shader program
-    phongShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                           ":/shaders/vertshader_phong.glsl");
-    phongShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                           ":/shaders/fragshader_phong.glsl");
-    phongShaderProgram.link();
-
-    // Get the uniforms for the normal shader.
-    uniformModelViewTransformNormal  = normalShaderProgram.uniformLocation("modelViewTransform");
-    uniformProjectionTransformNormal = normalShaderProgram.uniformLocation("projectionTransform");
-    uniformNormalTransformNormal     = normalShaderProgram.uniformLocation("normalTransform");
-
-    // Get the uniforms for the gouraud shader.
-    uniformModelViewTransformGouraud  = gouraudShaderProgram.uniformLocation("modelViewTransform");
-    uniformProjectionTransformGouraud = gouraudShaderProgram.uniformLocation("projectionTransform");
-    uniformNormalTransformGouraud     = gouraudShaderProgram.uniformLocation("normalTransform");
-    uniformMaterialGouraud            = gouraudShaderProgram.uniformLocation("material");
-    uniformLightPositionGouraud       = gouraudShaderProgram.uniformLocation("lightPosition");
-    uniformLightColourGouraud         = gouraudShaderProgram.uniformLocation("lightColour");
-    uniformTextureSamplerGouraud      = gouraudShaderProgram.uniformLocation("textureSampler");
-
-    // Get the uniforms for the phong shader.
-    uniformModelViewTransformPhong  = phongShaderProgram.uniformLocation("modelViewTransform");
-    uniformProjectionTransformPhong = phongShaderProgram.uniformLocation("projectionTransform");
-    uniformNormalTransformPhong     = phongShaderProgram.uniformLocation("normalTransform");
-    uniformMaterialPhong            = phongShaderProgram.uniformLocation("material");
-    uniformLightPositionPhong       = phongShaderProgram.uniformLocation("lightPosition");
-    uniformLightColourPhong         = phongShaderProgram.uniformLocation("lightColour");
-    uniformTextureSamplerPhong      = phongShaderProgram.uniformLocation("textureSampler");
-}
-
-void MainView::loadMesh(const char *path, GLuint idx)
-{
-    Model model(path);
+/**
+ * @brief MainView::parseMesh
+ *
+ * Loads and unitizes a model. Does not touch GL, so it is safe on any thread.
+ *
+ * @return interleaved vertex, normal and texture coordinate data
+ */
+QVector<float> MainView::parseMesh(QString file)
+{
+    Model model(file);
     model.unitize();
-    QVector<float> meshData = model.getVNTInterleaved();
-    qDebug() << "Arrived here";
-    this->meshSize[idx] = model.getVertices().size();
-    qDebug() << "Ander here";
+    return model.getVNTInterleaved();
+}
+
+void MainView::loadMesh(const QVector<float> &meshData, GLuint idx)
+{
+    this->meshSize[idx] = meshData.size() / 8;
+
     // Bind VAO
     glBindVertexArray(meshVAO[idx]);
 
@@ -191,21 +218,17 @@ void MainView::loadMesh(const char *path, GLuint idx)
     glBindVertexArray(0);
 }
 
-void MainView::loadTexture(QString file, GLuint texturePtr)
+void MainView::loadTexture(TextureStreamer::MipChain mips, GLuint texturePtr)
 {
     // Set texture parameters.
     glBindTexture(GL_TEXTURE_2D, texturePtr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-    // Push image data to texture.
-    QImage image(file);
-    QVector<quint8> imageData = imageToBytes(image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width(), image.height(),
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData.data());
+    // Image data is streamed in over the next frames, coarsest level first.
+    textureStreamer.request(texturePtr, mips);
 }
 
 // --- OpenGL drawing
@@ -217,45 +240,77 @@ void MainView::loadTexture(QString file, GLuint texturePtr)
  *
  */
 void MainView::paintGL() {
+    // Nothing changed: with PartialUpdate QOpenGLWidget keeps and presents the
+    // last frame.
+    if (renderOnDemand && !dirty)
+        return;
+
+    TRACE_GL_SCOPE("paintGL");
+    AllocTracker::Scope allocations;
+    applyReplay();
+    frameStats.beginFrame();
+    gpuProfiler.beginFrame();
+
     // Clear the screen before rendering
     glClearColor(0.2f, 0.5f, 0.7f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    {
+        GpuProfiler::Scope uploads(gpuProfiler, "texture uploads");
+        textureStreamer.processUploads();
+        frameStats.current().textureBytes += textureStreamer.uploadedBytes();
+    }
+
+    if (animating)
+        advanceAnimation();
     updateModelTransforms();
     updateViewTransform();
 
-    // Choose the selected shader.
-    QOpenGLShaderProgram *shaderProgram;
-    switch (currentShader) {
-    case NORMAL:
-        shaderProgram = &normalShaderProgram;
-        shaderProgram->bind();
-        break;
-    case GOURAUD:
-        shaderProgram = &gouraudShaderProgram;
-        shaderProgram->bind();
-        break;
-    case PHONG:
-        shaderProgram = &phongShaderProgram;
-        shaderProgram->bind();
-        break;
-    }
+    shaderPermutations.poll();
+
+    // Choose the selected shader, or the fallback while it is still being built.
+    ShaderVariant *shader = shaderPermutations.variant(shaderFeaturesFor(currentShader));
+    if (!shader->ready)
+        shader = shaderPermutations.fallback();
+    QOpenGLShaderProgram *shaderProgram = &shader->program;
+    shaderProgram->bind();
+    frameStats.addStateChange();
 
     // Set all textures and draw the meshes.
-    for (GLuint idx = 0; idx < numObjects; ++idx)
+    gpuProfiler.begin("objects");
+    for (const Object &object : objects)
     {
-        switch (currentShader) {
-        case NORMAL: updateNormalUniforms(idx); break;
-        case GOURAUD: updateGouraudUniforms(idx); break;
-        case PHONG: updatePhongUniforms(idx); break;
-        }
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texturePtr[idx]);
+        GpuProfiler::Scope draw(gpuProfiler, "draw");
+        updateUniforms(shader, object);
 
-        glBindVertexArray(meshVAO[idx]);
-        glDrawArrays(GL_TRIANGLES, 0, meshSize[idx]);
+        TRACE_GL_SCOPE("draw submission");
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texturePtr[object.texture]);
+        textureStreamer.touch(texturePtr[object.texture]);
+
+        glBindVertexArray(meshVAO[object.mesh]);
+        glDrawArrays(GL_TRIANGLES, 0, meshSize[object.mesh]);
+        frameStats.addStateChange();
+        frameStats.addStateChange();
+        frameStats.addDraw(meshSize[object.mesh] / 3);
     }
+    gpuProfiler.end();
     shaderProgram->release();
+
+    if (showStats)
+        statsOverlay.draw(frameStats.last(), width() * devicePixelRatio(), height() * devicePixelRatio(), frameStats);
+
+    gpuProfiler.endFrame();
+    const QVector<GpuProfiler::Timing> &gpuTimes = gpuProfiler.results();
+    frameStats.endFrame(gpuTimes.isEmpty() ? 0 : gpuTimes.first().milliseconds);
+
+    // Until the selected shader and all textures are in, keep painting.
+    dirty = (!shader->ready || isLoading()) ? LOADING : 0;
+    if (dirty && !timer.isActive())
+        timer.start(frameInterval);
+
+    frameAllocations = allocations.counts();
+    ++tick;
 }
 
 /**
@@ -271,74 +326,63 @@ void MainView::resizeGL(int newWidth, int newHeight)
     Q_UNUSED(newWidth)
     Q_UNUSED(newHeight)
     updateProjectionTransform();
+    dirty |= CAMERA;
 }
 
-void MainView::updateNormalUniforms(GLuint idx)
+void MainView::updateUniforms(const ShaderVariant *variant, const Object &object)
 {
-    auto modelViewMatrix = viewTransform * object[idx].meshTransform;
-
-    glUniformMatrix4fv(uniformProjectionTransformNormal, 1, GL_FALSE, projectionTransform.data());
-    glUniformMatrix4fv(uniformModelViewTransformNormal, 1, GL_FALSE, modelViewMatrix.data());
-    glUniformMatrix3fv(uniformNormalTransformNormal, 1, GL_FALSE, modelViewMatrix.normalMatrix().data());
-}
-
-void MainView::updateGouraudUniforms(GLuint idx)
-{
-    auto modelViewMatrix = viewTransform * object[idx].meshTransform;
-
-    glUniformMatrix4fv(uniformProjectionTransformGouraud, 1, GL_FALSE, projectionTransform.data());
-    glUniformMatrix4fv(uniformModelViewTransformGouraud, 1, GL_FALSE,  modelViewMatrix.data());
-    glUniformMatrix3fv(uniformNormalTransformGouraud, 1, GL_FALSE, modelViewMatrix.normalMatrix().data());
-
-    glUniform4fv(uniformMaterialGouraud, 1, &material[0]);
-    glUniform3fv(uniformLightPositionGouraud, 1, &lightPosition[0]);
-    glUniform3fv(uniformLightColourGouraud, 1, &lightColour[0]);
-
-    glUniform1i(uniformTextureSamplerGouraud, 0); // Redundant now, but useful when you have multiple textures.
-}
-
-void MainView::updatePhongUniforms(GLuint idx)
-{
-    auto modelViewMatrix = viewTransform * object[idx].meshTransform;
-
-    glUniformMatrix4fv(uniformProjectionTransformPhong, 1, GL_FALSE, projectionTransform.data());
-    glUniformMatrix4fv(uniformModelViewTransformPhong, 1, GL_FALSE,  modelViewMatrix.data());
-    glUniformMatrix3fv(uniformNormalTransformPhong, 1, GL_FALSE, modelViewMatrix.normalMatrix().data());
-
-    glUniform4fv(uniformMaterialPhong, 1, &material[0]);
-    glUniform3fv(uniformLightPositionPhong, 1, &lightPosition[0]);
-    glUniform3fv(uniformLightColourPhong, 1, &lightColour[0]);
-
-    glUniform1i(uniformTextureSamplerGouraud, 0);
+    TRACE_GL_SCOPE("uniform upload");
+    auto modelViewMatrix = viewTransform * object.meshTransform;
+
+    glUniformMatrix4fv(variant->uniformProjectionTransform, 1, GL_FALSE, projectionTransform.data());
+    frameStats.addUniformBytes(variant->uniformProjectionTransform, 16 * sizeof(float));
+    glUniformMatrix4fv(variant->uniformModelViewTransform, 1, GL_FALSE, modelViewMatrix.data());
+    frameStats.addUniformBytes(variant->uniformModelViewTransform, 16 * sizeof(float));
+    glUniformMatrix3fv(variant->uniformNormalTransform, 1, GL_FALSE, modelViewMatrix.normalMatrix().data());
+    frameStats.addUniformBytes(variant->uniformNormalTransform, 9 * sizeof(float));
+
+    // Uniforms the variant does not use have location -1, are ignored and not counted.
+    glUniform4f(variant->uniformMaterial, object.material.x(), object.material.y(),
+                object.material.z(), object.material.w());
+    frameStats.addUniformBytes(variant->uniformMaterial, 4 * sizeof(float));
+    glUniform3fv(variant->uniformLightPosition, 1, &lightPosition[0]);
+    frameStats.addUniformBytes(variant->uniformLightPosition, 3 * sizeof(float));
+    glUniform3fv(variant->uniformLightColour, 1, &lightColour[0]);
+    frameStats.addUniformBytes(variant->uniformLightColour, 3 * sizeof(float));
+
+    glUniform1i(variant->uniformTextureSampler, 0);
+    frameStats.addUniformBytes(variant->uniformTextureSampler, sizeof(GLint));
 }
 
 void MainView::updateProjectionTransform()
 {
     float aspect_ratio = static_cast<float>(width()) / static_cast<float>(height());
     projectionTransform.setToIdentity();
-    projectionTransform.perspective(60, aspect_ratio, 0.2, 20);
+    projectionTransform.perspective(60, aspect_ratio, 0.2, farPlane);
     projectionTransform.rotate(QQuaternion::fromEulerAngles(viewRotation));
 }
 
+void MainView::advanceAnimation()
+{
+    for (Object &object : objects)
+        object.rotation.setY(object.rotation.y() + object.rotationSpeed);
+    viewRotation.setY(viewRotation.y() + 0.1);
+}
+
 void MainView::updateModelTransforms()
 {
-    for (GLuint idx = 0 ; idx < numObjects ; ++idx)
+    TRACE_SCOPE("transform update");
+    for (Object &object : objects)
     {
-        object[idx].rotation.setY(object[idx].rotation.y() + object[idx].rotationSpeed);
-
-        object[idx].meshTransform.setToIdentity();
-        object[idx].meshTransform.translate(idx*2, 0, 0);
-        object[idx].meshTransform.scale(object[idx].scale);
-        object[idx].meshTransform.rotate(QQuaternion::fromEulerAngles(object[idx].rotation));
-        object[idx].meshNormalTransform = object[idx].meshTransform.normalMatrix();
+        object.meshTransform.setToIdentity();
+        object.meshTransform.translate(object.position);
+        object.meshTransform.scale(object.scale);
+        object.meshTransform.rotate(QQuaternion::fromEulerAngles(object.rotation));
     }
-    update();
 }
 
 void MainView::updateViewTransform()
 {
-    viewRotation.setY( viewRotation.y() + 0.1);
-
     viewTransform.setToIdentity();
     viewTransform.translate(0, 0, zoom);
     viewTransform.rotate(QQuaternion::fromEulerAngles(viewRotation));
@@ -348,59 +392,214 @@ void MainView::updateViewTransform()
 
 void MainView::destroyModelBuffers()
 {
-    glDeleteBuffers(numObjects, meshVBO);
-    glDeleteVertexArrays(numObjects, meshVAO);
+    glDeleteBuffers(numMeshes, meshVBO);
+    glDeleteVertexArrays(numMeshes, meshVAO);
 }
 
 // --- Public interface
 
 void MainView::setRotation(int rotateX, int rotateY, int rotateZ)
 {
-    for (GLuint idx = 0 ; idx < numObjects ; ++idx)
+    recordInput(InputLog::ROTATION, rotateX, rotateY, rotateZ);
+
+    for (Object &object : objects)
     {
-        object[idx].rotation = { static_cast<float>(rotateX), static_cast<float>(rotateY), static_cast<float>(rotateZ) };
+        object.rotation = { static_cast<float>(rotateX), static_cast<float>(rotateY), static_cast<float>(rotateZ) };
     }
     updateModelTransforms();
+    markDirty(SCENE);
 }
 
 void MainView::setViewRotation(float rotateX, float rotateY, float rotateZ)
 {
+    recordInput(InputLog::VIEW_ROTATION, rotateX, rotateY, rotateZ);
+
     viewRotation.setX( viewRotation.x() + rotateX);
     viewRotation.setY( viewRotation.y() + rotateY);
     viewRotation.setZ( viewRotation.z() + rotateZ);
 
     updateViewTransform();
+    markDirty(CAMERA);
 }
 
 void MainView::updateViewDistance(float dist)
 {
+    recordInput(InputLog::VIEW_DISTANCE, dist);
+
     zoom += 0.001*dist;
 
     updateViewTransform();
+    markDirty(CAMERA);
 }
 
 void MainView::setScale(int newScale)
 {
+    recordInput(InputLog::SCALE, newScale);
+
     scale = static_cast<float>(newScale) / 100.f;
     updateModelTransforms();
+    markDirty(SCENE);
 }
 
 void MainView::setShadingMode(ShadingMode shading)
 {
+    recordInput(InputLog::SHADING_MODE, shading);
+
     qDebug() << "Changed shading to" << shading;
     currentShader = shading;
+    markDirty(SCENE);
 }
 
-// --- Private helpers
+void MainView::setRenderOnDemand(bool onDemand)
+{
+    renderOnDemand = onDemand;
+    if (!renderOnDemand && !timer.isActive())
+        timer.start(frameInterval);
+    markDirty(SCENE);
+}
+
+void MainView::setAnimating(bool animate)
+{
+    if (animate != animating)
+        toggleAnimation();
+}
 
 /**
- * @brief MainView::onMessageLogged
+ * @brief MainView::setScene
  *
- * OpenGL logging function, do not change
+ * Generated scenes are viewed from far enough away to see all of them.
+ */
+void MainView::setScene(const SceneGenerator::Config &config)
+{
+    sceneConfig = config;
+    if (config.layout != SceneGenerator::PRESET) {
+        float radius = SceneGenerator::radius(config);
+        zoom = -2 * radius;
+        farPlane = qMax(20.f, 3 * radius);
+    }
+}
+
+void MainView::startRecording(InputLog *log)
+{
+    recorder = log;
+    recorder->startRecording();
+    recordStart = tick;
+}
+
+void MainView::stopRecording()
+{
+    if (recorder)
+        recorder->finish(tick - recordStart, size() * devicePixelRatio());
+    recorder = nullptr;
+}
+
+void MainView::startReplay(const InputLog *log)
+{
+    replay = log;
+    replayStart = tick;
+    replayCursor = 0;
+}
+
+bool MainView::isReplaying() const
+{
+    return replay && tick - replayStart < replay->length();
+}
+
+const FrameCounters &MainView::frameCounters() const
+{
+    return frameStats.last();
+}
+
+void MainView::finishLoading()
+{
+    makeCurrent();
+    while (!shaderBuilder.isIdle() || !textureStreamer.isIdle()) {
+        shaderPermutations.poll();
+        textureStreamer.processUploads();
+    }
+}
+
+// --- Private helpers
+
+void MainView::recordInput(InputLog::Action action, float x, float y, float z)
+{
+    if (recorder)
+        recorder->record(tick - recordStart, action, x, y, z);
+}
+
+void MainView::toggleStats()
+{
+    recordInput(InputLog::TOGGLE_STATS);
+    showStats = !showStats;
+    markDirty(SCENE);
+}
+
+void MainView::toggleAnimation()
+{
+    recordInput(InputLog::TOGGLE_ANIMATION);
+    animating = !animating;
+    markDirty(ANIMATION);
+}
+
+// Repaints once soon; update() requests are merged by Qt.
+void MainView::markDirty(quint32 flags)
+{
+    dirty |= flags;
+    if (renderOnDemand && !timer.isActive() && (animating || isLoading()))
+        timer.start(frameInterval);
+    update();
+}
+
+bool MainView::isLoading() const
+{
+    return !shaderBuilder.isIdle() || !textureStreamer.isIdle();
+}
+
+// Applies the replayed events that happened before the frame about to render.
+void MainView::applyReplay()
+{
+    if (!replay)
+        return;
+
+    const QVector<InputLog::Event> &events = replay->events();
+    while (replayCursor < events.size() && events[replayCursor].tick <= tick - replayStart)
+        applyInputEvent(events[replayCursor++]);
+}
+
+// The model scene has no grid or water to ripple; those events are skipped.
+void MainView::applyInputEvent(const InputLog::Event &event)
+{
+    const float *values = event.values;
+    switch (event.action) {
+    case InputLog::VIEW_ROTATION: setViewRotation(values[0], values[1], values[2]); break;
+    case InputLog::VIEW_DISTANCE: updateViewDistance(values[0]); break;
+    case InputLog::ROTATION: setRotation(values[0], values[1], values[2]); break;
+    case InputLog::SCALE: setScale(values[0]); break;
+    case InputLog::SHADING_MODE: setShadingMode(static_cast<ShadingMode>(values[0])); break;
+    case InputLog::TOGGLE_STATS: toggleStats(); break;
+    case InputLog::TOGGLE_ANIMATION: toggleAnimation(); break;
+    default: break;
+    }
+}
+
+/**
+ * @brief MainView::onTimer
  *
- * @param Message
+ * Called at 60 Hz. Always repaints, unless rendering on demand: then it
+ * only repaints what animates or loads, and stops itself when idle.
  */
-void MainView::onMessageLogged( QOpenGLDebugMessage Message ) {
-    qDebug() << " → Log:" << Message;
+void MainView::onTimer()
+{
+    if (!renderOnDemand) {
+        update();
+        return;
+    }
+
+    if (animating)
+        dirty |= ANIMATION;
+    if (dirty)
+        update();
+    else
+        timer.stop();
 }
 
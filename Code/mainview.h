@@ -7,7 +7,6 @@
 #include <QMouseEvent>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions_3_3_Core>
-#include <QOpenGLDebugLogger>
 #include <QOpenGLShaderProgram>
 #include <QTimer>
 #include <QVector3D>
@@ -16,70 +15,86 @@
 #include <memory>
 #include <QMatrix4x4>
 
+#include "alloctracker.h"
+#include "framestats.h"
+#include "gldebug.h"
+#include "gpuprofiler.h"
+#include "initgraph.h"
+#include "inputlog.h"
 #include "object.h"
+#include "scenegenerator.h"
+#include "shaderbuilder.h"
+#include "shadercache.h"
+#include "shaderpermutations.h"
+#include "statsoverlay.h"
+#include "texturestreamer.h"
 
 class MainView : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core {
     Q_OBJECT
 
-    QOpenGLDebugLogger *debugLogger;
-    QTimer timer; // timer used for animation
-
-    QOpenGLShaderProgram normalShaderProgram,
-                         gouraudShaderProgram,
-                         phongShaderProgram;
-
-    // Uniforms for the normal shader.
-    GLint uniformModelViewTransformNormal;
-    GLint uniformProjectionTransformNormal;
-    GLint uniformNormalTransformNormal;
-
-    // Uniforms for the gouraud shader.
-    GLint uniformModelViewTransformGouraud;
-    GLint uniformProjectionTransformGouraud;
-    GLint uniformNormalTransformGouraud;
-
-    GLint uniformMaterialGouraud;
-    GLint uniformLightPositionGouraud;
-    GLint uniformLightColourGouraud;
+    // The benchmarks (benchmark.cpp, microbench.cpp) use the internals directly.
+    friend class Benchmark;
+    friend class MicroBench;
 
-    GLint uniformTextureSamplerGouraud;
-
-    // Uniforms for the phong shader.
-    GLint uniformModelViewTransformPhong;
-    GLint uniformProjectionTransformPhong;
-    GLint uniformNormalTransformPhong;
-
-    GLint uniformMaterialPhong;
-    GLint uniformLightPositionPhong;
-    GLint uniformLightColourPhong;
+    GlDebug glDebug;
+    QTimer timer; // timer used for animation
 
-    GLint uniformTextureSamplerPhong;
+    // Render on demand: repaint only when something visible changed, and
+    // stop the timer while nothing animates or loads.
+    enum DirtyFlag : quint32
+    {
+        SCENE = 1, CAMERA = 2, ANIMATION = 4, LOADING = 8
+    };
+    bool renderOnDemand = false;
+    bool animating = true; // toggled with space
+    quint32 dirty = SCENE;
 
-    GLuint numObjects;
+    // Every shading mode is a permutation of one uber-shader.
+    ShaderCache shaderCache;
+    ShaderBuilder shaderBuilder;
+    ShaderPermutations shaderPermutations;
 
-    // Buffers
+    // Buffers, one per mesh; objects refer to them by index.
+    GLuint numMeshes;
     GLuint *meshVAO;
     GLuint *meshVBO;
     GLuint *meshSize;
 
     // Texture
+    GLuint numTextures;
     GLuint *texturePtr;
+    TextureStreamer textureStreamer;
+
+    GpuProfiler gpuProfiler;
+    FrameStats frameStats;
+    StatsOverlay statsOverlay;
+    bool showStats = false; // toggled with S
+
+    // Simulation tick, the number of frames rendered so far.
+    quint32 tick = 0;
+    InputLog *recorder = nullptr;
+    quint32 recordStart = 0;
+    const InputLog *replay = nullptr;
+    quint32 replayStart = 0;
+    int replayCursor = 0;
+    AllocTracker::Counts frameAllocations = {0, 0}; // of the last paintGL, with ALLOC_TRACKING
 
     // Transform structures
-    Object *object;
+    SceneGenerator::Config sceneConfig;
+    QVector<Object> objects;
     float scale = 1.f;
     QVector3D rotation;
     QVector3D viewRotation;
     QMatrix4x4 projectionTransform;
     QMatrix4x4 viewTransform;
 
-    // Phong model constants.
-    QVector4D material = {0.5, 0.5, 1, 5};
+    // Phong model constants; the material is per object.
     QVector3D lightPosition = {1, 100, 1};
     QVector3D lightColour = {1, 1, 1};
 
     float mouseScale = 0.001;
     float zoom = -4;
+    float farPlane = 20;
 
 public:
     enum ShadingMode : GLuint
@@ -97,11 +112,31 @@ public:
     void setScale(int scale);
     void setShadingMode(ShadingMode shading);
 
+    // Without animation or loading, an on-demand view does no work at all.
+    void setRenderOnDemand(bool onDemand);
+    void setAnimating(bool animate);
+
+    // Replaces the preset objects by a generated scene; call before initializeGL.
+    void setScene(const SceneGenerator::Config &config);
+
+    // Records every view change into log, until stopRecording().
+    void startRecording(InputLog *log);
+    void stopRecording();
+    // Applies the events of log at their ticks, counted from the next frame.
+    void startReplay(const InputLog *log);
+    bool isReplaying() const;
+
+    // Counters of the last complete frame.
+    const FrameCounters &frameCounters() const;
+
+    // Blocks until asynchronous loading (shader builds, texture streaming) has finished.
+    void finishLoading();
+
 protected:
     void initializeGL();
     void resizeGL(int newWidth, int newHeight);
     void paintGL();
-    void loadObjects();
+    void loadObjects(InitGraph &startup);
 
     // Functions for keyboard input events
     void keyPressEvent(QKeyEvent *ev);
@@ -115,27 +150,44 @@ protected:
     void wheelEvent(QWheelEvent *ev);
 
 private slots:
-    void onMessageLogged( QOpenGLDebugMessage Message );
+    void onTimer();
 
 private:
-    void createShaderProgram();
-    void loadMesh(const char *path, GLuint idx);
+    void createShaderProgram(InitGraph &startup);
+    ShaderPermutations::Features shaderFeaturesFor(ShadingMode shading);
 
-    // Loads texture data into the buffer of texturePtr.
-    void loadTexture(QString file, GLuint texturePtr);
+    // Parsing runs on worker threads, uploading on the context thread.
+    static QVector<float> parseMesh(QString file);
+    void loadMesh(const QVector<float> &meshData, GLuint idx);
+
+    // Hands the decoded texture data of texturePtr to the streamer.
+    void loadTexture(TextureStreamer::MipChain mips, GLuint texturePtr);
 
     void destroyModelBuffers();
 
+    void markDirty(quint32 flags);
+    bool isLoading() const;
+
+    void advanceAnimation();
     void updateProjectionTransform();
     void updateModelTransforms();
     void updateViewTransform();
 
-    void updateNormalUniforms(GLuint idx);
-    void updateGouraudUniforms(GLuint idx);
-    void updatePhongUniforms(GLuint idx);
+    void updateUniforms(const ShaderVariant *variant, const Object &object);
+
+    void recordInput(InputLog::Action action, float x = 0, float y = 0, float z = 0);
+    void toggleStats();
+    void toggleAnimation();
+    void applyReplay();
+    void applyInputEvent(const InputLog::Event &event);
 
     // Useful utility method to convert image to bytes.
-    QVector<quint8> imageToBytes(QImage image);
+    static QVector<quint8> imageToBytes(QImage image);
+
+    // Decodes an image into a full mip chain for the texture streamer.
+    static TextureStreamer::MipChain decodeTexture(QString file);
+
+    static QByteArray readFile(QString file);
 
     // The current shader to use.
     ShadingMode currentShader = PHONG;
@@ -10,6 +10,11 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->setupUi(this);
 }
 
+MainView *MainWindow::mainView() const
+{
+    return ui->mainView;
+}
+
 MainWindow::~MainWindow()
 {
     delete ui;
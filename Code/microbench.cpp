@@ -0,0 +1,425 @@
+#include "alloctracker.h"
+#include "mainview.h"
+#include "model.h"
+#include "sinewaves.h"
+#include "watergrid.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <cmath>
+#include <functional>
+
+/**
+ * @brief The MicroBench class
+ *
+ * Times the CPU side of loading and animating the scene, without a GL
+ * context: OBJ loading and its separate steps, interleaving, unitizing,
+ * texture conversion and the per-frame transform composition. Next to the
+ * bundled files every case also runs on generated inputs of growing size,
+ * so superlinear costs (like the vertex deduplication in alignData) show up
+ * as a throughput that drops with the size.
+ *
+ * The water cases evaluate the sum-of-sines surface with SineWaves over
+ * growing WaterGrid resolutions and thread counts, after validating it
+ * against the double precision reference.
+ */
+class MicroBench
+{
+public:
+    struct Result
+    {
+        QString name;
+        QString input;
+        qint64 iterations;
+        double nsPerOp;
+        double itemsPerSecond;
+        double allocationsPerOp;
+        double bytesPerOp;
+    };
+
+    MicroBench(int maxGrid, int maxWaterGrid, int maxObjects, qint64 minTime)
+        : maxGrid(maxGrid), maxWaterGrid(maxWaterGrid), maxObjects(maxObjects), minTime(minTime) {}
+
+    bool run(QVector<Result> &results);
+
+    static QString toTable(const QVector<Result> &results);
+    static QString toCsv(const QVector<Result> &results);
+
+private:
+    void benchModel(const QString &input, const QString &file);
+    void benchImage(const QString &input, const QString &file);
+    void benchTransforms(int numObjects);
+    void benchSineWaves(int resolution, int threads);
+    bool validateSineWaves();
+
+    // Runs body until minTime has been spent in it; setup runs before every
+    // iteration and is neither timed nor counted.
+    void measure(const QString &name, const QString &input, qint64 items,
+                 const std::function<void()> &setup, const std::function<void()> &body);
+
+    static bool writeGrid(const QString &file, int size);
+    static Model copyOf(const Model &model);
+
+    int maxGrid;
+    int maxWaterGrid;
+    int maxObjects;
+    qint64 minTime; // milliseconds
+    QVector<Result> *results = nullptr;
+};
+
+bool MicroBench::run(QVector<Result> &results)
+{
+    this->results = &results;
+
+    QStringList models = QDir(":/models").entryList(QStringList() << "*.obj", QDir::Files, QDir::Name);
+    for (const QString &model : models)
+        benchModel(model, ":/models/" + model);
+
+    // Flat n x n vertex grids with texture coordinates.
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning() << ":: Could not create a temporary directory";
+        return false;
+    }
+    for (int size = 8; size <= maxGrid; size *= 2) {
+        QString file = dir.filePath(QString("grid%1.obj").arg(size));
+        if (!writeGrid(file, size)) {
+            qWarning() << ":: Could not write" << file;
+            return false;
+        }
+        benchModel(QString("grid %1x%1").arg(size), file);
+    }
+
+    QStringList textures = QDir(":/textures").entryList(QDir::Files, QDir::Name);
+    for (const QString &texture : textures)
+        benchImage(texture, ":/textures/" + texture);
+
+    for (int numObjects = 1; numObjects <= maxObjects; numObjects *= 10)
+        benchTransforms(numObjects);
+
+    if (!validateSineWaves())
+        return false;
+    QVector<int> threadCounts;
+    for (int threads = 1; threads < QThread::idealThreadCount(); threads *= 2)
+        threadCounts.append(threads);
+    threadCounts.append(QThread::idealThreadCount());
+    for (int resolution = 64; resolution <= maxWaterGrid; resolution *= 4) {
+        for (int threads : threadCounts)
+            benchSineWaves(resolution, threads);
+    }
+
+    this->results = nullptr;
+    return true;
+}
+
+void MicroBench::benchModel(const QString &input, const QString &file)
+{
+    Model loaded(file);
+    qint64 triangles = loaded.getNumTriangles();
+
+    measure("Model", input, triangles, nullptr, [&] {
+        Model model(file);
+        Q_UNUSED(model);
+    });
+
+    // State right after parsing, before the constructor unpacks and aligns.
+    Model parsed{QString()};
+    parsed.parse(file);
+    Model model = parsed;
+
+    measure("unpackIndexes", input, triangles, [&] {
+        model = copyOf(parsed);
+    }, [&] {
+        model.unpackIndexes();
+    });
+
+    measure("alignData", input, triangles, [&] {
+        model = copyOf(parsed);
+    }, [&] {
+        model.alignData();
+    });
+
+    // The unindexed arrays only exist for what the file provides.
+    if (loaded.hasNormals() && loaded.hasTextureCoords()) {
+        measure("getVNTInterleaved", input, triangles, nullptr, [&] {
+            QVector<float> buffer = loaded.getVNTInterleaved();
+            Q_UNUSED(buffer);
+        });
+    }
+
+    measure("getVNTInterleaved_indexed", input, triangles, nullptr, [&] {
+        QVector<float> buffer = loaded.getVNTInterleaved_indexed();
+        Q_UNUSED(buffer);
+    });
+
+    measure("unitize", input, triangles, [&] {
+        model = copyOf(loaded);
+    }, [&] {
+        model.unitize();
+    });
+}
+
+void MicroBench::benchImage(const QString &input, const QString &file)
+{
+    QImage image(file);
+    if (image.isNull()) {
+        qWarning() << ":: Could not load" << file;
+        return;
+    }
+
+    measure("imageToBytes", input, qint64(image.width()) * image.height(), nullptr, [&] {
+        QVector<quint8> pixels = MainView::imageToBytes(image);
+        Q_UNUSED(pixels);
+    });
+}
+
+/**
+ * @brief MicroBench::benchTransforms
+ *
+ * Composes the model transforms with the same steps as
+ * MainView::updateModelTransforms, for numObjects objects.
+ */
+void MicroBench::benchTransforms(int numObjects)
+{
+    QVector<Object> objects(numObjects);
+    for (int idx = 0; idx < numObjects; ++idx) {
+        objects[idx].position = QVector3D(idx * 2, 0, 0);
+        objects[idx].rotationSpeed = 1.0f + (idx % 7) * 0.1f;
+        objects[idx].scale = 1.0f;
+    }
+
+    measure("updateModelTransforms", QString("%1 objects").arg(numObjects), numObjects, nullptr, [&] {
+        for (int idx = 0; idx < numObjects; ++idx) {
+            Object &object = objects[idx];
+            object.rotation.setY(object.rotation.y() + object.rotationSpeed);
+
+            object.meshTransform.setToIdentity();
+            object.meshTransform.translate(object.position);
+            object.meshTransform.scale(object.scale);
+            object.meshTransform.rotate(QQuaternion::fromEulerAngles(object.rotation));
+        }
+    });
+}
+
+/**
+ * @brief MicroBench::benchSineWaves
+ *
+ * One frame of CPU waves over the vertices of a resolution x resolution
+ * water grid; items are vertices.
+ */
+void MicroBench::benchSineWaves(int resolution, int threads)
+{
+    SineWaves waves;
+    waves.setThreadCount(threads);
+    waves.setVertices(WaterGrid::generate(resolution, false).vertices);
+
+    float t = 0;
+    QString input = QString("%1x%1, %2 threads").arg(resolution).arg(threads);
+    measure("SineWaves::evaluate", input, waves.vertexCount(), nullptr, [&] {
+        waves.evaluate(t);
+        t += 2.0f / 60;
+    });
+}
+
+/**
+ * @brief MicroBench::validateSineWaves
+ *
+ * Compares heights and normals with SineWaves::height() over the first
+ * minutes of animation; the tolerance covers the float angle, which loses
+ * precision as t grows exactly like the shader does.
+ */
+bool MicroBench::validateSineWaves()
+{
+    const double tolerance = 1e-4;
+
+    SineWaves waves;
+    waves.setVertices(WaterGrid::generate(255, false).vertices);
+    const QVector<float> &vertices = waves.vertices();
+
+    double maxError = 0;
+    for (float t : { 0.0f, 1.0f, 37.5f, 600.0f }) {
+        waves.evaluate(t);
+        for (int idx = 0; idx < waves.vertexCount(); ++idx) {
+            const float *vertex = &vertices[8 * idx];
+            double slope;
+            double height = SineWaves::height(waves.waves(), vertex[0], t, &slope);
+            double inverseLength = 1 / std::sqrt(slope * slope + 1);
+            maxError = qMax(maxError, std::fabs(vertex[2] - height));
+            maxError = qMax(maxError, std::fabs(vertex[3] + slope * inverseLength));
+            maxError = qMax(maxError, std::fabs(vertex[5] - inverseLength));
+        }
+    }
+
+    if (maxError > tolerance) {
+        qWarning() << ":: SineWaves differs from the reference by" << maxError;
+        return false;
+    }
+    QTextStream(stderr) << "SineWaves matches the reference within " << maxError << "\n";
+    return true;
+}
+
+void MicroBench::measure(const QString &name, const QString &input, qint64 items,
+                         const std::function<void()> &setup, const std::function<void()> &body)
+{
+    // One untimed run to warm up caches and lazy initialisation.
+    if (setup)
+        setup();
+    body();
+
+    qint64 iterations = 0;
+    qint64 elapsed = 0;
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+    QElapsedTimer timer;
+
+    while (elapsed < minTime * 1000000 || iterations < 3) {
+        if (setup)
+            setup();
+
+        AllocTracker::Scope scope;
+        timer.start();
+        body();
+        elapsed += timer.nsecsElapsed();
+        AllocTracker::Counts counts = scope.counts();
+        allocations += counts.allocations;
+        bytes += counts.bytes;
+        ++iterations;
+    }
+
+    Result result;
+    result.name = name;
+    result.input = input;
+    result.iterations = iterations;
+    result.nsPerOp = double(elapsed) / iterations;
+    result.itemsPerSecond = elapsed > 0 ? items * iterations * 1e9 / elapsed : 0;
+    result.allocationsPerOp = double(allocations) / iterations;
+    result.bytesPerOp = double(bytes) / iterations;
+    results->append(result);
+
+    QTextStream(stderr) << name << " (" << input << "): " << result.nsPerOp / 1e3 << " us\n";
+}
+
+// --- Helpers
+
+bool MicroBench::writeGrid(const QString &file, int size)
+{
+    QFile out(file);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QTextStream obj(&out);
+    obj << "# generated " << size << "x" << size << " grid\n";
+    for (int y = 0; y != size; ++y) {
+        for (int x = 0; x != size; ++x) {
+            float u = float(x) / (size - 1);
+            float v = float(y) / (size - 1);
+            obj << "v " << u * 2 - 1 << ' ' << v * 2 - 1 << " 0\n";
+            obj << "vt " << u << ' ' << v << '\n';
+        }
+    }
+    obj << "vn 0 0 1\n";
+
+    // Two triangles per cell, OBJ indices count from 1.
+    for (int y = 0; y != size - 1; ++y) {
+        for (int x = 0; x != size - 1; ++x) {
+            int a = y * size + x + 1;
+            int b = a + 1;
+            int c = a + size;
+            int d = c + 1;
+            obj << "f " << a << '/' << a << "/1 " << b << '/' << b << "/1 " << d << '/' << d << "/1\n";
+            obj << "f " << a << '/' << a << "/1 " << d << '/' << d << "/1 " << c << '/' << c << "/1\n";
+        }
+    }
+    return obj.status() == QTextStream::Ok;
+}
+
+// A copy that shares no data with model, so detaching is not timed.
+Model MicroBench::copyOf(const Model &model)
+{
+    Model copy = model;
+    copy.vertices_indexed.detach();
+    copy.normals_indexed.detach();
+    copy.textureCoords_indexed.detach();
+    copy.indices.detach();
+    copy.vertices.detach();
+    copy.normals.detach();
+    copy.textureCoords.detach();
+    copy.normal_indices.detach();
+    copy.texcoord_indices.detach();
+    copy.norm.detach();
+    copy.tex.detach();
+    return copy;
+}
+
+QString MicroBench::toTable(const QVector<Result> &results)
+{
+    QString table;
+    QTextStream out(&table);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+
+    out << qSetFieldWidth(28) << left << "case" << qSetFieldWidth(24) << "input"
+        << right << qSetFieldWidth(12) << "iterations" << qSetFieldWidth(14) << "us/op"
+        << qSetFieldWidth(16) << "items/s" << qSetFieldWidth(12) << "allocs/op"
+        << qSetFieldWidth(14) << "bytes/op" << qSetFieldWidth(0) << '\n';
+    for (const Result &result : results) {
+        out << qSetFieldWidth(28) << left << result.name << qSetFieldWidth(24) << result.input << right
+            << qSetFieldWidth(12) << result.iterations
+            << qSetFieldWidth(14) << qSetRealNumberPrecision(2) << result.nsPerOp / 1e3
+            << qSetFieldWidth(16) << qSetRealNumberPrecision(0) << result.itemsPerSecond
+            << qSetFieldWidth(12) << qSetRealNumberPrecision(1) << result.allocationsPerOp
+            << qSetFieldWidth(14) << qSetRealNumberPrecision(0) << result.bytesPerOp
+            << qSetFieldWidth(0) << '\n';
+    }
+    return table;
+}
+
+QString MicroBench::toCsv(const QVector<Result> &results)
+{
+    QString csv;
+    QTextStream out(&csv);
+    out << "case,input,iterations,ns_per_op,items_per_s,allocs_per_op,bytes_per_op\n";
+    for (const Result &result : results) {
+        out << result.name << ",\"" << result.input << "\"," << result.iterations << ','
+            << result.nsPerOp << ',' << result.itemsPerSecond << ','
+            << result.allocationsPerOp << ',' << result.bytesPerOp << '\n';
+    }
+    return csv;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Model logs every load, which would flood the output.
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks of the CPU side of the animation and water scenes");
+    parser.addHelpOption();
+    QCommandLineOption gridOption("max-grid", "Largest generated grid, in vertices per side.", "size", "128");
+    QCommandLineOption waterGridOption("max-water-grid", "Largest water grid for the wave cases, in quads per side.",
+                                       "size", "1024");
+    QCommandLineOption objectsOption("max-objects", "Largest number of transformed objects.", "count", "1000000");
+    QCommandLineOption timeOption("min-time", "Minimum measured time per case.", "ms", "200");
+    QCommandLineOption formatOption("format", "Output format, table or csv.", "format", "table");
+    parser.addOptions({ gridOption, waterGridOption, objectsOption, timeOption, formatOption });
+    parser.process(app);
+
+    MicroBench bench(parser.value(gridOption).toInt(), parser.value(waterGridOption).toInt(),
+                     parser.value(objectsOption).toInt(), parser.value(timeOption).toLongLong());
+    QVector<MicroBench::Result> results;
+    if (!bench.run(results))
+        return 1;
+
+    QTextStream(stdout) << (parser.value(formatOption) == "csv" ? MicroBench::toCsv(results)
+                                                                : MicroBench::toTable(results));
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "model.h"
+#include "trace.h"
 
 #include <QDebug>
 #include <QFile>
@@ -29,45 +30,60 @@ struct Vertex {
 
 Model::Model(QString filename) {
     qDebug() << ":: Loading model:" << filename;
-    QFile file(filename);
-    if(file.open(QIODevice::ReadOnly)) {
-        QTextStream in(&file);
+    if (parse(filename)) {
+        // create an array version of the data
+        unpackIndexes();
 
-        QString line;
-        QStringList tokens;
+        // Allign all vertex indices with the right normal/texturecoord indices
+        alignData();
+    }
+}
 
-        while(!in.atEnd()) {
-            line = in.readLine();
-            if (line.startsWith("#")) continue; // skip comments
+/**
+ * @brief Model::parse
+ *
+ * Reads the vertices, normals, texture coordinates and faces of the file
+ * into the intermediate storage, without unpacking or aligning them.
+ *
+ * @return false when the file could not be opened
+ */
+bool Model::parse(QString filename) {
+    TRACE_SCOPE("obj parse");
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
 
-            tokens = line.split(" ", QString::SkipEmptyParts);
+    QTextStream in(&file);
 
-            // Switch depending on first element
-            if (tokens[0] == "v") {
-                parseVertex(tokens);
-            }
+    QString line;
+    QStringList tokens;
 
-            if (tokens[0] == "vn" ) {
-                parseNormal(tokens);
-            }
+    while(!in.atEnd()) {
+        line = in.readLine();
+        if (line.startsWith("#")) continue; // skip comments
 
-            if (tokens[0] == "vt" ) {
-                parseTexture(tokens);
-            }
+        tokens = line.split(" ", QString::SkipEmptyParts);
 
-            if (tokens[0] == "f" ) {
-                parseFace(tokens);
-            }
+        // Switch depending on first element
+        if (tokens[0] == "v") {
+            parseVertex(tokens);
         }
 
-        file.close();
+        if (tokens[0] == "vn" ) {
+            parseNormal(tokens);
+        }
 
-        // create an array version of the data
-        unpackIndexes();
+        if (tokens[0] == "vt" ) {
+            parseTexture(tokens);
+        }
 
-        // Allign all vertex indices with the right normal/texturecoord indices
-        alignData();
+        if (tokens[0] == "f" ) {
+            parseFace(tokens);
+        }
     }
+
+    file.close();
+    return true;
 }
 
 /**
@@ -282,6 +298,7 @@ void Model::parseFace(QStringList tokens) {
  * if vertex has multiple normals or texturecoords
  */
 void Model::alignData() {
+    TRACE_SCOPE("dedup");
     QVector<QVector3D> verts = QVector<QVector3D>();
     verts.reserve(vertices_indexed.size());
     QVector<QVector3D> norms = QVector<QVector3D>();
@@ -47,8 +47,11 @@ public:
     void unitize();
 
 private:
+    // The microbenchmarks time the parsing and alignment steps separately.
+    friend class MicroBench;
 
     // OBJ parsing
+    bool parse(QString filename);
     void parseVertex(QStringList tokens);
     void parseNormal(QStringList tokens);
     void parseTexture(QStringList tokens);
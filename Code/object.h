@@ -1,11 +1,18 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+
 struct Object {
+    QVector3D position;
     QVector3D rotation;
-    QMatrix3x3 meshNormalTransform;
     QMatrix4x4 meshTransform;
+    QVector4D material; // Phong ambient, diffuse, specular, exponent
     float rotationSpeed;
     float scale;
+    quint16 mesh;    // index into the meshes of MainView
+    quint16 texture; // index into the textures of MainView
 } ;
 #endif // OBJECT_H
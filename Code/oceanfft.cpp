@@ -0,0 +1,444 @@
+#include "oceanfft.h"
+
+#include "simulation.h"
+#include "trace.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QtMath>
+#include <cmath>
+#include <random>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+const float gravity = 9.81f;
+const float twoPi = 6.2831853f;
+// The period the phases are wrapped by, in double precision.
+const double period = 6.283185307179586;
+
+using Simulation::uniform;
+using Simulation::normal;
+
+// Wave number of FFT index idx: 0 .. n/2 - 1, then -n/2 .. -1.
+int waveNumber(int idx, int n)
+{
+    return idx < n / 2 ? idx : idx - n;
+}
+
+// a += w b and b = a - w b, over count floats of two rows.
+void butterfly(float *aRe, float *aIm, float *bRe, float *bIm, float wRe, float wIm, int count)
+{
+    int idx = 0;
+#ifdef __SSE2__
+    __m128 wr = _mm_set1_ps(wRe);
+    __m128 wi = _mm_set1_ps(wIm);
+    for (; idx + 4 <= count; idx += 4) {
+        __m128 br = _mm_loadu_ps(bRe + idx);
+        __m128 bi = _mm_loadu_ps(bIm + idx);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+        __m128 ar = _mm_loadu_ps(aRe + idx);
+        __m128 ai = _mm_loadu_ps(aIm + idx);
+        _mm_storeu_ps(bRe + idx, _mm_sub_ps(ar, tr));
+        _mm_storeu_ps(bIm + idx, _mm_sub_ps(ai, ti));
+        _mm_storeu_ps(aRe + idx, _mm_add_ps(ar, tr));
+        _mm_storeu_ps(aIm + idx, _mm_add_ps(ai, ti));
+    }
+#endif
+    for (; idx < count; ++idx) {
+        float tr = wRe * bRe[idx] - wIm * bIm[idx];
+        float ti = wRe * bIm[idx] + wIm * bRe[idx];
+        bRe[idx] = aRe[idx] - tr;
+        bIm[idx] = aIm[idx] - ti;
+        aRe[idx] += tr;
+        aIm[idx] += ti;
+    }
+}
+}
+
+OceanFft::OceanFft()
+{
+}
+
+OceanFft::~OceanFft()
+{
+    pool.waitForDone();
+    qDeleteAll(workers);
+}
+
+void OceanFft::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "ocean", "Displace the water with an FFT ocean of size x size wave components.", "size" },
+        { "ocean-patch", "Size of an ocean tile.", "metres" },
+        { "ocean-wind", "Wind speed over the ocean.", "m/s" },
+        { "ocean-choppiness", "Horizontal displacement of the ocean, 0 for none.", "factor" }
+    });
+}
+
+bool OceanFft::configure(const QCommandLineParser &parser, Config &config)
+{
+    if (parser.isSet("ocean"))
+        config.size = parser.value("ocean").toInt();
+    if (parser.isSet("ocean-patch"))
+        config.patchSize = parser.value("ocean-patch").toFloat();
+    if (parser.isSet("ocean-wind"))
+        config.windSpeed = parser.value("ocean-wind").toFloat();
+    if (parser.isSet("ocean-choppiness"))
+        config.choppiness = parser.value("ocean-choppiness").toFloat();
+
+    if (config.size < minSize || config.size > maxSize || (config.size & (config.size - 1))) {
+        qWarning() << ":: The ocean size must be a power of two between" << minSize << "and" << maxSize;
+        return false;
+    }
+    if (config.patchSize <= 0 || config.windSpeed <= 0 || config.choppiness < 0) {
+        qWarning() << ":: Invalid ocean configuration";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief OceanFft::initialize
+ *
+ * Draws h0(k) from the Phillips spectrum, scaled so the height has the
+ * configured standard deviation, which is sqrt(2 sum |h0|^2).
+ */
+void OceanFft::initialize(const Config &config, bool gl)
+{
+    TRACE_SCOPE("ocean spectrum");
+    settings = config;
+    n = config.size;
+    int count = n * n;
+
+    h0Re.resize(count);
+    h0Im.resize(count);
+    omega.resize(count);
+
+    float largest = config.windSpeed * config.windSpeed / gravity; // the largest wave from this wind
+    float smallest = largest / 1000;
+    float windX = std::cos(qDegreesToRadians(config.windDirection));
+    float windY = std::sin(qDegreesToRadians(config.windDirection));
+
+    std::mt19937 rng(config.seed);
+    double energy = 0;
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            int idx = y * n + x;
+            float kx = twoPi * waveNumber(x, n) / config.patchSize;
+            float ky = twoPi * waveNumber(y, n) / config.patchSize;
+            float k = std::sqrt(kx * kx + ky * ky);
+            float xi = normal(rng);
+            float eta = normal(rng);
+
+            // The Nyquist components have no negative partner, so they stay empty.
+            float phillips = 0;
+            if (k > 0 && x != n / 2 && y != n / 2) {
+                float alignment = (kx * windX + ky * windY) / k;
+                phillips = std::exp(-1 / (k * largest * k * largest)) / (k * k * k * k)
+                           * alignment * alignment * std::exp(-k * k * smallest * smallest);
+            }
+            float scale = std::sqrt(phillips / 2);
+            h0Re[idx] = xi * scale;
+            h0Im[idx] = eta * scale;
+            omega[idx] = std::sqrt(gravity * k);
+            energy += h0Re[idx] * h0Re[idx] + h0Im[idx] * h0Im[idx];
+        }
+    }
+    float normalization = energy > 0 ? config.rmsHeight / std::sqrt(2 * energy) : 0;
+    for (int idx = 0; idx < count; ++idx) {
+        h0Re[idx] *= normalization;
+        h0Im[idx] *= normalization;
+    }
+
+    int logN = 0;
+    while ((1 << logN) < n)
+        ++logN;
+    bitReversed.resize(n);
+    for (int idx = 0; idx < n; ++idx) {
+        int reversed = 0;
+        for (int bit = 0; bit < logN; ++bit)
+            reversed |= ((idx >> bit) & 1) << (logN - 1 - bit);
+        bitReversed[idx] = reversed;
+    }
+
+    // exp(+2 pi i j / n), the inverse transform.
+    twiddleRe.resize(n / 2);
+    twiddleIm.resize(n / 2);
+    for (int j = 0; j < n / 2; ++j) {
+        twiddleRe[j] = std::cos(twoPi * j / n);
+        twiddleIm[j] = std::sin(twoPi * j / n);
+    }
+
+    for (int field = 0; field < fields; ++field) {
+        re[field].resize(count);
+        im[field].resize(count);
+        scratchRe[field].resize(count);
+        scratchIm[field].resize(count);
+    }
+    displacementTexels.fill(0, 4 * count);
+    normalTexels.fill(0, 4 * count);
+
+    // Column slices are multiples of four floats, so every thread gets whole SSE registers.
+    slices = qBound(1, QThread::idealThreadCount(), n / minSize);
+    pool.setMaxThreadCount(qMax(1, slices - 1));
+    qDeleteAll(workers);
+    workers.resize(0);
+    for (int slice = 1; slice < slices; ++slice) {
+        Worker *worker = new Worker;
+        worker->setAutoDelete(false);
+        worker->ocean = this;
+        worker->slice = slice;
+        workers.append(worker);
+    }
+
+    qDebug() << ":: Ocean:" << n << "x" << n << "components over" << config.patchSize << "m,"
+             << slices << "threads";
+
+    if (!gl)
+        return;
+
+    initializeOpenGLFunctions();
+    glGenTextures(2, textures);
+
+    // Displacement is fetched in the vertex shader, which has no derivatives for mipmaps.
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, n, n, 0, GL_RGBA, GL_FLOAT, nullptr);
+
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, n, n, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    initialized = true;
+}
+
+void OceanFft::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteTextures(2, textures);
+    initialized = false;
+}
+
+/**
+ * @brief OceanFft::simulate
+ *
+ * The rows of the spectrum are written in bit-reversed order, and so are
+ * the rows of the transpose, so both column passes start in place.
+ */
+void OceanFft::simulate(double t)
+{
+    TRACE_SCOPE("ocean fft");
+    this->t = t;
+
+    runStage(SPECTRUM);
+    runStage(COLUMNS);
+    runStage(TRANSPOSE);
+    for (int field = 0; field < fields; ++field) {
+        re[field].swap(scratchRe[field]);
+        im[field].swap(scratchIm[field]);
+    }
+    runStage(COLUMNS);
+    runStage(OUTPUT);
+}
+
+qint64 OceanFft::update(double t)
+{
+    simulate(t);
+
+    TRACE_SCOPE("ocean upload");
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, displacementTexels.constData());
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, normalTexels.constData());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return (displacementTexels.size() + normalTexels.size()) * sizeof(float);
+}
+
+void OceanFft::bind(int displacementUnit, int normalUnit)
+{
+    glActiveTexture(GL_TEXTURE0 + displacementUnit);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glActiveTexture(GL_TEXTURE0 + normalUnit);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+const OceanFft::Config &OceanFft::config() const
+{
+    return settings;
+}
+
+const QVector<float> &OceanFft::displacement() const
+{
+    return displacementTexels;
+}
+
+const QVector<float> &OceanFft::normals() const
+{
+    return normalTexels;
+}
+
+float OceanFft::amplitude() const
+{
+    return 3 * settings.rmsHeight / settings.patchSize;
+}
+
+// --- Helpers
+
+void OceanFft::Worker::run()
+{
+    ocean->runSlice(ocean->stage, slice);
+    ocean->finished.release();
+}
+
+// Runs slice 0 on the calling thread and waits for the others.
+void OceanFft::runStage(Stage stage)
+{
+    this->stage = stage;
+    for (Worker *worker : workers)
+        pool.start(worker);
+    runSlice(stage, 0);
+    finished.acquire(workers.size());
+}
+
+void OceanFft::runSlice(Stage stage, int slice)
+{
+    int first = slice * n / slices;
+    int end = (slice + 1) * n / slices;
+
+    switch (stage) {
+    case SPECTRUM: evaluateSpectrum(first, end); break;
+    case COLUMNS: transformColumns(slice * (n / 4) / slices * 4, (slice + 1) * (n / 4) / slices * 4); break;
+    case TRANSPOSE: transpose(first, end); break;
+    case OUTPUT: writeOutput(first, end); break;
+    }
+}
+
+/**
+ * @brief OceanFft::evaluateSpectrum
+ *
+ * h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t). The slopes are
+ * i k h and the choppy displacement -i k / |k| h; they are packed as
+ * (height, slope x), (slope y, displacement x) and (displacement y, 0).
+ * w t is wrapped into [-pi, pi) in double precision before the float sine,
+ * which would lose the angle to rounding after hours.
+ */
+void OceanFft::evaluateSpectrum(int firstRow, int endRow)
+{
+    for (int y = firstRow; y < endRow; ++y) {
+        float ky = twoPi * waveNumber(y, n) / settings.patchSize;
+        int row = bitReversed[y] * n;
+        int negativeRow = ((n - y) % n) * n;
+
+        for (int x = 0; x < n; ++x) {
+            int idx = y * n + x;
+            int negative = negativeRow + (n - x) % n;
+            float kx = twoPi * waveNumber(x, n) / settings.patchSize;
+            float k = std::sqrt(kx * kx + ky * ky);
+
+            float angle = static_cast<float>(std::remainder(omega[idx] * t, period));
+            float c = std::cos(angle);
+            float s = std::sin(angle);
+            float a = h0Re[idx], b = h0Im[idx];
+            float p = h0Re[negative], q = h0Im[negative];
+            float hRe = (a + p) * c - (b + q) * s;
+            float hIm = (a - p) * s + (b - q) * c;
+
+            float dirX = k > 0 ? kx / k : 0;
+            float dirY = k > 0 ? ky / k : 0;
+
+            int out = row + x;
+            re[0][out] = hRe - kx * hRe;
+            im[0][out] = hIm - kx * hIm;
+            re[1][out] = -ky * hIm + dirX * hRe;
+            im[1][out] = ky * hRe + dirX * hIm;
+            re[2][out] = dirY * hIm;
+            im[2][out] = -dirY * hRe;
+        }
+    }
+}
+
+// Inverse radix-2 transform of every column in [firstColumn, endColumn), in place.
+void OceanFft::transformColumns(int firstColumn, int endColumn)
+{
+    int count = endColumn - firstColumn;
+    for (int field = 0; field < fields; ++field) {
+        float *fieldRe = re[field].data() + firstColumn;
+        float *fieldIm = im[field].data() + firstColumn;
+
+        for (int span = 2; span <= n; span *= 2) {
+            int half = span / 2;
+            int stride = n / span;
+            for (int base = 0; base < n; base += span) {
+                for (int j = 0; j < half; ++j) {
+                    int a = (base + j) * n;
+                    int b = a + half * n;
+                    butterfly(fieldRe + a, fieldIm + a, fieldRe + b, fieldIm + b,
+                              twiddleRe[j * stride], twiddleIm[j * stride], count);
+                }
+            }
+        }
+    }
+}
+
+// Writes rows [firstRow, endRow) of the bit-reversed transpose into the scratch fields.
+void OceanFft::transpose(int firstRow, int endRow)
+{
+    for (int field = 0; field < fields; ++field) {
+        const float *fromRe = re[field].constData();
+        const float *fromIm = im[field].constData();
+        float *toRe = scratchRe[field].data();
+        float *toIm = scratchIm[field].data();
+
+        for (int row = firstRow; row < endRow; ++row) {
+            int column = bitReversed[row];
+            for (int idx = 0; idx < n; ++idx) {
+                toRe[row * n + idx] = fromRe[idx * n + column];
+                toIm[row * n + idx] = fromIm[idx * n + column];
+            }
+        }
+    }
+}
+
+// After the second pass the fields are stored x-major; the texels are y-major.
+void OceanFft::writeOutput(int firstRow, int endRow)
+{
+    float toPatch = 1 / settings.patchSize;
+    float choppiness = settings.choppiness;
+
+    for (int y = firstRow; y < endRow; ++y) {
+        for (int x = 0; x < n; ++x) {
+            int idx = x * n + y;
+            float height = re[0][idx];
+            float slopeX = im[0][idx];
+            float slopeY = re[1][idx];
+            float *displacement = &displacementTexels[4 * (y * n + x)];
+            displacement[0] = choppiness * im[1][idx] * toPatch;
+            displacement[1] = choppiness * re[2][idx] * toPatch;
+            displacement[2] = height * toPatch;
+            displacement[3] = 0;
+
+            float length = std::sqrt(slopeX * slopeX + slopeY * slopeY + 1);
+            float *normal = &normalTexels[4 * (y * n + x)];
+            normal[0] = -slopeX / length;
+            normal[1] = -slopeY / length;
+            normal[2] = 1 / length;
+            normal[3] = 0;
+        }
+    }
+}
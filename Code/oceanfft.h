@@ -0,0 +1,125 @@
+#ifndef OCEANFFT_H
+#define OCEANFFT_H
+
+#include <QCommandLineParser>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+
+/**
+ * @brief The OceanFft class
+ *
+ * A Tessendorf ocean: a Phillips spectrum of size x size wave components is
+ * animated by the deep water dispersion relation and brought back to a
+ * height field, choppy horizontal displacement and slopes with an inverse
+ * 2D FFT every frame. The result tiles seamlessly and is uploaded as two
+ * RGBA float textures, which WAVES_FFT in the uber shaders samples once per
+ * vertex and fragment, so the number of components does not change the
+ * shading cost.
+ *
+ * The five real fields are packed in pairs into three complex transforms,
+ * which is exact because each of them has a Hermitian spectrum. A 2D
+ * transform is a 1D transform down the columns, a transpose and another one
+ * down the columns. Down the columns, every butterfly combines two whole
+ * rows with one twiddle factor, so the inner loop runs over contiguous
+ * floats in SSE registers. Every stage is split over the threads of a
+ * private pool.
+ *
+ * Distances are in metres on the CPU. The textures hold them as fractions
+ * of the patch, so the shader scales them to any tile size.
+ *
+ * initialize(), destroy(), update() and bind() must be called with the GL
+ * context current.
+ */
+class OceanFft : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Config
+    {
+        int size = 128;            // wave components per side, a power of two
+        float patchSize = 64;      // metres per tile
+        float windSpeed = 10;      // metres per second
+        float windDirection = 0;   // degrees from +x
+        float rmsHeight = 1.5f;    // metres; about the height of the six sines at 2 units per tile
+        float choppiness = 1;      // 0 for pure height displacement
+        quint32 seed = 1;
+    };
+
+    static const int minSize = 16;
+    static const int maxSize = 1024;
+
+    OceanFft();
+    ~OceanFft();
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills config from the options added by addOptions().
+    static bool configure(const QCommandLineParser &parser, Config &config);
+
+    // Generates the initial spectrum, and the textures unless gl is false.
+    void initialize(const Config &config, bool gl = true);
+    void destroy();
+
+    // Evaluates the ocean at time t, in seconds.
+    void simulate(double t);
+    // Simulates and uploads the textures. Returns the bytes uploaded.
+    qint64 update(double t);
+    void bind(int displacementUnit, int normalUnit);
+
+    const Config &config() const;
+    // Per texel x, y, z displacement and the normal, as fractions of the patch.
+    const QVector<float> &displacement() const;
+    const QVector<float> &normals() const;
+    // Three times the standard deviation of the height, as a fraction of the patch.
+    float amplitude() const;
+
+private:
+    enum Stage
+    {
+        SPECTRUM = 0, COLUMNS, TRANSPOSE, OUTPUT
+    };
+
+    class Worker : public QRunnable
+    {
+    public:
+        OceanFft *ocean = nullptr;
+        int slice = 0;
+        void run() override;
+    };
+
+    void runStage(Stage stage);
+    void runSlice(Stage stage, int slice);
+
+    void evaluateSpectrum(int firstRow, int endRow);
+    void transformColumns(int firstColumn, int endColumn);
+    void transpose(int firstRow, int endRow);
+    void writeOutput(int firstRow, int endRow);
+
+    Config settings;
+    int n = 0;
+    double t = 0;
+
+    // Initial amplitudes h0(k) and angular frequencies, in FFT order.
+    QVector<float> h0Re, h0Im, omega;
+    QVector<int> bitReversed;
+    QVector<float> twiddleRe, twiddleIm;
+    // Three packed complex fields and the transpose scratch.
+    static const int fields = 3;
+    QVector<float> re[fields], im[fields];
+    QVector<float> scratchRe[fields], scratchIm[fields];
+
+    QVector<float> displacementTexels;
+    QVector<float> normalTexels;
+
+    QThreadPool pool;
+    QVector<Worker *> workers; // one per slice but the first, run by the caller
+    QSemaphore finished;
+    Stage stage = SPECTRUM;
+    int slices = 1;
+
+    bool initialized = false;
+    GLuint textures[2] = { 0, 0 };
+};
+
+#endif // OCEANFFT_H
@@ -0,0 +1,290 @@
+#include "ripples.h"
+
+#include "trace.h"
+
+#include <QDebug>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+const float pi = 3.14159265f;
+const float maxCoefficient = 0.5f;
+}
+
+Ripples::Ripples()
+{
+}
+
+void Ripples::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "ripples", "Simulate ripples on a height field of resolution x resolution cells.", "resolution" },
+        { "ripples-cpu", "Simulate the ripples on the CPU instead of the GPU." },
+        { "ripple-rate", "Ripple simulation steps per unit of scene time.", "steps" }
+    });
+}
+
+bool Ripples::configure(const QCommandLineParser &parser, Config &config)
+{
+    if (parser.isSet("ripples"))
+        config.resolution = parser.value("ripples").toInt();
+    if (parser.isSet("ripple-rate"))
+        config.stepRate = parser.value("ripple-rate").toFloat();
+    config.gpu = !parser.isSet("ripples-cpu");
+
+    if (config.resolution < minResolution || config.resolution > maxResolution) {
+        qWarning() << ":: The ripple resolution must be between" << minResolution << "and" << maxResolution;
+        return false;
+    }
+    if (config.stepRate <= 0) {
+        qWarning() << ":: Invalid ripple step rate";
+        return false;
+    }
+    return true;
+}
+
+void Ripples::initialize(const Config &config)
+{
+    initializeOpenGLFunctions();
+    settings = config;
+    int n = settings.resolution;
+
+    // Steps short enough that a wave crosses at most 0.7 cells per step.
+    float cell = 2.0f / n;
+    float minRate = settings.waveSpeed / (cell * std::sqrt(maxCoefficient));
+    if (settings.stepRate < minRate) {
+        qDebug() << ":: Ripple step rate raised to" << minRate << "for stability";
+        settings.stepRate = minRate;
+    }
+    float courant = settings.waveSpeed / (settings.stepRate * cell);
+    coefficient = courant * courant;
+    time = 0;
+    current = 0;
+    pending.reserve(maxImpulses);
+    impulseData.reserve(4 * maxImpulses);
+
+    glGenTextures(2, textures);
+    for (int idx = 0; idx < (settings.gpu ? 2 : 1); ++idx) {
+        glBindTexture(GL_TEXTURE_2D, textures[idx]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        QVector<float> zero(n * n * (settings.gpu ? 2 : 1), 0.0f);
+        if (settings.gpu)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, n, n, 0, GL_RG, GL_FLOAT, zero.constData());
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, n, n, 0, GL_RED, GL_FLOAT, zero.constData());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (settings.gpu) {
+        program.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/vertshader_ripple.glsl");
+        program.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshader_ripple.glsl");
+        if (!program.link())
+            qWarning() << ":: Could not link the ripple shaders";
+        uniformState = program.uniformLocation("state");
+        uniformCoefficient = program.uniformLocation("coefficient");
+        uniformDamping = program.uniformLocation("damping");
+        uniformImpulseCount = program.uniformLocation("impulseCount");
+        uniformImpulses = program.uniformLocation("impulses");
+
+        // The full-screen triangle comes from gl_VertexID, but core profile draws need a VAO.
+        glGenVertexArrays(1, &vao);
+        // Whoever draws may not draw to framebuffer 0, the benchmark for one.
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glGenFramebuffers(2, framebuffers);
+        for (int idx = 0; idx < 2; ++idx) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[idx]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[idx], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                qWarning() << ":: The ripple framebuffer is incomplete";
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        for (QVector<float> &buffer : cells)
+            buffer.clear();
+    } else {
+        for (QVector<float> &buffer : cells)
+            buffer.fill(0, n * n);
+    }
+    initialized = true;
+}
+
+void Ripples::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteTextures(2, textures);
+    if (settings.gpu) {
+        glDeleteFramebuffers(2, framebuffers);
+        glDeleteVertexArrays(1, &vao);
+    }
+    initialized = false;
+}
+
+void Ripples::addImpulse(float x, float y, float radius, float strength)
+{
+    if (pending.size() < maxImpulses)
+        pending.append({ x, y, radius, strength });
+}
+
+/**
+ * @brief Ripples::update
+ *
+ * On the GPU the steps render into the ripple framebuffers, so the bound
+ * framebuffer and viewport are put back afterwards.
+ */
+qint64 Ripples::update(double t)
+{
+    TRACE_GL_SCOPE("ripples");
+    double step = 1.0 / settings.stepRate;
+    if (t < time)
+        time = t;
+    // Bounded in double: after a jump of days the step count does not fit an int.
+    lastSteps = static_cast<int>(qBound(0.0, (t - time) / step, double(maxStepsPerUpdate)));
+    time = lastSteps < maxStepsPerUpdate ? time + lastSteps * step : t;
+    if (lastSteps == 0)
+        return 0;
+
+    if (!settings.gpu) {
+        for (int idx = 0; idx < lastSteps; ++idx)
+            stepCpu(idx == 0);
+        pending.resize(0);
+
+        int n = settings.resolution;
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RED, GL_FLOAT, cells[current].constData());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return qint64(n) * n * sizeof(float);
+    }
+
+    GLint framebuffer = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    program.bind();
+    glUniform1i(uniformState, 0);
+    glUniform1f(uniformCoefficient, coefficient);
+    glUniform1f(uniformDamping, settings.damping);
+    glViewport(0, 0, settings.resolution, settings.resolution);
+    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE0);
+    for (int idx = 0; idx < lastSteps; ++idx)
+        stepGpu(idx == 0);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    program.release();
+    pending.resize(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    return 0;
+}
+
+void Ripples::bind(int unit)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, textures[settings.gpu ? current : 0]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+const Ripples::Config &Ripples::config() const
+{
+    return settings;
+}
+
+int Ripples::steps() const
+{
+    return lastSteps;
+}
+
+const QVector<float> &Ripples::heights() const
+{
+    return cells[current];
+}
+
+// --- Helpers
+
+// The border cells stay at 0, a fixed edge that reflects the waves.
+void Ripples::stepCpu(bool impulses)
+{
+    int n = settings.resolution;
+    const float *height = cells[current].constData();
+    float *next = cells[1 - current].data(); // holds the previous height until overwritten
+
+    for (int y = 1; y + 1 < n; ++y) {
+        int idx = y * n + 1;
+        int end = y * n + n - 1;
+#ifdef __SSE2__
+        __m128 damping = _mm_set1_ps(settings.damping);
+        __m128 a = _mm_set1_ps(coefficient);
+        __m128 four = _mm_set1_ps(4);
+        for (; idx + 4 <= end; idx += 4) {
+            __m128 h = _mm_loadu_ps(height + idx);
+            __m128 neighbours = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(height + idx - 1), _mm_loadu_ps(height + idx + 1)),
+                                           _mm_add_ps(_mm_loadu_ps(height + idx - n), _mm_loadu_ps(height + idx + n)));
+            __m128 laplacian = _mm_sub_ps(neighbours, _mm_mul_ps(four, h));
+            __m128 velocity = _mm_sub_ps(h, _mm_loadu_ps(next + idx));
+            _mm_storeu_ps(next + idx, _mm_add_ps(_mm_add_ps(h, _mm_mul_ps(damping, velocity)), _mm_mul_ps(a, laplacian)));
+        }
+#endif
+        for (; idx < end; ++idx) {
+            float h = height[idx];
+            float laplacian = height[idx - 1] + height[idx + 1] + height[idx - n] + height[idx + n] - 4 * h;
+            next[idx] = h + settings.damping * (h - next[idx]) + coefficient * laplacian;
+        }
+    }
+
+    current = 1 - current;
+    if (impulses)
+        applyImpulses(cells[current].data());
+}
+
+void Ripples::stepGpu(bool impulses)
+{
+    impulseData.resize(0);
+    if (impulses) {
+        for (const Impulse &impulse : pending) {
+            impulseData.append(impulse.x);
+            impulseData.append(impulse.y);
+            impulseData.append(impulse.radius);
+            impulseData.append(impulse.strength);
+        }
+    }
+    glUniform1i(uniformImpulseCount, impulseData.size() / 4);
+    if (!impulseData.isEmpty())
+        glUniform4fv(uniformImpulses, impulseData.size() / 4, impulseData.constData());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1 - current]);
+    glBindTexture(GL_TEXTURE_2D, textures[current]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    current = 1 - current;
+}
+
+// Adds the pending bumps to the interior cells, as fragshader_ripple.glsl does.
+void Ripples::applyImpulses(float *height)
+{
+    int n = settings.resolution;
+    float cell = 2.0f / n;
+    for (const Impulse &impulse : pending) {
+        int x0 = qMax(1, static_cast<int>((impulse.x - impulse.radius + 1) / cell));
+        int x1 = qMin(n - 2, static_cast<int>((impulse.x + impulse.radius + 1) / cell));
+        int y0 = qMax(1, static_cast<int>((impulse.y - impulse.radius + 1) / cell));
+        int y1 = qMin(n - 2, static_cast<int>((impulse.y + impulse.radius + 1) / cell));
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float dx = (x + 0.5f) * cell - 1 - impulse.x;
+                float dy = (y + 0.5f) * cell - 1 - impulse.y;
+                float distance = std::sqrt(dx * dx + dy * dy);
+                if (distance < impulse.radius)
+                    height[y * n + x] += impulse.strength * 0.5f * (1 + std::cos(pi * distance / impulse.radius));
+            }
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef RIPPLES_H
+#define RIPPLES_H
+
+#include <QCommandLineParser>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector>
+
+/**
+ * @brief The Ripples class
+ *
+ * A height field over the [-1, 1] water grid that follows the discrete
+ * wave equation, so clicks and floating objects leave rings that spread,
+ * reflect off the fixed border and fade. RIPPLES in the uber vertex shader
+ * adds the height to whatever else displaces the surface, and bends the
+ * normal by its slope.
+ *
+ * Every step computes
+ *
+ *     next = h + damping (h - previous) + a (sum of the four neighbours - 4 h)
+ *
+ * with a = (speed dt / dx)^2, kept at or below 0.5 for stability by raising
+ * the step rate if needed. Steps are a fixed 1 / stepRate of the scene time
+ * apart, whatever the frame rate, and one update() takes at most
+ * maxStepsPerUpdate of them; a simulation that falls further behind skips
+ * ahead.
+ *
+ * Impulses are batched until the next step, which adds a cosine bump for
+ * each of them. On the GPU a step is a full-screen pass from one RG32F
+ * texture (height, previous height) into the other, with two framebuffers
+ * ping-ponging. On the CPU a step runs over the rows four cells at a time
+ * with SSE2 and the height is uploaded to an R32F texture after the steps.
+ *
+ * initialize(), destroy(), update() and bind() must be called with the GL
+ * context current.
+ */
+class Ripples : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Config
+    {
+        int resolution = 256;    // cells per side
+        float stepRate = 120;    // steps per unit of t
+        float waveSpeed = 0.5f;  // grid units per unit of t
+        float damping = 0.996f;  // of the velocity, per step
+        bool gpu = true;
+    };
+
+    struct Impulse
+    {
+        float x, y;     // grid units
+        float radius;   // grid units
+        float strength; // height added at the centre
+    };
+
+    static const int minResolution = 16;
+    static const int maxResolution = 2048;
+    static const int maxImpulses = 16;  // per step; more are dropped
+    static const int maxStepsPerUpdate = 8;
+
+    Ripples();
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills config from the options added by addOptions().
+    static bool configure(const QCommandLineParser &parser, Config &config);
+
+    void initialize(const Config &config);
+    void destroy();
+
+    void addImpulse(float x, float y, float radius, float strength);
+    // Steps up to time t. Returns the bytes uploaded.
+    qint64 update(double t);
+    void bind(int unit);
+
+    const Config &config() const;
+    // Steps taken by the last update().
+    int steps() const;
+    // The height on the CPU, row by row from y = -1; empty on the GPU.
+    const QVector<float> &heights() const;
+
+private:
+    void stepCpu(bool impulses);
+    void stepGpu(bool impulses);
+    void applyImpulses(float *height);
+
+    Config settings;
+    float coefficient = 0;
+    double time = 0;
+    int lastSteps = 0;
+    QVector<Impulse> pending;
+
+    // CPU: the current height and the previous one, which a step overwrites with the next.
+    QVector<float> cells[2];
+    int current = 0;
+
+    bool initialized = false;
+    QOpenGLShaderProgram program;
+    GLint uniformState = -1;
+    GLint uniformCoefficient = -1;
+    GLint uniformDamping = -1;
+    GLint uniformImpulseCount = -1;
+    GLint uniformImpulses = -1;
+    GLuint vao = 0;
+    GLuint textures[2] = { 0, 0 };
+    GLuint framebuffers[2] = { 0, 0 };
+    QVector<float> impulseData;
+};
+
+#endif // RIPPLES_H
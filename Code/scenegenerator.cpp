@@ -0,0 +1,213 @@
+#include "scenegenerator.h"
+
+#include "simulation.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QSettings>
+#include <cmath>
+#include <random>
+
+namespace {
+using Simulation::uniform;
+using Simulation::normal;
+
+int gridSide(int objects)
+{
+    return qMax(1, static_cast<int>(std::ceil(std::cbrt(static_cast<double>(objects)) - 1e-9)));
+}
+}
+
+void SceneGenerator::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "scene", "Read the scene configuration from an ini file.", "file" },
+        { "layout", "Scene layout: preset, grid, random or clustered.", "layout" },
+        { "objects", "Number of generated objects.", "count" },
+        { "seed", "Seed of the scene generator.", "seed" },
+        { "spacing", "Distance between grid neighbours, sets the density of the other layouts.", "units" },
+        { "clusters", "Number of clusters of the clustered layout.", "count" }
+    });
+}
+
+bool SceneGenerator::configure(const QCommandLineParser &parser, Config &config)
+{
+    if (parser.isSet("scene") && !load(parser.value("scene"), config))
+        return false;
+
+    if (parser.isSet("layout") && !parseLayout(parser.value("layout"), config.layout))
+        return false;
+    if (parser.isSet("objects"))
+        config.objects = parser.value("objects").toInt();
+    if (parser.isSet("seed"))
+        config.seed = parser.value("seed").toUInt();
+    if (parser.isSet("spacing"))
+        config.spacing = parser.value("spacing").toFloat();
+    if (parser.isSet("clusters"))
+        config.clusters = parser.value("clusters").toInt();
+
+    // Asking for a number of objects implies a generated scene.
+    if (parser.isSet("objects") && config.layout == PRESET)
+        config.layout = GRID;
+
+    if (config.layout != PRESET && (config.objects < 1 || config.objects > maxObjects)) {
+        qWarning() << ":: The number of objects must be between 1 and" << maxObjects;
+        return false;
+    }
+    if (config.spacing <= 0 || config.clusters < 1 || config.minScale > config.maxScale) {
+        qWarning() << ":: Invalid scene configuration";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief SceneGenerator::load
+ *
+ * Reads the [scene] group of an ini file; missing keys keep their value.
+ *
+ *   [scene]
+ *   layout=clustered
+ *   objects=100000
+ *   seed=7
+ *   spacing=2
+ *   clusters=16
+ *   clusterRadius=5
+ *   minScale=0.3
+ *   maxScale=1.2
+ *   maxRotationSpeed=2
+ */
+bool SceneGenerator::load(const QString &file, Config &config)
+{
+    if (!QFileInfo(file).isReadable()) {
+        qWarning() << ":: Could not read scene configuration" << file;
+        return false;
+    }
+
+    QSettings settings(file, QSettings::IniFormat);
+    settings.beginGroup("scene");
+    if (settings.contains("layout") && !parseLayout(settings.value("layout").toString(), config.layout))
+        return false;
+    config.objects = settings.value("objects", config.objects).toInt();
+    config.seed = settings.value("seed", config.seed).toUInt();
+    config.spacing = settings.value("spacing", config.spacing).toFloat();
+    config.clusters = settings.value("clusters", config.clusters).toInt();
+    config.clusterRadius = settings.value("clusterRadius", config.clusterRadius).toFloat();
+    config.minScale = settings.value("minScale", config.minScale).toFloat();
+    config.maxScale = settings.value("maxScale", config.maxScale).toFloat();
+    config.maxRotationSpeed = settings.value("maxRotationSpeed", config.maxRotationSpeed).toFloat();
+    settings.endGroup();
+
+    if (settings.status() != QSettings::NoError) {
+        qWarning() << ":: Malformed scene configuration" << file;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief SceneGenerator::generate
+ *
+ * Generated objects are spread over a cube of cbrt(objects) * spacing
+ * around the origin, so the density stays the same as the count grows.
+ */
+QVector<Object> SceneGenerator::generate(const Config &config, int numMeshes, int numTextures)
+{
+    QVector<Object> objects;
+
+    if (config.layout == PRESET) {
+        // Two cats and two spheres in a row, as the scene always was.
+        const float speeds[] = { 1.5, 1.0, 1.0, 1.3 };
+        const float scales[] = { 1.2, 0.5, 1.1, 0.9 };
+        const quint16 meshes[] = { 0, 0, 1, 1 };
+        objects.resize(4);
+        for (int idx = 0; idx < 4; ++idx) {
+            Object &object = objects[idx];
+            object.position = QVector3D(idx * 2, 0, 0);
+            object.material = QVector4D(0.5, 0.5, 1, 5);
+            object.rotationSpeed = speeds[idx];
+            object.scale = scales[idx];
+            object.mesh = qMin<int>(meshes[idx], numMeshes - 1);
+            object.texture = qMin(idx, numTextures - 1);
+        }
+        return objects;
+    }
+
+    std::mt19937 rng(config.seed);
+    int side = gridSide(config.objects);
+    float half = 0.5f * side * config.spacing;
+
+    QVector<QVector3D> centres;
+    if (config.layout == CLUSTERED) {
+        for (int cluster = 0; cluster < config.clusters; ++cluster)
+            centres.append(QVector3D(uniform(rng, -half, half), uniform(rng, -half, half), uniform(rng, -half, half)));
+    }
+
+    objects.resize(config.objects);
+    for (int idx = 0; idx < config.objects; ++idx) {
+        Object &object = objects[idx];
+
+        switch (config.layout) {
+        case GRID:
+            object.position = QVector3D(idx % side, (idx / side) % side, idx / (side * side));
+            object.position = (object.position - QVector3D(side - 1, side - 1, side - 1) * 0.5f) * config.spacing;
+            break;
+        case RANDOM:
+            object.position = QVector3D(uniform(rng, -half, half), uniform(rng, -half, half), uniform(rng, -half, half));
+            break;
+        case CLUSTERED: {
+            const QVector3D &centre = centres[rng() % centres.size()];
+            object.position = centre + QVector3D(normal(rng), normal(rng), normal(rng)) * config.clusterRadius;
+            break;
+        }
+        case PRESET:
+            break;
+        }
+
+        object.rotation = QVector3D(uniform(rng, 0, 360), uniform(rng, 0, 360), uniform(rng, 0, 360));
+        object.rotationSpeed = uniform(rng, -config.maxRotationSpeed, config.maxRotationSpeed);
+        object.scale = uniform(rng, config.minScale, config.maxScale);
+        object.material = QVector4D(uniform(rng, 0.1, 0.6), uniform(rng, 0.3, 0.9),
+                                    uniform(rng, 0, 1), uniform(rng, 2, 64));
+        object.mesh = rng() % numMeshes;
+        object.texture = rng() % numTextures;
+    }
+    return objects;
+}
+
+float SceneGenerator::radius(const Config &config)
+{
+    if (config.layout == PRESET)
+        return 6;
+
+    float half = 0.5f * gridSide(config.objects) * config.spacing;
+    float radius = half * std::sqrt(3.0f) + config.maxScale;
+    if (config.layout == CLUSTERED)
+        radius += 3 * config.clusterRadius;
+    return radius;
+}
+
+QString SceneGenerator::layoutName(Layout layout)
+{
+    switch (layout) {
+    case PRESET: return "preset";
+    case GRID: return "grid";
+    case RANDOM: return "random";
+    case CLUSTERED: return "clustered";
+    }
+    return QString();
+}
+
+// --- Helpers
+
+bool SceneGenerator::parseLayout(const QString &name, Layout &layout)
+{
+    for (Layout candidate : { PRESET, GRID, RANDOM, CLUSTERED }) {
+        if (name == layoutName(candidate)) {
+            layout = candidate;
+            return true;
+        }
+    }
+    qWarning() << ":: Unknown scene layout" << name;
+    return false;
+}
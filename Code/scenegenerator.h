@@ -0,0 +1,65 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include "object.h"
+
+#include <QCommandLineParser>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The SceneGenerator class
+ *
+ * Spawns many instances of the bundled meshes for scaling tests. Every
+ * object gets a mesh, a texture, a material, a position, a scale, a start
+ * rotation and a rotation speed, drawn from a seeded generator, so the same
+ * configuration always yields the same scene.
+ *
+ * Layouts:
+ *   preset     the four hand-placed objects of the original scene
+ *   grid       a cube of objects, spacing apart
+ *   random     uniformly spread over the same cube
+ *   clustered  normally distributed around random cluster centres
+ *
+ * The configuration comes from an ini file (--scene) and/or command line
+ * options, which take precedence over the file.
+ */
+class SceneGenerator
+{
+public:
+    enum Layout
+    {
+        PRESET = 0, GRID, RANDOM, CLUSTERED
+    };
+
+    struct Config
+    {
+        Layout layout = PRESET;
+        int objects = 4;
+        quint32 seed = 1;
+        float spacing = 2;        // between grid neighbours; sets the density of the others
+        int clusters = 8;
+        float clusterRadius = 4;  // standard deviation around a cluster centre
+        float minScale = 0.3f;
+        float maxScale = 1.2f;
+        float maxRotationSpeed = 2; // degrees per frame, either direction
+    };
+
+    static const int maxObjects = 10000000;
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills config from the options added by addOptions().
+    static bool configure(const QCommandLineParser &parser, Config &config);
+    static bool load(const QString &file, Config &config);
+
+    static QVector<Object> generate(const Config &config, int numMeshes, int numTextures);
+    // Radius of a sphere around the origin that contains all object centres.
+    static float radius(const Config &config);
+
+    static QString layoutName(Layout layout);
+
+private:
+    static bool parseLayout(const QString &name, Layout &layout);
+};
+
+#endif // SCENEGENERATOR_H
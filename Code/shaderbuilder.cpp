@@ -0,0 +1,164 @@
+#include "shaderbuilder.h"
+#include "trace.h"
+
+#include <QDebug>
+#include <QOpenGLContext>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+ShaderBuilder::ShaderBuilder()
+{
+}
+
+void ShaderBuilder::initialize(ShaderCache *cache)
+{
+    initializeOpenGLFunctions();
+    this->cache = cache;
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    MaxShaderCompilerThreadsProc maxThreads = nullptr;
+    if (context->hasExtension("GL_KHR_parallel_shader_compile"))
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(context->getProcAddress("glMaxShaderCompilerThreadsKHR"));
+    else if (context->hasExtension("GL_ARB_parallel_shader_compile"))
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(context->getProcAddress("glMaxShaderCompilerThreadsARB"));
+
+    parallelCompile = maxThreads != nullptr;
+    if (parallelCompile)
+        maxThreads(0xFFFFFFFF); // let the driver pick the number of threads
+
+    qDebug() << ":: Parallel shader compile" << (parallelCompile ? "available" : "not available");
+}
+
+/**
+ * @brief ShaderBuilder::submit
+ *
+ * Starts building a program. Nothing in here queries compile or link status.
+ */
+void ShaderBuilder::submit(QOpenGLShaderProgram *program, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    TRACE_GL_SCOPE("shader link");
+    Job job;
+    job.program = program;
+    job.key = cache->key(vertexSource, fragmentSource);
+    job.polls = 0;
+
+    program->create();
+    if (cache->load(program, job.key)) {
+        ready.insert(program);
+        return;
+    }
+
+    cache->setRetrievableHint(program);
+    job.vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    job.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    glAttachShader(program->programId(), job.vertexShader);
+    glAttachShader(program->programId(), job.fragmentShader);
+    glLinkProgram(program->programId());
+
+    pending.append(job);
+}
+
+QVector<QOpenGLShaderProgram *> ShaderBuilder::poll()
+{
+    QVector<QOpenGLShaderProgram *> finished;
+
+    for (int idx = 0; idx < pending.size(); ) {
+        Job &job = pending[idx];
+        ++job.polls;
+
+        if (!isFinished(job)) {
+            ++idx;
+            continue;
+        }
+
+        finish(job);
+        finished.append(job.program);
+        pending.remove(idx);
+
+        // Without the extension, finishing may stall; spread that over frames.
+        if (!parallelCompile)
+            break;
+    }
+    return finished;
+}
+
+void ShaderBuilder::prioritize(QOpenGLShaderProgram *program)
+{
+    for (int idx = 1; idx < pending.size(); ++idx) {
+        if (pending[idx].program == program) {
+            pending.prepend(pending.takeAt(idx));
+            return;
+        }
+    }
+}
+
+bool ShaderBuilder::isReady(QOpenGLShaderProgram *program) const
+{
+    return ready.contains(program);
+}
+
+bool ShaderBuilder::isIdle() const
+{
+    return pending.isEmpty();
+}
+
+// --- Helpers
+
+GLuint ShaderBuilder::compileShader(GLenum type, const QByteArray &source)
+{
+    GLuint shader = glCreateShader(type);
+    const char *data = source.constData();
+    GLint length = source.size();
+    glShaderSource(shader, 1, &data, &length);
+    glCompileShader(shader);
+    return shader;
+}
+
+bool ShaderBuilder::isFinished(const Job &job)
+{
+    if (parallelCompile) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(job.program->programId(), GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+    return job.polls > 1;
+}
+
+void ShaderBuilder::finish(const Job &job)
+{
+    TRACE_GL_SCOPE("shader link status");
+    GLuint programId = job.program->programId();
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE) {
+        // Marks the QOpenGLShaderProgram as linked, see ShaderCache::load().
+        job.program->link();
+        cache->store(job.program, job.key);
+        ready.insert(job.program);
+    } else {
+        printLog(job.vertexShader, "vertex");
+        printLog(job.fragmentShader, "fragment");
+    }
+
+    glDetachShader(programId, job.vertexShader);
+    glDetachShader(programId, job.fragmentShader);
+    glDeleteShader(job.vertexShader);
+    glDeleteShader(job.fragmentShader);
+}
+
+void ShaderBuilder::printLog(GLuint shader, const char *stage)
+{
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    if (length <= 1)
+        return;
+
+    QByteArray log(length, Qt::Uninitialized);
+    glGetShaderInfoLog(shader, length, nullptr, log.data());
+    qDebug() << ":: Failed to build" << stage << "shader:" << log.constData();
+}
@@ -0,0 +1,65 @@
+#ifndef SHADERBUILDER_H
+#define SHADERBUILDER_H
+
+#include "shadercache.h"
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QSet>
+#include <QVector>
+
+/**
+ * @brief The ShaderBuilder class
+ *
+ * Builds shader programs without blocking the frame that asked for them.
+ *
+ * submit() issues the compile and link commands and returns immediately;
+ * QOpenGLShaderProgram would query the compile status right away, which
+ * forces the driver to finish. With KHR_parallel_shader_compile the driver
+ * compiles on its own threads and poll() asks for GL_COMPLETION_STATUS_KHR,
+ * which never blocks. Without it, poll() finishes at most one program per
+ * call, and only after it had a frame to compile in the background.
+ *
+ * Programs found in the ShaderCache are ready as soon as they are submitted.
+ */
+class ShaderBuilder : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    ShaderBuilder();
+
+    // Must be called with the GL context current.
+    void initialize(ShaderCache *cache);
+
+    void submit(QOpenGLShaderProgram *program, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+
+    // Finishes the builds the driver is done with; returns the programs that became ready.
+    QVector<QOpenGLShaderProgram *> poll();
+
+    // Moves a pending program to the front of the queue.
+    void prioritize(QOpenGLShaderProgram *program);
+
+    bool isReady(QOpenGLShaderProgram *program) const;
+    bool isIdle() const;
+
+private:
+    struct Job
+    {
+        QOpenGLShaderProgram *program;
+        GLuint vertexShader;
+        GLuint fragmentShader;
+        QByteArray key;
+        int polls;
+    };
+
+    GLuint compileShader(GLenum type, const QByteArray &source);
+    bool isFinished(const Job &job);
+    void finish(const Job &job);
+    void printLog(GLuint shader, const char *stage);
+
+    ShaderCache *cache = nullptr;
+    bool parallelCompile = false;
+    QVector<Job> pending;
+    QSet<QOpenGLShaderProgram *> ready;
+};
+
+#endif // SHADERBUILDER_H
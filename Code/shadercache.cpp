@@ -0,0 +1,185 @@
+#include "shadercache.h"
+#include "trace.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+const quint32 cacheMagic = 0x47504243; // "GPBC"
+const quint32 cacheVersion = 1;
+}
+
+ShaderCache::ShaderCache()
+{
+}
+
+/**
+ * @brief ShaderCache::initialize
+ *
+ * Checks driver support, derives the driver id and prunes entries that were
+ * written by other drivers.
+ */
+void ShaderCache::initialize()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    functions = context->extraFunctions();
+
+    driverId.clear();
+    driverId += reinterpret_cast<const char *>(functions->glGetString(GL_VENDOR));
+    driverId += '\n';
+    driverId += reinterpret_cast<const char *>(functions->glGetString(GL_RENDERER));
+    driverId += '\n';
+    driverId += reinterpret_cast<const char *>(functions->glGetString(GL_VERSION));
+    driverId += '\n';
+    driverId += reinterpret_cast<const char *>(functions->glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    GLint numFormats = 0;
+    QPair<int, int> version = context->format().version();
+    if (version >= qMakePair(4, 1) || context->hasExtension("GL_ARB_get_program_binary"))
+        functions->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    supported = numFormats > 0;
+
+    if (!supported) {
+        qDebug() << ":: Program binaries not supported, shader cache disabled";
+        return;
+    }
+
+    QString driverHash = QCryptographicHash::hash(driverId, QCryptographicHash::Sha1).toHex().left(16);
+    QDir root(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders");
+    for (const QString &entry : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (entry != driverHash)
+            QDir(root.filePath(entry)).removeRecursively();
+    }
+
+    directory = root.filePath(driverHash);
+    QDir().mkpath(directory);
+}
+
+bool ShaderCache::build(QOpenGLShaderProgram *program, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    TRACE_GL_SCOPE("shader link");
+    QByteArray entry = key(vertexSource, fragmentSource);
+    program->create();
+
+    if (load(program, entry))
+        return true;
+
+    setRetrievableHint(program);
+    program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource);
+    program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    if (!program->link())
+        return false;
+
+    store(program, entry);
+    return true;
+}
+
+/**
+ * @brief ShaderCache::load
+ *
+ * Feeds a cached binary to the driver. QOpenGLShaderProgram::link() on a
+ * program without attached shaders only checks the link status, which is
+ * how the program is marked as linked after glProgramBinary.
+ */
+bool ShaderCache::load(QOpenGLShaderProgram *program, const QByteArray &key)
+{
+    if (!supported)
+        return false;
+
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic, version, format;
+    QByteArray storedDriverId, binary, checksum;
+    in >> magic >> version >> format >> storedDriverId >> binary >> checksum;
+    file.close();
+
+    bool valid = in.status() == QDataStream::Ok
+            && magic == cacheMagic && version == cacheVersion
+            && storedDriverId == driverId
+            && checksum == QCryptographicHash::hash(binary, QCryptographicHash::Sha1);
+
+    if (valid) {
+        functions->glProgramBinary(program->programId(), format, binary.constData(), binary.size());
+
+        GLint status = GL_FALSE;
+        functions->glGetProgramiv(program->programId(), GL_LINK_STATUS, &status);
+        valid = status == GL_TRUE && program->link();
+    }
+
+    if (!valid) {
+        qDebug() << ":: Rejected shader cache entry" << file.fileName();
+        QFile::remove(file.fileName());
+        return false;
+    }
+    return true;
+}
+
+void ShaderCache::store(QOpenGLShaderProgram *program, const QByteArray &key)
+{
+    if (!supported)
+        return;
+
+    GLint length = 0;
+    functions->glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    QByteArray binary(length, Qt::Uninitialized);
+    GLenum format = 0;
+    functions->glGetProgramBinary(program->programId(), length, &length, &format, binary.data());
+    binary.resize(length);
+
+    QSaveFile file(entryPath(key));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out << cacheMagic << cacheVersion << quint32(format) << driverId << binary
+        << QCryptographicHash::hash(binary, QCryptographicHash::Sha1);
+    file.commit();
+}
+
+void ShaderCache::setRetrievableHint(QOpenGLShaderProgram *program)
+{
+    if (supported)
+        functions->glProgramParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+QByteArray ShaderCache::key(const QByteArray &vertexSource, const QByteArray &fragmentSource) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(vertexSource);
+    hash.addData("\0", 1);
+    hash.addData(fragmentSource);
+    return hash.result().toHex();
+}
+
+bool ShaderCache::isSupported() const
+{
+    return supported;
+}
+
+QString ShaderCache::entryPath(const QByteArray &key) const
+{
+    return directory + "/" + QString::fromLatin1(key) + ".bin";
+}
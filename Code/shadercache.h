@@ -0,0 +1,54 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+class QOpenGLExtraFunctions;
+
+/**
+ * @brief The ShaderCache class
+ *
+ * Disk cache for linked program binaries (glGetProgramBinary/glProgramBinary).
+ *
+ * Entries are keyed by a hash of the shader sources and live in a directory
+ * named after a hash of the GL vendor, renderer, version and shading language
+ * strings, which carry the driver build. Editing a shader or updating the
+ * driver therefore never hits a stale entry, and directories of other drivers
+ * are removed on start. Entries that fail validation or are rejected by the
+ * driver are deleted and the program is compiled from source instead.
+ */
+class ShaderCache
+{
+public:
+    ShaderCache();
+
+    // Must be called with the GL context current.
+    void initialize();
+
+    // Links the program from the cache, or compiles it from source and caches the result.
+    bool build(QOpenGLShaderProgram *program, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+
+    // Loads a cached binary into a created program; false on a miss or rejected entry.
+    bool load(QOpenGLShaderProgram *program, const QByteArray &key);
+
+    // Stores the binary of a program linked with the retrievable hint set.
+    void store(QOpenGLShaderProgram *program, const QByteArray &key);
+
+    // Must be set on a created program before it is linked for store() to work.
+    void setRetrievableHint(QOpenGLShaderProgram *program);
+
+    QByteArray key(const QByteArray &vertexSource, const QByteArray &fragmentSource) const;
+    bool isSupported() const;
+
+private:
+    QString entryPath(const QByteArray &key) const;
+
+    QOpenGLExtraFunctions *functions = nullptr;
+    bool supported = false;
+    QByteArray driverId;
+    QString directory;
+};
+
+#endif // SHADERCACHE_H
@@ -0,0 +1,180 @@
+#include "shaderpermutations.h"
+
+#include "waveset.h"
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+quint32 ShaderPermutations::Features::key() const
+{
+    return static_cast<quint32>(lighting) | (textured ? 1u << 2 : 0u) | (lodMorph ? 1u << 3 : 0u)
+           | (wavesFft ? 1u << 4 : 0u) | (wavesDisplaced ? 1u << 5 : 0u)
+           | (displace ? 1u << 6 : 0u) | (ripples ? 1u << 7 : 0u)
+           | (static_cast<quint32>(numWaves) << 8);
+}
+
+ShaderPermutations::ShaderPermutations()
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    destroy();
+}
+
+void ShaderPermutations::initialize(ShaderCache *cache, ShaderBuilder *builder,
+                                    const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    this->cache = cache;
+    this->builder = builder;
+    this->vertexSource = vertexSource;
+    this->fragmentSource = fragmentSource;
+
+    Features features = { FALLBACK, false, 0 };
+    QByteArray defines = preamble(features);
+
+    fallbackVariant = new ShaderVariant;
+    fallbackVariant->ready = cache->build(&fallbackVariant->program,
+                                          withPreamble(vertexSource, defines),
+                                          withPreamble(fragmentSource, defines));
+    queryUniforms(fallbackVariant);
+}
+
+void ShaderPermutations::destroy()
+{
+    qDeleteAll(variants);
+    variants.clear();
+    delete fallbackVariant;
+    fallbackVariant = nullptr;
+}
+
+ShaderVariant *ShaderPermutations::variant(const Features &features)
+{
+    quint32 key = features.key();
+    ShaderVariant *variant = variants.value(key);
+    if (variant) {
+        if (!variant->ready)
+            builder->prioritize(&variant->program);
+        return variant;
+    }
+
+    QByteArray defines = preamble(features);
+    qDebug() << ":: Compiling shader variant" << defines.simplified().constData();
+
+    variant = new ShaderVariant;
+    variants.insert(key, variant);
+    builder->submit(&variant->program, withPreamble(vertexSource, defines), withPreamble(fragmentSource, defines));
+    builder->prioritize(&variant->program);
+
+    // Cache hits are ready right away.
+    if (builder->isReady(&variant->program)) {
+        variant->ready = true;
+        queryUniforms(variant);
+    }
+    return variant;
+}
+
+ShaderVariant *ShaderPermutations::fallback()
+{
+    return fallbackVariant;
+}
+
+void ShaderPermutations::poll()
+{
+    QVector<QOpenGLShaderProgram *> finished = builder->poll();
+    if (finished.isEmpty())
+        return;
+
+    for (ShaderVariant *variant : variants) {
+        if (!variant->ready && finished.contains(&variant->program)) {
+            variant->ready = true;
+            queryUniforms(variant);
+        }
+    }
+}
+
+QByteArray ShaderPermutations::vertexShader(const Features &features) const
+{
+    return withPreamble(vertexSource, preamble(features));
+}
+
+// --- Helpers
+
+QByteArray ShaderPermutations::preamble(const Features &features) const
+{
+    static const char *lightingDefines[] = {
+        "LIGHTING_FALLBACK", "LIGHTING_NORMAL", "LIGHTING_GOURAUD", "LIGHTING_PHONG"
+    };
+
+    QByteArray defines;
+    defines += "#define ";
+    defines += lightingDefines[features.lighting];
+    defines += "\n";
+    if (features.textured)
+        defines += "#define TEXTURED\n";
+    defines += "#define NUM_WAVES " + QByteArray::number(features.numWaves) + "\n";
+    if (features.lodMorph)
+        defines += "#define LOD_MORPH\n";
+    if (features.wavesFft)
+        defines += "#define WAVES_FFT\n";
+    if (features.wavesDisplaced)
+        defines += "#define WAVES_DISPLACED\n";
+    if (features.displace)
+        defines += "#define DISPLACE\n";
+    if (features.ripples)
+        defines += "#define RIPPLES\n";
+    return defines;
+}
+
+/**
+ * @brief ShaderPermutations::withPreamble
+ *
+ * Inserts the defines right after the #version line, which has to stay first.
+ */
+QByteArray ShaderPermutations::withPreamble(const QByteArray &source, const QByteArray &defines) const
+{
+    int versionEnd = 0;
+    if (source.startsWith("#version"))
+        versionEnd = source.indexOf('\n') + 1;
+
+    QByteArray result = source.left(versionEnd);
+    result += defines;
+    result += "#line 2\n";
+    result += source.mid(versionEnd);
+    return result;
+}
+
+void ShaderPermutations::queryUniforms(ShaderVariant *variant)
+{
+    QOpenGLShaderProgram &program = variant->program;
+
+    variant->uniformModelViewTransform  = program.uniformLocation("modelViewTransform");
+    variant->uniformProjectionTransform = program.uniformLocation("projectionTransform");
+    variant->uniformNormalTransform     = program.uniformLocation("normalTransform");
+
+    variant->uniformMaterial       = program.uniformLocation("material");
+    variant->uniformLightPosition  = program.uniformLocation("lightPosition");
+    variant->uniformLightColour    = program.uniformLocation("lightColour");
+    variant->uniformTextureSampler = program.uniformLocation("textureSampler");
+
+    // A block is bound to a buffer binding like a sampler to a texture unit.
+    if (program.isLinked()) {
+        QOpenGLExtraFunctions *gl = QOpenGLContext::currentContext()->extraFunctions();
+        GLuint wavesBlock = gl->glGetUniformBlockIndex(program.programId(), "Waves");
+        if (wavesBlock != GL_INVALID_INDEX)
+            gl->glUniformBlockBinding(program.programId(), wavesBlock, WaveSet::binding);
+    }
+
+    variant->uniformLodCamera     = program.uniformLocation("lodCamera");
+    variant->uniformLodRanges     = program.uniformLocation("lodRanges");
+    variant->uniformLodPatchQuads = program.uniformLocation("lodPatchQuads");
+
+    variant->uniformOceanDisplacement = program.uniformLocation("oceanDisplacement");
+    variant->uniformOceanNormals      = program.uniformLocation("oceanNormals");
+    variant->uniformOceanTileSize     = program.uniformLocation("oceanTileSize");
+    variant->uniformOceanAmplitude    = program.uniformLocation("oceanAmplitude");
+    variant->uniformWaveAmplitude     = program.uniformLocation("waveAmplitude");
+
+    variant->uniformRippleHeight = program.uniformLocation("rippleHeight");
+}
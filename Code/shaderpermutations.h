@@ -0,0 +1,113 @@
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include "shaderbuilder.h"
+#include "shadercache.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QOpenGLShaderProgram>
+
+/**
+ * @brief The ShaderVariant struct
+ *
+ * One compiled permutation of the uber-shader and its uniform locations.
+ * Uniforms the variant does not use are -1, which glUniform* ignores.
+ */
+struct ShaderVariant
+{
+    QOpenGLShaderProgram program;
+    bool ready = false;
+
+    GLint uniformModelViewTransform = -1;
+    GLint uniformProjectionTransform = -1;
+    GLint uniformNormalTransform = -1;
+
+    GLint uniformMaterial = -1;
+    GLint uniformLightPosition = -1;
+    GLint uniformLightColour = -1;
+    GLint uniformTextureSampler = -1;
+
+    // The Waves block is bound to WaveSet::binding.
+
+    GLint uniformLodCamera = -1;
+    GLint uniformLodRanges = -1;
+    GLint uniformLodPatchQuads = -1;
+
+    GLint uniformOceanDisplacement = -1;
+    GLint uniformOceanNormals = -1;
+    GLint uniformOceanTileSize = -1;
+    GLint uniformOceanAmplitude = -1;
+    GLint uniformWaveAmplitude = -1;
+
+    GLint uniformRippleHeight = -1;
+};
+
+/**
+ * @brief The ShaderPermutations class
+ *
+ * Compiles the uber-shader (vertshader_uber.glsl, fragshader_uber.glsl) with
+ * a #define preamble per feature set, so every variant contains exactly the
+ * code and loop bounds it needs. Variants are compiled the first time they
+ * are asked for and kept by feature key; builds go through the ShaderBuilder,
+ * so they do not block and come from the program binary cache when possible.
+ *
+ * The fallback variant is linked synchronously in initialize(), so there is
+ * always something to draw with.
+ */
+class ShaderPermutations
+{
+public:
+    enum Lighting : quint32
+    {
+        FALLBACK = 0, NORMAL, GOURAUD, PHONG
+    };
+
+    struct Features
+    {
+        Lighting lighting;
+        bool textured;
+        int numWaves;
+        bool lodMorph = false;
+        bool wavesFft = false;
+        bool wavesDisplaced = false;
+        bool displace = false; // only the displacement, for transform feedback
+        bool ripples = false;
+
+        quint32 key() const;
+    };
+
+    ShaderPermutations();
+    ~ShaderPermutations();
+
+    // Must be called with the GL context current.
+    void initialize(ShaderCache *cache, ShaderBuilder *builder,
+                    const QByteArray &vertexSource, const QByteArray &fragmentSource);
+    void destroy();
+
+    // Returns the variant for the features, submitting it for compilation on first use.
+    // Draw with fallback() while it is not ready.
+    ShaderVariant *variant(const Features &features);
+    ShaderVariant *fallback();
+
+    // Picks up variants the builder finished. Call once per frame.
+    void poll();
+
+    // The vertex shader of a feature set, for programs linked elsewhere.
+    QByteArray vertexShader(const Features &features) const;
+
+private:
+    QByteArray preamble(const Features &features) const;
+    QByteArray withPreamble(const QByteArray &source, const QByteArray &defines) const;
+    void queryUniforms(ShaderVariant *variant);
+
+    ShaderCache *cache = nullptr;
+    ShaderBuilder *builder = nullptr;
+    QByteArray vertexSource;
+    QByteArray fragmentSource;
+
+    QHash<quint32, ShaderVariant *> variants;
+    ShaderVariant *fallbackVariant = nullptr;
+};
+
+#endif // SHADERPERMUTATIONS_H
@@ -0,0 +1,45 @@
+#version 330 core
+
+// Ripple simulation step, see Ripples. One texel per cell over the [-1, 1]
+// grid: the height in r, the height of the step before in g.
+
+#define M_PI 3.141593
+#define MAX_IMPULSES 16
+
+uniform sampler2D state;
+uniform float coefficient; // (speed dt / dx)^2
+uniform float damping;
+
+// Centre x, y, radius in grid units and strength, added after this step.
+uniform int impulseCount;
+uniform vec4 impulses[MAX_IMPULSES];
+
+// Specify the output of the fragment shader
+out vec2 next;
+
+void main()
+{
+    ivec2 cell = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(state, 0);
+
+    // The border stays at rest and reflects the waves.
+    if (any(equal(cell, ivec2(0))) || any(equal(cell, size - 1))) {
+        next = vec2(0);
+        return;
+    }
+
+    vec2 here = texelFetch(state, cell, 0).rg;
+    float neighbours = texelFetch(state, cell + ivec2(1, 0), 0).r + texelFetch(state, cell - ivec2(1, 0), 0).r
+                     + texelFetch(state, cell + ivec2(0, 1), 0).r + texelFetch(state, cell - ivec2(0, 1), 0).r;
+    float height = here.r + damping * (here.r - here.g) + coefficient * (neighbours - 4.0 * here.r);
+
+    vec2 position = (vec2(cell) + 0.5) / vec2(size) * 2.0 - 1.0;
+    for (int i = 0; i < impulseCount; i++)
+    {
+        float d = length(position - impulses[i].xy);
+        if (d < impulses[i].z)
+            height += impulses[i].w * 0.5 * (1.0 + cos(M_PI * d / impulses[i].z));
+    }
+
+    next = vec2(height, here.r);
+}
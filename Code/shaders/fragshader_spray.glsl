@@ -0,0 +1,17 @@
+#version 330 core
+
+// Spray sprites, see Spray: a soft white disc.
+
+in vec2 corner;
+in float opacity;
+
+// Specify the output of the fragment shader
+out vec4 fColor;
+
+void main()
+{
+    float distance2 = dot(corner, corner);
+    if (distance2 > 1.0)
+        discard;
+    fColor = vec4(0.9, 0.95, 1.0, 0.6 * opacity * (1.0 - distance2));
+}
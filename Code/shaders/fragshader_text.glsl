@@ -0,0 +1,17 @@
+#version 330 core
+
+// Text overlay, see StatsOverlay.
+
+in vec2 texCoords;
+
+uniform sampler2D glyphs;
+
+// Specify the output of the fragment shader
+out vec4 fColor;
+
+void main()
+{
+    // Yellow text on a translucent dark background, so it reads on any scene.
+    float coverage = texture(glyphs, texCoords).a;
+    fColor = mix(vec4(0.0, 0.0, 0.0, 0.5), vec4(1.0, 0.9, 0.2, 1.0), coverage);
+}
@@ -0,0 +1,118 @@
+#version 330 core
+
+// Feature defines, prepended by ShaderPermutations; see vertshader_uber.glsl.
+
+// Define constants
+#define M_PI 3.141593
+
+#if NUM_WAVES > 0 || defined(WAVES_FFT) || defined(WAVES_DISPLACED)
+#define WAVES
+#endif
+
+// The input from the vertex shader.
+in vec2 texCoords;
+
+#if defined(LIGHTING_NORMAL) || defined(LIGHTING_PHONG)
+in vec3 vertNormal;
+#endif
+
+#if defined(LIGHTING_PHONG)
+in vec3 vertPosition;
+in vec3 relativeLightPosition;
+#endif
+
+#if defined(LIGHTING_GOURAUD)
+in float ambient, diffuse, specular;
+#endif
+
+#if defined(LIGHTING_FALLBACK)
+in float shade;
+#endif
+
+#if defined(WAVES_FFT)
+in vec2 oceanCoords;
+#endif
+
+#if defined(WAVES) && !defined(TEXTURED)
+in float h;
+#endif
+
+// Lighting model constants.
+#if defined(LIGHTING_PHONG)
+uniform vec4 material;
+#endif
+
+#if defined(LIGHTING_GOURAUD) || defined(LIGHTING_PHONG)
+uniform vec3 lightColour;
+#endif
+
+#if defined(TEXTURED)
+// Texture sampler
+uniform sampler2D textureSampler;
+#endif
+
+#if defined(WAVES_FFT) && (defined(LIGHTING_NORMAL) || defined(LIGHTING_PHONG))
+// Per pixel normals of the ocean, which has more detail than the mesh.
+uniform sampler2D oceanNormals;
+uniform mat3 normalTransform;
+#endif
+
+// Specify the output of the fragment shader
+// Usually a vec4 describing a color (Red, Green, Blue, Alpha/Transparency)
+out vec4 fColour;
+
+vec3 materialColour()
+{
+#if defined(TEXTURED)
+    return texture(textureSampler, texCoords).xyz;
+#elif defined(WAVES)
+    return vec3(0.2+0.8*h, 0.2+0.8*h, 1.0);
+#else
+    return vec3(1.0);
+#endif
+}
+
+#if defined(LIGHTING_NORMAL) || defined(LIGHTING_PHONG)
+vec3 surfaceNormal()
+{
+#if defined(WAVES_FFT)
+    return normalize(normalTransform * texture(oceanNormals, oceanCoords).xyz);
+#else
+    return normalize(vertNormal);
+#endif
+}
+#endif
+
+void main()
+{
+#if defined(LIGHTING_NORMAL)
+    fColour = vec4(surfaceNormal() * 0.5 + 0.5, 1.0);
+#elif defined(LIGHTING_GOURAUD)
+    vec3 colour = materialColour();
+
+    // Combine the received components into one colour.
+    fColour = vec4(ambient * colour + (diffuse + specular) * lightColour * colour, 1);
+#elif defined(LIGHTING_PHONG)
+    // Ambient colour does not depend on any vectors.
+    vec3 baseColour = materialColour();
+    vec3 colour     = material.x * baseColour;
+
+    // Calculate light direction vectors in the phong model.
+    vec3 lightDirection   = normalize(relativeLightPosition - vertPosition);
+    vec3 normal           = surfaceNormal();
+
+    // Diffuse colour.
+    float diffuseIntesity = max(dot(normal, lightDirection), 0);
+    colour += baseColour * material.y * diffuseIntesity;
+
+    // Specular colour.
+    vec3 viewDirection     = normalize(-vertPosition); // The camera is always at (0, 0, 0).
+    vec3 reflectDirection  = reflect(-lightDirection, normal);
+    float specularIntesity = max(dot(reflectDirection, viewDirection), 0);
+    colour += baseColour * lightColour * material.z * pow(specularIntesity, material.w);
+
+    fColour = vec4(colour, 1);
+#else
+    fColour = vec4(vec3(shade), 1.0);
+#endif
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// Passes on a point for every living spray particle only, so the
+// GL_PRIMITIVES_GENERATED query around the pass counts the living.
+
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in float life[];
+
+void main()
+{
+    if (life[0] > 0.0) {
+        gl_Position = gl_in[0].gl_Position;
+        EmitVertex();
+        EndPrimitive();
+    }
+}
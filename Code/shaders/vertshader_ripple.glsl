@@ -0,0 +1,10 @@
+#version 330 core
+
+// Ripple simulation step, see Ripples.
+
+void main()
+{
+    // One triangle that covers the viewport, from the vertex index alone.
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+
+// Spray sprites, see Spray. One instance per particle, four vertices each
+// drawn as a triangle strip.
+
+// Per instance: the position in grid units and the life left.
+layout (location = 0) in vec4 particlePosition;
+
+uniform mat4 projectionTransform;
+uniform mat4 modelViewTransform;
+uniform float size; // grid units, half the sprite width
+
+out vec2 corner;
+out float opacity;
+
+void main()
+{
+    corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    // Dead particles collapse outside the view and produce no fragments.
+    if (particlePosition.w <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        opacity = 0.0;
+        return;
+    }
+
+    // Faces the camera: the corner is offset in view space.
+    vec4 centre = modelViewTransform * vec4(particlePosition.xyz, 1.0);
+    float scale = length(modelViewTransform[0].xyz);
+    gl_Position = projectionTransform * (centre + vec4(corner * size * scale, 0.0, 0.0));
+    // Fades out over the last quarter unit of t.
+    opacity = clamp(4.0 * particlePosition.w, 0.0, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Counting the living spray particles, see Spray. Runs over one particle
+// buffer as points with rasterization discarded; geomshader_spray_count.glsl
+// drops the dead ones.
+
+// The position in grid units and the life left.
+layout (location = 0) in vec4 particlePosition;
+
+out float life;
+
+void main()
+{
+    life = particlePosition.w;
+    gl_Position = vec4(0.0);
+}
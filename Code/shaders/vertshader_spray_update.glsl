@@ -0,0 +1,79 @@
+#version 330 core
+
+// Spray particle step, see Spray. Runs once per particle as a point with
+// rasterization discarded; transform feedback writes the particle into the
+// other buffer.
+
+// The position in grid units and the life left; the velocity in grid units
+// per unit of t and the height the particle left the water at.
+layout (location = 0) in vec4 particlePosition;
+layout (location = 1) in vec4 particleVelocity;
+
+// The displaced water vertices in the WaterGrid layout, two texels each:
+// (x, y, z, nx) and (ny, nz, u, v).
+uniform samplerBuffer surface;
+uniform int surfaceVertices;
+
+uniform float dt;
+uniform uint seed;       // different every step
+uniform float emission;  // chance per unit of t that a dead particle tries a vertex
+uniform float threshold; // slope spray starts at
+uniform float speed;
+uniform float lifetime;
+uniform float drag;
+uniform float gravity;
+
+out vec4 nextPosition;
+out vec4 nextVelocity;
+
+// Integer hash of Thomas Wang.
+uint hash(uint x)
+{
+    x = (x ^ 61u) ^ (x >> 16);
+    x *= 9u;
+    x = x ^ (x >> 4);
+    x *= 0x27d4eb2du;
+    return x ^ (x >> 15);
+}
+
+// Uniform in [0, 1), advancing state.
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8) / 16777216.0;
+}
+
+void main()
+{
+    if (particlePosition.w > 0.0) {
+        vec3 velocity = particleVelocity.xyz * exp(-drag * dt);
+        velocity.z -= gravity * dt;
+        vec3 position = particlePosition.xyz + velocity * dt;
+        float life = particlePosition.w - dt;
+        // Back in the water below where it left.
+        if (velocity.z < 0.0 && position.z < particleVelocity.w)
+            life = 0.0;
+        nextPosition = vec4(position, max(life, 0.0));
+        nextVelocity = vec4(velocity, particleVelocity.w);
+        return;
+    }
+
+    nextPosition = vec4(0.0);
+    nextVelocity = vec4(0.0);
+    uint state = hash(uint(gl_VertexID) ^ seed);
+    if (surfaceVertices == 0 || random(state) >= emission * dt)
+        return;
+
+    int vertex = min(int(random(state) * float(surfaceVertices)), surfaceVertices - 1);
+    vec4 first = texelFetch(surface, 2 * vertex);
+    vec4 second = texelFetch(surface, 2 * vertex + 1);
+    vec3 normal = vec3(first.w, second.xy);
+    float slope = length(normal.xy) / max(normal.z, 1e-3);
+    if (random(state) >= clamp((slope - threshold) / threshold, 0.0, 1.0))
+        return;
+
+    vec3 jitter = vec3(random(state), random(state), random(state)) - 0.5;
+    vec3 direction = normalize(normal + vec3(0.0, 0.0, 1.0) + jitter);
+    nextPosition = vec4(first.xyz, lifetime * (0.5 + 0.5 * random(state)));
+    nextVelocity = vec4(direction * speed * (0.5 + random(state)), first.z);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+// Text overlay, see StatsOverlay.
+
+// Specify the input locations of attributes
+layout (location = 0) in vec2 vertPosition_in; // pixels from the top left
+layout (location = 1) in vec2 texCoords_in;
+
+uniform vec2 viewportSize;
+
+// Specify the outputs of the vertex shader
+out vec2 texCoords;
+
+void main()
+{
+    vec2 ndc = vertPosition_in / viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    texCoords = texCoords_in;
+}
@@ -0,0 +1,232 @@
+#version 330 core
+
+// Feature defines, prepended by ShaderPermutations:
+//   LIGHTING_FALLBACK, LIGHTING_NORMAL, LIGHTING_GOURAUD or LIGHTING_PHONG
+//   TEXTURED   the material colour comes from textureSampler
+//   NUM_WAVES  number of Gerstner waves displacing the surface, 0 for none
+//   LOD_MORPH  the vertex is a WaterLod patch vertex, placed by patch_in
+//   WAVES_FFT  the OceanFft textures displace the surface, instead of sines
+//   WAVES_DISPLACED  the vertices arrive displaced, by SineWaves or the
+//              displacement pass; only colour by height
+//   DISPLACE   only displace, into the outputs captured by WaterDisplacement
+//   RIPPLES    add the Ripples height field to the displaced surface
+
+#if NUM_WAVES > 0 || defined(WAVES_FFT) || defined(WAVES_DISPLACED)
+#define WAVES
+#endif
+
+// Specify the input locations of attributes
+layout (location = 0) in vec3 vertCoordinates_in;
+layout (location = 1) in vec3 vertNormals_in;
+layout (location = 2) in vec2 texCoords_in;
+
+#if defined(LOD_MORPH)
+#define LOD_MAX_LEVELS 16
+
+// Lower left corner, size and level of the patch, per instance.
+layout (location = 3) in vec4 patch_in;
+
+// Camera position in grid space, morph start and end per level, quads per patch side.
+uniform vec3 lodCamera;
+uniform vec2 lodRanges[LOD_MAX_LEVELS];
+uniform float lodPatchQuads;
+#endif
+
+// Transformation matrices.
+uniform mat4 modelViewTransform;
+uniform mat4 projectionTransform;
+uniform mat3 normalTransform;
+
+#if defined(LIGHTING_GOURAUD) || defined(LIGHTING_PHONG)
+// Lighting model constants.
+uniform vec3 lightPosition;
+#endif
+
+#if defined(LIGHTING_GOURAUD)
+uniform vec4 material;
+#endif
+
+#if NUM_WAVES > 0
+// Per wave (D.x, D.y, k, A) and (w, phase - w t, Q A, 0), packed by WaveSet;
+// the phase is wrapped in double precision on the CPU, so there is no t.
+layout (std140) uniform Waves
+{
+    vec4 waveData[2 * NUM_WAVES];
+};
+#endif
+
+#if defined(WAVES_FFT)
+// One ocean tile: displacement and normal per texel, as fractions of the tile.
+uniform sampler2D oceanDisplacement;
+uniform sampler2D oceanNormals;
+uniform float oceanTileSize;  // grid units
+uniform float oceanAmplitude; // height that maps to the top of the colour ramp, fraction of the tile
+#endif
+
+#if defined(WAVES_DISPLACED) && !defined(TEXTURED)
+uniform float waveAmplitude; // sum of the amplitudes
+#endif
+
+#if defined(RIPPLES)
+// Ripple height over the [-1, 1] grid, in grid units.
+uniform sampler2D rippleHeight;
+#endif
+
+// Specify the output of the vertex stage
+out vec2 texCoords;
+
+#if defined(LIGHTING_NORMAL) || defined(LIGHTING_PHONG)
+out vec3 vertNormal;
+#endif
+
+#if defined(LIGHTING_PHONG)
+out vec3 vertPosition;
+out vec3 relativeLightPosition;
+#endif
+
+#if defined(LIGHTING_GOURAUD)
+out float ambient, diffuse, specular;
+#endif
+
+#if defined(LIGHTING_FALLBACK)
+out float shade;
+#endif
+
+#if defined(WAVES_FFT)
+out vec2 oceanCoords;
+#endif
+
+#if defined(WAVES) && !defined(TEXTURED)
+out float h;
+#endif
+
+#if defined(DISPLACE)
+// Captured by transform feedback, in the WaterGrid vertex layout.
+out vec3 displacedPosition;
+out vec3 displacedNormal;
+out vec2 displacedTexCoords;
+#endif
+
+#if defined(LOD_MORPH)
+// Places the patch vertex on the plane and slides the odd vertices onto
+// their even neighbours towards the end of the level's range, where the
+// patch matches the next coarser level.
+vec3 lodPosition()
+{
+    vec2 gridPos = (vertCoordinates_in.xy + 1.0) * 0.5 * lodPatchQuads;
+    float spacing = patch_in.z / lodPatchQuads;
+    vec2 position = patch_in.xy + gridPos * spacing;
+
+    vec2 range = lodRanges[int(patch_in.w)];
+    float morph = clamp((distance(vec3(position, 0), lodCamera) - range.x) / (range.y - range.x), 0.0, 1.0);
+    position -= fract(gridPos * 0.5) * 2.0 * spacing * morph;
+    return vec3(position, 0);
+}
+#endif
+
+void main()
+{
+#if defined(LOD_MORPH)
+    vec3 position = lodPosition();
+    vec2 texCoords_lod = position.xy * 0.5 + 0.5;
+#else
+    vec3 position = vertCoordinates_in;
+#endif
+    vec3 normal   = vertNormals_in;
+
+#if NUM_WAVES > 0
+    vec3 offset = vec3(0);
+    vec3 slope  = vec3(0, 0, 1);
+    float A = 0; // total amplitude
+
+    // A constant bound, so the compiler can unroll it.
+    for (int i = 0; i < NUM_WAVES; i++)
+    {
+        vec4 wave   = waveData[2 * i];
+        vec4 motion = waveData[2 * i + 1];
+        float theta = wave.z * dot(wave.xy, position.xy) + motion.y;
+        float c = cos(theta);
+        float s = sin(theta);
+
+        A      += wave.w;
+        offset += vec3(motion.z * c * wave.xy, wave.w * s);
+        slope  -= vec3(wave.xy * (wave.z * wave.w * c), motion.z * wave.z * s);
+    }
+    position += offset;
+    normal    = normalize(slope);
+#if !defined(TEXTURED)
+    h = (offset.z/A+1.0)/2.0; // map height to [0,1]
+#endif
+#elif defined(WAVES_FFT)
+    // Sampled where the vertex rests; the vertex shader has no mipmaps.
+    oceanCoords = position.xy / oceanTileSize;
+    vec3 displacement = textureLod(oceanDisplacement, oceanCoords, 0).xyz;
+    position += displacement * oceanTileSize;
+    normal    = textureLod(oceanNormals, oceanCoords, 0).xyz;
+#if !defined(TEXTURED)
+    h = clamp(0.5 + 0.5 * displacement.z / oceanAmplitude, 0.0, 1.0);
+#endif
+#elif defined(WAVES_DISPLACED) && !defined(TEXTURED)
+    h = (position.z/waveAmplitude+1.0)/2.0;
+#endif
+
+#if defined(RIPPLES)
+    // Added to the waves; the slope is a central difference over two texels.
+    vec2 rippleCoords = position.xy * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(rippleHeight, 0));
+    float ripple = textureLod(rippleHeight, rippleCoords, 0).r;
+    vec2 rippleSlope = vec2(textureLod(rippleHeight, rippleCoords + vec2(texel.x, 0), 0).r
+                            - textureLod(rippleHeight, rippleCoords - vec2(texel.x, 0), 0).r,
+                            textureLod(rippleHeight, rippleCoords + vec2(0, texel.y), 0).r
+                            - textureLod(rippleHeight, rippleCoords - vec2(0, texel.y), 0).r) / (4.0 * texel);
+    position.z += ripple;
+    normal = normalize(normal / max(normal.z, 0.1) - vec3(rippleSlope, 0));
+#endif
+
+#if defined(DISPLACE)
+    displacedPosition  = position;
+    displacedNormal    = normal;
+    displacedTexCoords = texCoords_in;
+    return; // rasterization is discarded
+#endif
+
+    vec3 viewPosition = vec3(modelViewTransform * vec4(position, 1));
+    vec3 viewNormal   = normalTransform * normal;
+
+    gl_Position = projectionTransform * vec4(viewPosition, 1);
+#if defined(LOD_MORPH)
+    texCoords   = texCoords_lod;
+#else
+    texCoords   = texCoords_in;
+#endif
+
+#if defined(LIGHTING_NORMAL)
+    vertNormal = viewNormal;
+#elif defined(LIGHTING_PHONG)
+    // Pass the required information to the fragment stage.
+    relativeLightPosition = vec3(modelViewTransform * vec4(lightPosition, 1));
+    vertPosition = viewPosition;
+    vertNormal   = viewNormal;
+#elif defined(LIGHTING_GOURAUD)
+    // Ambient component.
+    ambient = material.x;
+
+    // Calculate light direction, vertex position and normal.
+    vec3 vertexNormal          = normalize(viewNormal);
+    vec3 relativeLightPosition = vec3(modelViewTransform * vec4(lightPosition, 1));
+    vec3 lightDirection        = normalize(relativeLightPosition - viewPosition);
+
+    // Diffuse component.
+    float diffuseIntensity = max(dot(vertexNormal, lightDirection), 0);
+    diffuse = material.y * diffuseIntensity;
+
+    // Specular component.
+    vec3 viewDirection      = normalize(-viewPosition); // The camera is always at (0, 0, 0).
+    vec3 reflectDirection   = reflect(-lightDirection, vertexNormal);
+    float specularIntensity = max(dot(viewDirection, reflectDirection), 0);
+    specular = material.z * pow(specularIntensity, material.w);
+#else
+    // Drawn while the selected variant is still compiling, so keep it tiny.
+    shade = 0.3 + 0.6 * max(normalize(viewNormal).z, 0);
+#endif
+}
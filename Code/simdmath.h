@@ -0,0 +1,44 @@
+#ifndef SIMDMATH_H
+#define SIMDMATH_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/**
+ * Four-wide transcendental functions for the CPU wave evaluations, which
+ * have to match the sin() and cos() of the shaders to about 1e-7 on the
+ * reduced range.
+ */
+namespace SimdMath {
+
+// sin(a) for four angles: reduced to [-pi, pi] with a two-part 2 pi, folded
+// onto [-pi/2, pi/2] and evaluated as a degree 11 Taylor polynomial.
+inline __m128 sin4(__m128 a)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(0.15915494f))));
+    a = _mm_sub_ps(a, _mm_mul_ps(turns, _mm_set1_ps(6.28125f)));
+    a = _mm_sub_ps(a, _mm_mul_ps(turns, _mm_set1_ps(1.9353072e-3f)));
+
+    __m128 sign = _mm_and_ps(a, signMask);
+    __m128 magnitude = _mm_andnot_ps(signMask, a);
+    __m128 x = _mm_or_ps(sign, _mm_min_ps(magnitude, _mm_sub_ps(_mm_set1_ps(3.14159265f), magnitude)));
+
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 poly = _mm_set1_ps(-2.5052108e-8f);
+    poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(2.7557319e-6f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.9841270e-4f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(8.3333333e-3f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.6666667e-1f));
+    return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(poly, x2), x));
+}
+
+inline __m128 cos4(__m128 a)
+{
+    return sin4(_mm_add_ps(a, _mm_set1_ps(1.5707963f)));
+}
+
+} // namespace SimdMath
+#endif
+
+#endif // SIMDMATH_H
@@ -0,0 +1,66 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/**
+ * Helpers shared by the generated scenes and the simulations on the water
+ * grid.
+ */
+namespace Simulation {
+
+// Grid units per unit of t squared, for everything that moves on the
+// [-1, 1] water grid; puts the long Gerstner waves near the speeds of the
+// sines.
+const float gravity = 0.5f;
+
+// Floats from the raw generator output, so generated content is the same
+// with every standard library (the std distributions are implementation
+// defined).
+inline float uniform(std::mt19937 &rng, float low, float high)
+{
+    return low + (high - low) * ((rng() >> 8) * (1.0f / 16777216.0f));
+}
+
+// Box-Muller transform.
+inline float normal(std::mt19937 &rng)
+{
+    float u = uniform(rng, 1e-7f, 1);
+    float v = uniform(rng, 0, 1);
+    return std::sqrt(-2 * std::log(u)) * std::cos(6.2831853f * v);
+}
+
+/**
+ * @brief The StepClock class
+ *
+ * The time step of a simulation that follows the scene clock: the time
+ * since the previous step, but at most maxStep, so a long stall is
+ * simulated as a short one. The first step gives 0, and so does time
+ * standing still or running backwards.
+ */
+class StepClock
+{
+public:
+    explicit StepClock(float maxStep = 0.1f) : maxStep(maxStep) {}
+
+    float advance(double t)
+    {
+        float dt = started ? std::max(0.0f, std::min(static_cast<float>(t - time), maxStep)) : 0;
+        time = t;
+        started = true;
+        return dt;
+    }
+    // The next advance() starts over.
+    void reset() { started = false; }
+
+private:
+    float maxStep;
+    double time = 0;
+    bool started = false;
+};
+
+} // namespace Simulation
+
+#endif // SIMULATION_H
@@ -0,0 +1,196 @@
+#include "sinewaves.h"
+
+#include "simdmath.h"
+#include "trace.h"
+
+#include <QThread>
+#include <cmath>
+
+namespace {
+// M_PI as the shaders define it.
+const double shaderPi = 3.141593;
+const float pi = 3.141593f;
+const float halfPi = 1.5707963f;
+// The period of sin(), to wrap the phases by.
+const double twoPi = 6.283185307179586;
+}
+
+QVector<SineWaves::Wave> SineWaves::defaultWaves()
+{
+    return {
+        { 0.041f, 5.3f, 0.3f },
+        { 0.033f, 2 * std::sqrt(2.0f), 2.0f },
+        { 0.034f, halfPi, 0.2f },
+        { 0.015f, 6.3f, 1.0f },
+        { 0.019f, 1.5f, 1.3f },
+        { 0.029f, 0.55f, 3.8f }
+    };
+}
+
+double SineWaves::height(const QVector<Wave> &waves, double x, double t, double *slope)
+{
+    double sum = 0;
+    double derivative = 0;
+    for (const Wave &wave : waves) {
+        double angle = wave.frequency * shaderPi * x + wave.phase + t;
+        sum += wave.amplitude * std::sin(angle);
+        derivative += wave.frequency * wave.amplitude * shaderPi * std::cos(angle);
+    }
+    if (slope)
+        *slope = derivative;
+    return sum;
+}
+
+SineWaves::SineWaves()
+{
+    setWaves(defaultWaves());
+    setThreadCount(QThread::idealThreadCount());
+}
+
+SineWaves::~SineWaves()
+{
+    pool.waitForDone();
+    qDeleteAll(workers);
+}
+
+void SineWaves::setWaves(const QVector<Wave> &waves)
+{
+    waveSet = waves;
+    waveSet.detach(); // not in the slices
+    phases.resize(waves.size());
+}
+
+const QVector<SineWaves::Wave> &SineWaves::waves() const
+{
+    return waveSet;
+}
+
+void SineWaves::setThreadCount(int threads)
+{
+    pool.waitForDone();
+    qDeleteAll(workers);
+    workers.resize(0);
+
+    slices = qMax(1, threads);
+    pool.setMaxThreadCount(qMax(1, slices - 1));
+    for (int slice = 1; slice < slices; ++slice) {
+        Worker *worker = new Worker;
+        worker->setAutoDelete(false);
+        worker->waves = this;
+        worker->slice = slice;
+        workers.append(worker);
+    }
+}
+
+int SineWaves::threadCount() const
+{
+    return slices;
+}
+
+void SineWaves::setVertices(const QVector<float> &vertices)
+{
+    output = vertices;
+    output.detach(); // not in evaluate()
+    count = vertices.size() / 8;
+    positionX.resize(count);
+    for (int idx = 0; idx < count; ++idx)
+        positionX[idx] = vertices[8 * idx];
+}
+
+/**
+ * @brief SineWaves::evaluate
+ *
+ * Only z and the normal change; x, y and the texture coordinates stay as
+ * setVertices() left them.
+ */
+void SineWaves::evaluate(double t)
+{
+    TRACE_SCOPE("cpu waves");
+    for (int wave = 0; wave < waveSet.size(); ++wave)
+        phases[wave] = static_cast<float>(std::remainder(waveSet[wave].phase + t, twoPi));
+    // Detaches here, if a copy of vertices() still shares output, instead of
+    // in every slice at once.
+    outputData = output.data();
+    for (Worker *worker : workers)
+        pool.start(worker);
+    evaluateSlice(0);
+    finished.acquire(workers.size());
+}
+
+const QVector<float> &SineWaves::vertices() const
+{
+    return output;
+}
+
+int SineWaves::vertexCount() const
+{
+    return count;
+}
+
+// --- Helpers
+
+void SineWaves::Worker::run()
+{
+    waves->evaluateSlice(slice);
+    waves->finished.release();
+}
+
+// Slices start at multiples of four vertices; the last one takes the rest.
+void SineWaves::evaluateSlice(int slice)
+{
+    int first = slice * (count / 4) / slices * 4;
+    int end = slice + 1 == slices ? count : (slice + 1) * (count / 4) / slices * 4;
+    const float *x = positionX.constData();
+    const Wave *waveData = waveSet.constData();
+    const float *phase = phases.constData();
+    int waveCount = waveSet.size();
+    float *vertex = outputData;
+    int idx = first;
+
+#ifdef __SSE2__
+    for (; idx + 4 <= end; idx += 4) {
+        __m128 position = _mm_loadu_ps(x + idx);
+        __m128 sum = _mm_setzero_ps();
+        __m128 derivative = _mm_setzero_ps();
+        for (int i = 0; i < waveCount; ++i) {
+            const Wave &wave = waveData[i];
+            __m128 angle = _mm_add_ps(_mm_mul_ps(position, _mm_set1_ps(wave.frequency * pi)),
+                                      _mm_set1_ps(phase[i]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(wave.amplitude), SimdMath::sin4(angle)));
+            derivative = _mm_add_ps(derivative, _mm_mul_ps(_mm_set1_ps(wave.frequency * wave.amplitude * pi),
+                                                           SimdMath::cos4(angle)));
+        }
+
+        __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1), _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(derivative, derivative),
+                                                                                  _mm_set1_ps(1))));
+        float heights[4], normalX[4], normalZ[4];
+        _mm_storeu_ps(heights, sum);
+        _mm_storeu_ps(normalX, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), derivative), inverseLength));
+        _mm_storeu_ps(normalZ, inverseLength);
+        for (int lane = 0; lane < 4; ++lane) {
+            float *out = vertex + 8 * (idx + lane);
+            out[2] = heights[lane];
+            out[3] = normalX[lane];
+            out[4] = 0;
+            out[5] = normalZ[lane];
+        }
+    }
+#endif
+
+    for (; idx < end; ++idx) {
+        float sum = 0;
+        float derivative = 0;
+        for (int i = 0; i < waveCount; ++i) {
+            const Wave &wave = waveData[i];
+            float angle = wave.frequency * pi * x[idx] + phase[i];
+            sum += wave.amplitude * std::sin(angle);
+            derivative += wave.frequency * wave.amplitude * pi * std::cos(angle);
+        }
+        float inverseLength = 1 / std::sqrt(derivative * derivative + 1);
+        float *out = vertex + 8 * idx;
+        out[2] = sum;
+        out[3] = -derivative * inverseLength;
+        out[4] = 0;
+        out[5] = inverseLength;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SINEWAVES_H
+#define SINEWAVES_H
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+
+/**
+ * @brief The SineWaves class
+ *
+ * The default water on the CPU: every vertex gets the height
+ * sum(a sin(f pi x + phase + t)) and the normal normalize(-dh/dx, 0, 1),
+ * which is what NUM_WAVES in vertshader_uber.glsl computes for the set
+ * WaveSet::fromSines() makes of these waves.
+ *
+ * evaluate() fills an interleaved vertex array in the layout of WaterGrid
+ * (x, y, z, nx, ny, nz, u, v), ready to be streamed into a vertex buffer
+ * and drawn without displacement on the GPU. Four vertices at a time go
+ * through SSE2, with a polynomial sine that is accurate to about 1e-7 on
+ * the reduced range; the vertices are split in contiguous blocks over the
+ * threads of a private pool, and the calling thread takes the first block.
+ *
+ * The phase + t of every wave is wrapped into [-pi, pi) in double precision
+ * once per evaluate(), so a large t does not cost the float angles their
+ * accuracy. height() is the scalar double precision reference the others
+ * are validated against.
+ */
+class SineWaves
+{
+public:
+    struct Wave
+    {
+        float amplitude;
+        float frequency;
+        float phase;
+    };
+
+    // The six waves the water scene always had.
+    static QVector<Wave> defaultWaves();
+
+    // Height and dh/dx at x, time t.
+    static double height(const QVector<Wave> &waves, double x, double t, double *slope = nullptr);
+
+    SineWaves();
+    ~SineWaves();
+
+    void setWaves(const QVector<Wave> &waves);
+    const QVector<Wave> &waves() const;
+    // Number of threads evaluate() uses, including the calling one.
+    void setThreadCount(int threads);
+    int threadCount() const;
+
+    // Takes the undisplaced vertices, in the WaterGrid layout.
+    void setVertices(const QVector<float> &vertices);
+    void evaluate(double t);
+    const QVector<float> &vertices() const;
+    int vertexCount() const;
+
+private:
+    class Worker : public QRunnable
+    {
+    public:
+        SineWaves *waves = nullptr;
+        int slice = 0;
+        void run() override;
+    };
+
+    void evaluateSlice(int slice);
+
+    QVector<Wave> waveSet;
+    QVector<float> phases;    // phase + t of every wave, wrapped in double precision
+    QVector<float> positionX; // of every vertex, contiguous for SSE loads
+    QVector<float> output;
+    float *outputData = nullptr; // output.data(), taken before the slices run
+    int count = 0;
+
+    QThreadPool pool;
+    QVector<Worker *> workers; // one per slice but the first, run by the caller
+    QSemaphore finished;
+    int slices = 1;
+};
+
+#endif // SINEWAVES_H
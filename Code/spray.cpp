@@ -0,0 +1,309 @@
+#include "spray.h"
+
+#include "trace.h"
+
+#include <QDebug>
+#include <cstring>
+
+namespace {
+// The outputs of vertshader_spray_update.glsl, interleaved as the particle buffers.
+const char *varyings[] = { "nextPosition", "nextVelocity" };
+const int floatsPerParticle = 8;
+}
+
+Spray::Spray()
+{
+}
+
+void Spray::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "spray", "Throw count spray particles off the steep water, simulated on the GPU.", "count" },
+        { "spray-threshold", "Slope of the water that spray starts at.", "slope" }
+    });
+}
+
+bool Spray::configure(const QCommandLineParser &parser, Config &config)
+{
+    if (parser.isSet("spray"))
+        config.count = parser.value("spray").toInt();
+    if (parser.isSet("spray-threshold"))
+        config.threshold = parser.value("spray-threshold").toFloat();
+
+    if (config.count < 1 || config.count > maxCount) {
+        qWarning() << ":: The spray particle count must be between 1 and" << maxCount;
+        return false;
+    }
+    if (config.threshold <= 0) {
+        qWarning() << ":: Invalid spray threshold";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Spray::initialize
+ *
+ * The captured outputs have to be named before linking, so the step program
+ * is linked here, as the displacement pass does.
+ */
+bool Spray::initialize(const Config &config)
+{
+    TRACE_GL_SCOPE("spray initialization");
+    initializeOpenGLFunctions();
+    settings = config;
+    clock.reset();
+    stepCount = 0;
+    lastSteps = 0;
+    current = 0;
+
+    stepProgram.create();
+    stepProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/vertshader_spray_update.glsl");
+    glTransformFeedbackVaryings(stepProgram.programId(), 2, varyings, GL_INTERLEAVED_ATTRIBS);
+    if (!stepProgram.link()) {
+        qWarning() << ":: Could not link the spray step:" << qPrintable(stepProgram.log());
+        return false;
+    }
+    uniformSurface = stepProgram.uniformLocation("surface");
+    uniformSurfaceVertices = stepProgram.uniformLocation("surfaceVertices");
+    uniformDt = stepProgram.uniformLocation("dt");
+    uniformSeed = stepProgram.uniformLocation("seed");
+    uniformEmission = stepProgram.uniformLocation("emission");
+    uniformThreshold = stepProgram.uniformLocation("threshold");
+    uniformSpeed = stepProgram.uniformLocation("speed");
+    uniformLifetime = stepProgram.uniformLocation("lifetime");
+    uniformDrag = stepProgram.uniformLocation("drag");
+    uniformGravity = stepProgram.uniformLocation("gravity");
+
+    drawProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/vertshader_spray.glsl");
+    drawProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshader_spray.glsl");
+    if (!drawProgram.link()) {
+        qWarning() << ":: Could not link the spray shaders:" << qPrintable(drawProgram.log());
+        return false;
+    }
+    uniformProjectionTransform = drawProgram.uniformLocation("projectionTransform");
+    uniformModelViewTransform = drawProgram.uniformLocation("modelViewTransform");
+    uniformSize = drawProgram.uniformLocation("size");
+
+    countProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/vertshader_spray_count.glsl");
+    countProgram.addShaderFromSourceFile(QOpenGLShader::Geometry, ":/shaders/geomshader_spray_count.glsl");
+    if (!countProgram.link()) {
+        qWarning() << ":: Could not link the spray count:" << qPrintable(countProgram.log());
+        return false;
+    }
+    glGenQueries(countLatency, countQueries);
+    for (int idx = 0; idx < countLatency; ++idx)
+        countPending[idx] = false;
+    countSlot = 0;
+    livingCount = 0;
+
+    // Written and read by the GPU only. The first step reads buffers[0], so
+    // only that one starts out with every particle dead.
+    qint64 bytes = qint64(settings.count) * floatsPerParticle * sizeof(float);
+    glGenBuffers(2, buffers);
+    glGenVertexArrays(2, stepVaos);
+    glGenVertexArrays(2, drawVaos);
+    for (int idx = 0; idx < 2; ++idx) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[idx]);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+        if (idx == 0) {
+            void *data = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (data)
+                std::memset(data, 0, bytes);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+
+        for (GLuint vao : { stepVaos[idx], drawVaos[idx] }) {
+            glBindVertexArray(vao);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, floatsPerParticle * sizeof(float), 0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, floatsPerParticle * sizeof(float),
+                                  (void *)(4 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+        }
+        // One particle per sprite instance, not per corner.
+        glBindVertexArray(drawVaos[idx]);
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribDivisor(1, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &surface);
+    initialized = true;
+
+    qDebug() << ":: Spray:" << settings.count << "particles,"
+             << qPrintable(QString::number(2.0 * bytes / (1 << 20), 'f', 1)) << "MB";
+    return true;
+}
+
+void Spray::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteQueries(countLatency, countQueries);
+    glDeleteTextures(1, &surface);
+    glDeleteVertexArrays(2, drawVaos);
+    glDeleteVertexArrays(2, stepVaos);
+    glDeleteBuffers(2, buffers);
+    initialized = false;
+}
+
+void Spray::setSource(GLuint buffer, int count)
+{
+    surfaceVertices = count;
+
+    // Two RGBA texels per vertex: x, y, z, nx and ny, nz, u, v.
+    glBindTexture(GL_TEXTURE_BUFFER, surface);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ * @brief Spray::update
+ *
+ * One step per update, of the time since the last one. Time running
+ * backwards or standing still leaves the particles as they are, and
+ * counts nothing.
+ */
+void Spray::update(double t, FrameStats &stats)
+{
+    TRACE_GL_SCOPE("spray");
+    float dt = clock.advance(t);
+    lastSteps = 0;
+    if (!initialized || dt <= 0)
+        return;
+
+    stepProgram.bind();
+    glUniform1i(uniformSurface, 0);
+    glUniform1i(uniformSurfaceVertices, surfaceVertices);
+    glUniform1f(uniformDt, dt);
+    glUniform1ui(uniformSeed, (settings.seed + stepCount) * 2654435761u);
+    glUniform1f(uniformEmission, settings.emission);
+    glUniform1f(uniformThreshold, settings.threshold);
+    glUniform1f(uniformSpeed, settings.speed);
+    glUniform1f(uniformLifetime, settings.lifetime);
+    glUniform1f(uniformDrag, settings.drag);
+    glUniform1f(uniformGravity, Simulation::gravity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, surface);
+    stats.addStateChange();
+    stats.addStateChange();
+    stats.addUniformBytes(uniformSurface, sizeof(GLint));
+    stats.addUniformBytes(uniformSurfaceVertices, sizeof(GLint));
+    stats.addUniformBytes(uniformDt, sizeof(float));
+    stats.addUniformBytes(uniformSeed, sizeof(GLuint));
+    stats.addUniformBytes(uniformEmission, sizeof(float));
+    stats.addUniformBytes(uniformThreshold, sizeof(float));
+    stats.addUniformBytes(uniformSpeed, sizeof(float));
+    stats.addUniformBytes(uniformLifetime, sizeof(float));
+    stats.addUniformBytes(uniformDrag, sizeof(float));
+    stats.addUniformBytes(uniformGravity, sizeof(float));
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(stepVaos[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[1 - current]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, settings.count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    stats.addStateChange();
+    stats.addDraw(0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    stepProgram.release();
+    current = 1 - current;
+
+    // The count of the new state, still without rasterization.
+    readCount();
+    countProgram.bind();
+    glBindVertexArray(stepVaos[current]);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, countQueries[countSlot]);
+    glDrawArrays(GL_POINTS, 0, settings.count);
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    countPending[countSlot] = true;
+    countSlot = (countSlot + 1) % countLatency;
+    countProgram.release();
+    stats.addStateChange();
+    stats.addStateChange();
+    stats.addDraw(0);
+
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    ++stepCount;
+    lastSteps = 1;
+}
+
+/**
+ * @brief Spray::readCount
+ *
+ * Reads the count in the slot about to be reused, issued countLatency steps
+ * ago. If the GPU is that far behind the count is dropped, as the
+ * GpuProfiler drops a frame, and living() keeps the one before.
+ */
+void Spray::readCount()
+{
+    if (!countPending[countSlot])
+        return;
+    countPending[countSlot] = false;
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(countQueries[countSlot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+    GLuint living = 0;
+    glGetQueryObjectuiv(countQueries[countSlot], GL_QUERY_RESULT, &living);
+    livingCount = static_cast<int>(living);
+}
+
+void Spray::draw(const QMatrix4x4 &projection, const QMatrix4x4 &modelView, FrameStats &stats)
+{
+    if (!initialized)
+        return;
+
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    drawProgram.bind();
+    glUniformMatrix4fv(uniformProjectionTransform, 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(uniformModelViewTransform, 1, GL_FALSE, modelView.data());
+    glUniform1f(uniformSize, settings.size);
+    glBindVertexArray(drawVaos[current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, settings.count);
+    glBindVertexArray(0);
+    drawProgram.release();
+    stats.addStateChange();
+    stats.addStateChange();
+    stats.addUniformBytes(uniformProjectionTransform, 16 * sizeof(float));
+    stats.addUniformBytes(uniformModelViewTransform, 16 * sizeof(float));
+    stats.addUniformBytes(uniformSize, sizeof(float));
+    stats.addDraw(2 * static_cast<quint64>(settings.count));
+
+    glDepthMask(GL_TRUE);
+    if (!blend)
+        glDisable(GL_BLEND);
+}
+
+const Spray::Config &Spray::config() const
+{
+    return settings;
+}
+
+int Spray::capacity() const
+{
+    return settings.count;
+}
+
+int Spray::living() const
+{
+    return livingCount;
+}
+
+int Spray::steps() const
+{
+    return lastSteps;
+}
@@ -0,0 +1,134 @@
+#ifndef SPRAY_H
+#define SPRAY_H
+
+#include "framestats.h"
+#include "simulation.h"
+
+#include <QCommandLineParser>
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+
+/**
+ * @brief The Spray class
+ *
+ * Spray and foam thrown off the steep parts of the water, entirely on the
+ * GPU. Every particle is a position with the life it has left and a
+ * velocity with the height it left the water at, eight floats in one of
+ * two buffers. A step runs vertshader_spray_update.glsl over all particles
+ * of one buffer as points with rasterization discarded, and transform
+ * feedback writes them into the other; the two swap every step.
+ *
+ * A living particle falls and slows down, and dies when its life runs out
+ * or it falls back below where it left the water. A dead one picks a random
+ * vertex of the displaced water surface, read through a texture buffer from
+ * the vertices the water already displaced, and is emitted there with a
+ * chance that grows with the slope above the threshold. Emitted particles
+ * fly off along the normal with some jitter. Randomness comes from hashing
+ * the particle index with a seed that changes every step.
+ *
+ * The particles are drawn as instanced sprites: a quad per particle facing
+ * the camera, whose corners come from gl_VertexID and whose centre comes
+ * from the particle buffer with an attribute divisor. Dead particles
+ * collapse to a point outside the view. The CPU does no work per particle.
+ *
+ * After every step a count pass runs over the new buffer with
+ * rasterization discarded; geomshader_spray_count.glsl emits a point for
+ * every living particle only, and a GL_PRIMITIVES_GENERATED query counts
+ * them. The queries form a ring countLatency steps deep and are read back
+ * when it comes around, as the GpuProfiler does, so reading never stalls;
+ * a count the GPU has not answered yet is skipped instead of waited on.
+ *
+ * The surface is the grid displaced by the waves; ripples drawn on top of
+ * it do not throw spray.
+ *
+ * initialize(), destroy(), setSource(), update() and draw() must be called
+ * with the GL context current; update() and draw() count themselves into
+ * the stats.
+ */
+class Spray : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Config
+    {
+        int count = 1 << 20;
+        float emission = 1;     // chance per unit of t that a dead particle tries a vertex
+        float threshold = 0.6f; // slope spray starts at; twice this always emits
+        float speed = 0.3f;     // grid units per unit of t, at emission
+        float lifetime = 1.5f;  // units of t, the longest
+        float drag = 1;         // of the velocity, per unit of t
+        float size = 0.004f;    // grid units, half the sprite width
+        quint32 seed = 1;
+    };
+
+    static const int maxCount = 1 << 22;
+    static const int countLatency = 4; // steps before a count of the living is read
+
+    Spray();
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills config from the options added by addOptions().
+    static bool configure(const QCommandLineParser &parser, Config &config);
+
+    // Links the programs and allocates both buffers, with every particle dead.
+    bool initialize(const Config &config);
+    void destroy();
+
+    // Emits from count displaced vertices in the WaterGrid layout in buffer.
+    void setSource(GLuint buffer, int count);
+    // Steps the particles to time t, by at most a tenth of a unit of t.
+    void update(double t, FrameStats &stats);
+    // Draws the particles with depth test but without depth writes.
+    void draw(const QMatrix4x4 &projection, const QMatrix4x4 &modelView, FrameStats &stats);
+
+    const Config &config() const;
+    // Particles simulated and drawn, alive or not.
+    int capacity() const;
+    // Living particles, as counted countLatency or more steps ago.
+    int living() const;
+    // Steps taken by the last update(), 0 or 1.
+    int steps() const;
+
+private:
+    void readCount();
+
+    Config settings;
+    Simulation::StepClock clock;
+    quint32 stepCount = 0;
+    int lastSteps = 0;
+
+    bool initialized = false;
+    QOpenGLShaderProgram stepProgram;
+    GLint uniformSurface = -1;
+    GLint uniformSurfaceVertices = -1;
+    GLint uniformDt = -1;
+    GLint uniformSeed = -1;
+    GLint uniformEmission = -1;
+    GLint uniformThreshold = -1;
+    GLint uniformSpeed = -1;
+    GLint uniformLifetime = -1;
+    GLint uniformDrag = -1;
+    GLint uniformGravity = -1;
+
+    QOpenGLShaderProgram drawProgram;
+    GLint uniformProjectionTransform = -1;
+    GLint uniformModelViewTransform = -1;
+    GLint uniformSize = -1;
+
+    QOpenGLShaderProgram countProgram;
+    GLuint countQueries[countLatency] = {};
+    bool countPending[countLatency] = {};
+    int countSlot = 0;
+    int livingCount = 0;
+
+    // The particles, read from buffers[current] and written to the other one.
+    GLuint buffers[2] = { 0, 0 };
+    GLuint stepVaos[2] = { 0, 0 };
+    GLuint drawVaos[2] = { 0, 0 };
+    int current = 0;
+
+    GLuint surface = 0; // texture buffer over the source vertices
+    int surfaceVertices = 0;
+};
+
+#endif // SPRAY_H
@@ -0,0 +1,211 @@
+#include "statsoverlay.h"
+
+#include <QDebug>
+#include <QFont>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+
+namespace {
+const int firstGlyph = 32;  // ' '
+const int lastGlyph = 126;  // '~'
+const int atlasColumns = 16;
+const int floatsPerGlyph = 6 * 4;
+}
+
+StatsOverlay::StatsOverlay()
+{
+}
+
+void StatsOverlay::initialize(int maxGlyphs)
+{
+    initializeOpenGLFunctions();
+
+    program.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/vertshader_text.glsl");
+    program.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshader_text.glsl");
+    if (!program.link()) {
+        qWarning() << ":: Could not link the stats overlay shaders";
+        return;
+    }
+    uniformViewportSize = program.uniformLocation("viewportSize");
+    uniformGlyphs = program.uniformLocation("glyphs");
+
+    createAtlas();
+
+    this->maxGlyphs = maxGlyphs;
+    vertices.reserve(maxGlyphs * floatsPerGlyph);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, maxGlyphs * floatsPerGlyph * sizeof(float), nullptr, GL_STREAM_DRAW);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    initialized = true;
+}
+
+void StatsOverlay::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteTextures(1, &atlas);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    program.removeAllShaders();
+    initialized = false;
+}
+
+void StatsOverlay::draw(const FrameCounters &counters, int viewportWidth, int viewportHeight, FrameStats &stats)
+{
+    if (!initialized)
+        return;
+
+    // Formatted into a fixed buffer, so nothing is allocated per frame.
+    char line[128];
+    float y = 4;
+    vertices.resize(0);
+
+    qsnprintf(line, sizeof(line), "cpu %6.2f ms   gpu %6.2f ms", counters.cpuMilliseconds, counters.gpuMilliseconds);
+    addText(line, 4, y);
+    y += glyphHeight;
+    qsnprintf(line, sizeof(line), "draws %u   triangles %llu   culled %u", counters.drawCalls,
+              static_cast<unsigned long long>(counters.triangles), counters.culledObjects);
+    addText(line, 4, y);
+    y += glyphHeight;
+    qsnprintf(line, sizeof(line), "state changes %u   uniforms %llu B", counters.stateChanges,
+              static_cast<unsigned long long>(counters.uniformBytes));
+    addText(line, 4, y);
+    y += glyphHeight;
+    qsnprintf(line, sizeof(line), "uploads: buffers %llu B   textures %llu B",
+              static_cast<unsigned long long>(counters.bufferBytes),
+              static_cast<unsigned long long>(counters.textureBytes));
+    addText(line, 4, y);
+    if (counters.particleCapacity > 0) {
+        y += glyphHeight;
+        qsnprintf(line, sizeof(line), "particles %u of %u   simulation %6.2f ms", counters.particles,
+                  counters.particleCapacity, counters.simulationMilliseconds);
+        addText(line, 4, y);
+    }
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    program.bind();
+    glUniform2f(uniformViewportSize, viewportWidth, viewportHeight);
+    stats.addUniformBytes(uniformViewportSize, 2 * sizeof(float));
+    glUniform1i(uniformGlyphs, 0);
+    stats.addUniformBytes(uniformGlyphs, sizeof(GLint));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glBindVertexArray(vao);
+    stats.addStateChange();
+    stats.addStateChange();
+    stats.addStateChange();
+
+    // Orphan the buffer, so the upload never waits on last frame's draw.
+    qint64 bytes = vertices.size() * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, maxGlyphs * floatsPerGlyph * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.constData());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    stats.current().bufferBytes += bytes;
+
+    glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 4);
+    stats.addDraw(vertices.size() / 12);
+
+    glBindVertexArray(0);
+    program.release();
+
+    if (!blend)
+        glDisable(GL_BLEND);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
+
+// --- Helpers
+
+/**
+ * @brief StatsOverlay::createAtlas
+ *
+ * Renders the printable ASCII range in a fixed-width font into a grid of
+ * equally sized cells. Image rows are uploaded top first, so v grows
+ * downwards in the atlas, like y on screen.
+ */
+void StatsOverlay::createAtlas()
+{
+    QFont font("Monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPixelSize(13);
+    QFontMetrics metrics(font);
+    glyphWidth = metrics.width('M');
+    glyphHeight = metrics.height();
+
+    int rows = (lastGlyph - firstGlyph + atlasColumns) / atlasColumns;
+    atlasWidth = atlasColumns * glyphWidth;
+    atlasHeight = rows * glyphHeight;
+
+    QImage image(atlasWidth, atlasHeight, QImage::Format_RGBA8888);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    for (int glyph = firstGlyph; glyph <= lastGlyph; ++glyph) {
+        int cell = glyph - firstGlyph;
+        int x = (cell % atlasColumns) * glyphWidth;
+        int y = (cell / atlasColumns) * glyphHeight;
+        painter.drawText(x, y + metrics.ascent(), QString(QChar(glyph)));
+    }
+    painter.end();
+
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Appends two triangles per character, spaces included so the background
+// is continuous; stops at maxGlyphs.
+void StatsOverlay::addText(const char *text, float x, float y)
+{
+    for (const char *c = text; *c; ++c, x += glyphWidth) {
+        int glyph = static_cast<unsigned char>(*c);
+        if (glyph < firstGlyph || glyph > lastGlyph)
+            continue;
+        if (vertices.size() + floatsPerGlyph > maxGlyphs * floatsPerGlyph)
+            return;
+
+        int cell = glyph - firstGlyph;
+        float u0 = float((cell % atlasColumns) * glyphWidth) / atlasWidth;
+        float v0 = float((cell / atlasColumns) * glyphHeight) / atlasHeight;
+        float u1 = u0 + float(glyphWidth) / atlasWidth;
+        float v1 = v0 + float(glyphHeight) / atlasHeight;
+        float x1 = x + glyphWidth;
+        float y1 = y + glyphHeight;
+
+        const float quad[floatsPerGlyph] = {
+            x,  y,  u0, v0,   x1, y,  u1, v0,   x1, y1, u1, v1,
+            x,  y,  u0, v0,   x1, y1, u1, v1,   x,  y1, u0, v1
+        };
+        for (float value : quad)
+            vertices.append(value);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef STATSOVERLAY_H
+#define STATSOVERLAY_H
+
+#include "framestats.h"
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector>
+
+/**
+ * @brief The StatsOverlay class
+ *
+ * Draws FrameCounters as text in the top left corner. The glyphs come from
+ * a font atlas rendered once with QPainter; all text of a frame is written
+ * into one streaming vertex buffer and drawn with a single draw call.
+ * Drawing does not allocate.
+ *
+ * All functions must be called with the GL context current.
+ */
+class StatsOverlay : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    StatsOverlay();
+
+    void initialize(int maxGlyphs = 2048);
+    void destroy();
+
+    // Draws on top of whatever is in the framebuffer; counts itself into stats.
+    void draw(const FrameCounters &counters, int viewportWidth, int viewportHeight, FrameStats &stats);
+
+private:
+    void createAtlas();
+    void addText(const char *text, float x, float y);
+
+    bool initialized = false;
+    QOpenGLShaderProgram program;
+    GLint uniformViewportSize = -1;
+    GLint uniformGlyphs = -1;
+
+    GLuint atlas = 0;
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    int glyphWidth = 0;
+    int glyphHeight = 0;
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    int maxGlyphs = 0;
+    QVector<float> vertices; // x, y in pixels from the top left, u, v
+};
+
+#endif // STATSOVERLAY_H
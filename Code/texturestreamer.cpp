@@ -0,0 +1,343 @@
+#include "texturestreamer.h"
+
+#include <QDebug>
+#include <cstring>
+
+TextureStreamer::TextureStreamer()
+{
+}
+
+/**
+ * @brief TextureStreamer::initialize
+ *
+ * Creates the ring of pixel buffer objects used for uploads.
+ *
+ * @param ringSize Number of transfers that may be in flight at once
+ * @param slotBytes Size of every pixel buffer; larger levels are split in rows
+ */
+void TextureStreamer::initialize(int ringSize, int slotBytes)
+{
+    initializeOpenGLFunctions();
+
+    this->slotBytes = slotBytes;
+    slots.resize(ringSize);
+    for (Slot &slot : slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes, nullptr, GL_STREAM_DRAW);
+        slot.fence = 0;
+        slot.textureIdx = -1;
+        slot.generation = 0;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::destroy()
+{
+    for (Slot &slot : slots) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slots.clear();
+    textures.clear();
+    resident = 0;
+}
+
+void TextureStreamer::request(GLuint texture, MipChain mips)
+{
+    // Levels wider than a streaming slot cannot be transferred; start lower in the chain.
+    while (!mips.isEmpty() && mips.first().width * 4 > slotBytes) {
+        qDebug() << ":: Texture level too wide to stream:" << mips.first().width;
+        mips.removeFirst();
+    }
+    if (mips.isEmpty())
+        return;
+
+    StreamedTexture tex;
+    tex.texture = texture;
+    tex.mips = mips;
+    tex.residentLevel = mips.size();
+    tex.wantedLevel = 0;
+    tex.uploadingLevel = -1;
+    tex.rowsSubmitted = 0;
+    tex.chunksInFlight = 0;
+    tex.lastUsedFrame = frame;
+    tex.generation = ++requests;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mips.size() - 1);
+
+    int idx = findTexture(texture);
+    if (idx < 0) {
+        textures.append(tex);
+    } else {
+        const StreamedTexture &old = textures[idx];
+        for (int level = old.residentLevel; level < old.mips.size(); ++level)
+            resident -= levelBytes(old.mips[level]);
+        textures[idx] = tex;
+    }
+}
+
+void TextureStreamer::touch(GLuint texture)
+{
+    int idx = findTexture(texture);
+    if (idx < 0)
+        return;
+
+    textures[idx].lastUsedFrame = frame;
+    textures[idx].wantedLevel = 0;
+}
+
+void TextureStreamer::processUploads()
+{
+    ++frame;
+    retireSlots();
+    startUploads();
+    evictToBudget();
+}
+
+void TextureStreamer::setMemoryBudget(qint64 bytes)
+{
+    memoryBudget = bytes;
+}
+
+void TextureStreamer::setUploadBytesPerFrame(qint64 bytes)
+{
+    uploadBytesPerFrame = bytes;
+}
+
+qint64 TextureStreamer::residentBytes() const
+{
+    return resident;
+}
+
+qint64 TextureStreamer::uploadedBytes() const
+{
+    return lastUploadBytes;
+}
+
+bool TextureStreamer::isIdle() const
+{
+    for (const StreamedTexture &tex : textures) {
+        if (tex.uploadingLevel >= 0 || tex.residentLevel > tex.wantedLevel)
+            return false;
+    }
+    return true;
+}
+
+// --- Transfers
+
+int TextureStreamer::findTexture(GLuint texture) const
+{
+    for (int i = 0; i != textures.size(); ++i) {
+        if (textures[i].texture == texture)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief TextureStreamer::retireSlots
+ *
+ * Frees every slot whose transfer the GPU has finished, without waiting.
+ * A level only becomes resident once all of its chunks have landed. Chunks
+ * of a chain that was requested again while they were in flight belong to
+ * an older generation and only free their slot; the new chain may already
+ * have chunks of its own in flight.
+ */
+void TextureStreamer::retireSlots()
+{
+    for (Slot &slot : slots) {
+        if (slot.textureIdx < 0)
+            continue;
+
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        StreamedTexture &tex = textures[slot.textureIdx];
+        slot.textureIdx = -1;
+        if (slot.generation != tex.generation)
+            continue;
+
+        --tex.chunksInFlight;
+        if (tex.chunksInFlight == 0
+                && tex.rowsSubmitted == tex.mips[tex.uploadingLevel].height)
+            finishLevel(tex);
+    }
+}
+
+/**
+ * @brief TextureStreamer::startUploads
+ *
+ * Fills free slots with the coarsest missing level of any texture, so all
+ * textures get their low mips before any of them gets its full resolution.
+ */
+void TextureStreamer::startUploads()
+{
+    qint64 bytesLeft = uploadBytesPerFrame;
+
+    for (int slotIdx = 0; slotIdx != slots.size() && bytesLeft > 0; ++slotIdx) {
+        if (slots[slotIdx].textureIdx >= 0)
+            continue;
+
+        // Continue a level that is already partially submitted first.
+        int best = -1;
+        int bestLevel = -1;
+        for (int i = 0; i != textures.size(); ++i) {
+            const StreamedTexture &tex = textures[i];
+            int level;
+            if (tex.uploadingLevel >= 0) {
+                if (tex.rowsSubmitted == tex.mips[tex.uploadingLevel].height)
+                    continue;
+                level = tex.mips.size();
+            } else if (tex.residentLevel > tex.wantedLevel) {
+                level = tex.residentLevel - 1;
+            } else {
+                continue;
+            }
+
+            if (level > bestLevel) {
+                best = i;
+                bestLevel = level;
+            }
+        }
+
+        if (best < 0)
+            break;
+        submitChunk(slotIdx, best, bytesLeft);
+    }
+    lastUploadBytes = uploadBytesPerFrame - bytesLeft;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::submitChunk(int slotIdx, int textureIdx, qint64 &bytesLeft)
+{
+    StreamedTexture &tex = textures[textureIdx];
+    Slot &slot = slots[slotIdx];
+
+    glBindTexture(GL_TEXTURE_2D, tex.texture);
+
+    if (tex.uploadingLevel < 0) {
+        tex.uploadingLevel = tex.residentLevel - 1;
+        tex.rowsSubmitted = 0;
+
+        // Allocate storage for the level only when it starts streaming.
+        const MipLevel &level = tex.mips[tex.uploadingLevel];
+        glTexImage2D(GL_TEXTURE_2D, tex.uploadingLevel, GL_RGBA8, level.width, level.height,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    const MipLevel &level = tex.mips[tex.uploadingLevel];
+    int rowBytes = level.width * 4;
+    int rows = qMin(level.height - tex.rowsSubmitted, slotBytes / rowBytes);
+    int chunkBytes = rows * rowBytes;
+
+    // The fence guarantees the GPU is done with this buffer, so no implicit sync is needed.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, chunkBytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dst) {
+        submitDirect(tex, rows);
+        bytesLeft -= chunkBytes;
+        return;
+    }
+    std::memcpy(dst, level.pixels.constData() + tex.rowsSubmitted * rowBytes, chunkBytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glTexSubImage2D(GL_TEXTURE_2D, tex.uploadingLevel, 0, tex.rowsSubmitted, level.width, rows,
+                    GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.textureIdx = textureIdx;
+    slot.generation = tex.generation;
+    tex.rowsSubmitted += rows;
+    ++tex.chunksInFlight;
+    bytesLeft -= chunkBytes;
+}
+
+/**
+ * @brief TextureStreamer::submitDirect
+ *
+ * Uploads rows of the level being streamed straight from the decoded
+ * pixels, for when a slot cannot be mapped. The copy happens before GL
+ * returns, so nothing is left in flight; the level is finished here if
+ * these were its last rows and no earlier chunk is still in flight.
+ */
+void TextureStreamer::submitDirect(StreamedTexture &tex, int rows)
+{
+    qWarning() << ":: Could not map a texture upload buffer; uploading directly";
+
+    const MipLevel &level = tex.mips[tex.uploadingLevel];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, tex.uploadingLevel, 0, tex.rowsSubmitted, level.width, rows,
+                    GL_RGBA, GL_UNSIGNED_BYTE, level.pixels.constData() + tex.rowsSubmitted * level.width * 4);
+    tex.rowsSubmitted += rows;
+    if (tex.chunksInFlight == 0 && tex.rowsSubmitted == level.height)
+        finishLevel(tex);
+}
+
+void TextureStreamer::finishLevel(StreamedTexture &tex)
+{
+    resident += levelBytes(tex.mips[tex.uploadingLevel]);
+    tex.residentLevel = tex.uploadingLevel;
+    tex.uploadingLevel = -1;
+    tex.rowsSubmitted = 0;
+    applyLevelRange(tex);
+}
+
+// --- Residency
+
+/**
+ * @brief TextureStreamer::evictToBudget
+ *
+ * Drops the finest resident level of the least recently drawn texture until
+ * the budget is met. Textures drawn within the grace period, textures that
+ * are still uploading and the coarsest level of every texture are kept.
+ */
+void TextureStreamer::evictToBudget()
+{
+    while (resident > memoryBudget) {
+        int victim = -1;
+        for (int i = 0; i != textures.size(); ++i) {
+            const StreamedTexture &tex = textures[i];
+            if (tex.uploadingLevel >= 0 || tex.residentLevel >= tex.mips.size() - 1)
+                continue;
+            if (frame - tex.lastUsedFrame < evictionGraceFrames)
+                continue;
+            if (victim < 0 || tex.lastUsedFrame < textures[victim].lastUsedFrame)
+                victim = i;
+        }
+
+        if (victim < 0)
+            return;
+
+        StreamedTexture &tex = textures[victim];
+        int level = tex.residentLevel;
+        ++tex.residentLevel;
+        tex.wantedLevel = tex.residentLevel;
+        applyLevelRange(tex);
+
+        // A zero sized image releases the storage of the dropped level.
+        glBindTexture(GL_TEXTURE_2D, tex.texture);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        resident -= levelBytes(tex.mips[level]);
+    }
+}
+
+void TextureStreamer::applyLevelRange(const StreamedTexture &tex)
+{
+    glBindTexture(GL_TEXTURE_2D, tex.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, qMin(tex.residentLevel, tex.mips.size() - 1));
+}
+
+qint64 TextureStreamer::levelBytes(const MipLevel &level)
+{
+    return static_cast<qint64>(level.width) * level.height * 4;
+}
@@ -0,0 +1,101 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QVector>
+
+/**
+ * @brief The TextureStreamer class
+ *
+ * Streams decoded mip chains into textures through a ring of pixel buffer
+ * objects, so large images are uploaded over several frames instead of
+ * stalling the frame they are loaded in. The coarsest levels are uploaded
+ * first, so every texture becomes usable (blurry) almost immediately.
+ *
+ * A small LRU residency manager keeps the GPU side under a memory budget by
+ * dropping the finest levels of textures that have not been drawn recently.
+ * Those levels are streamed in again as soon as the texture is touched.
+ *
+ * All functions except decode helpers must be called with the GL context current.
+ */
+class TextureStreamer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct MipLevel
+    {
+        int width;
+        int height;
+        QVector<quint8> pixels; // RGBA8, bottom row first
+    };
+    typedef QVector<MipLevel> MipChain; // finest level first
+
+    TextureStreamer();
+
+    void initialize(int ringSize = 4, int slotBytes = 4 << 20);
+    void destroy();
+
+    // Hands a decoded mip chain to the streamer; nothing is uploaded yet.
+    void request(GLuint texture, MipChain mips);
+
+    // Marks a texture as used in the current frame.
+    void touch(GLuint texture);
+
+    // Retires finished transfers, starts new ones and enforces the budget.
+    // Call once per frame, before drawing.
+    void processUploads();
+
+    void setMemoryBudget(qint64 bytes);
+    void setUploadBytesPerFrame(qint64 bytes);
+    qint64 residentBytes() const;
+    qint64 uploadedBytes() const; // by the last processUploads()
+    bool isIdle() const;
+
+private:
+    struct StreamedTexture
+    {
+        GLuint texture;
+        MipChain mips;
+        int residentLevel;  // finest level on the GPU, mips.size() if none
+        int wantedLevel;    // finest level the texture should end up with
+        int uploadingLevel; // level being transferred, -1 if none
+        int rowsSubmitted;
+        int chunksInFlight;
+        quint64 lastUsedFrame;
+        quint32 generation; // of the request() the mips came from
+    };
+
+    struct Slot
+    {
+        GLuint buffer;
+        GLsync fence;
+        int textureIdx; // -1 when the slot is free
+        quint32 generation; // of the texture when the chunk was submitted
+    };
+
+    int findTexture(GLuint texture) const;
+    void retireSlots();
+    void startUploads();
+    void submitChunk(int slotIdx, int textureIdx, qint64 &bytesLeft);
+    void submitDirect(StreamedTexture &tex, int rows);
+    void finishLevel(StreamedTexture &tex);
+    void evictToBudget();
+    void applyLevelRange(const StreamedTexture &tex);
+
+    static qint64 levelBytes(const MipLevel &level);
+
+    QVector<StreamedTexture> textures;
+    QVector<Slot> slots;
+    int slotBytes = 0;
+
+    qint64 memoryBudget = 64 << 20;
+    qint64 uploadBytesPerFrame = 8 << 20;
+    qint64 resident = 0;
+    qint64 lastUploadBytes = 0;
+    quint64 frame = 0;
+    quint32 requests = 0;
+
+    // Textures drawn within this many frames are never evicted.
+    static const quint64 evictionGraceFrames = 120;
+};
+
+#endif // TEXTURESTREAMER_H
@@ -0,0 +1,227 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+#ifndef GL_DEBUG_SOURCE_APPLICATION
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#endif
+
+namespace {
+const int ringCapacity = 1 << 16; // spans per thread
+
+struct Span
+{
+    const char *name;
+    qint64 begin;
+    qint64 end;
+    AllocTracker::Counts allocations;
+};
+
+// Written only by its own thread; written is published after the span.
+struct ThreadBuffer
+{
+    QVector<Span> ring;
+    std::atomic<quint64> written;
+    int tid;
+    QString name;
+};
+
+typedef void (QOPENGLF_APIENTRYP PushDebugGroup)(GLenum source, GLuint id, GLsizei length, const GLchar *message);
+typedef void (QOPENGLF_APIENTRYP PopDebugGroup)();
+
+std::atomic<bool> enabled(false);
+PushDebugGroup pushDebugGroup = nullptr;
+PopDebugGroup popDebugGroup = nullptr;
+
+// Buffers are never freed, pool threads record until the end of the program.
+QMutex buffersMutex;
+QVector<ThreadBuffer *> buffers;
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer *currentBuffer()
+{
+    if (!threadBuffer) {
+        ThreadBuffer *buffer = new ThreadBuffer;
+        buffer->ring.resize(ringCapacity);
+        buffer->written = 0;
+
+        QMutexLocker locker(&buffersMutex);
+        buffer->tid = buffers.size() + 1;
+        buffer->name = QThread::currentThread()->objectName();
+        if (buffer->name.isEmpty()) {
+            bool main = QCoreApplication::instance()
+                    && QThread::currentThread() == QCoreApplication::instance()->thread();
+            buffer->name = main ? QString("main") : QString("thread %1").arg(buffer->tid);
+        }
+        buffers.append(buffer);
+        threadBuffer = buffer;
+    }
+    return threadBuffer;
+}
+}
+
+// --- Scopes
+
+Trace::Scope::Scope(const char *name)
+    : name(name), begin(enabled.load(std::memory_order_relaxed) ? now() : -1)
+{
+#ifdef ALLOC_TRACKING
+    allocations = AllocTracker::thread();
+#endif
+}
+
+Trace::Scope::~Scope()
+{
+    if (begin < 0)
+        return;
+#ifdef ALLOC_TRACKING
+    record(name, begin, now(), AllocTracker::thread() - allocations);
+#else
+    record(name, begin, now());
+#endif
+}
+
+Trace::GlScope::GlScope(const char *name)
+    : scope(name), pushed(enabled.load(std::memory_order_relaxed) && pushDebugGroup)
+{
+    if (pushed)
+        pushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+Trace::GlScope::~GlScope()
+{
+    if (pushed)
+        popDebugGroup();
+}
+
+// --- Public interface
+
+void Trace::setEnabled(bool enable)
+{
+    now(); // starts the clock
+    enabled = enable;
+}
+
+bool Trace::isEnabled()
+{
+    return enabled;
+}
+
+/**
+ * @brief Trace::initializeGL
+ *
+ * Debug groups are core since OpenGL 4.3 and otherwise need KHR_debug;
+ * without either, GL scopes only record the CPU span.
+ */
+void Trace::initializeGL()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context)
+        return;
+
+    QPair<int, int> version = context->format().version();
+    if (version < qMakePair(4, 3) && !context->hasExtension("GL_KHR_debug"))
+        return;
+
+    pushDebugGroup = reinterpret_cast<PushDebugGroup>(context->getProcAddress("glPushDebugGroup"));
+    popDebugGroup = reinterpret_cast<PopDebugGroup>(context->getProcAddress("glPopDebugGroup"));
+    if (!pushDebugGroup || !popDebugGroup) {
+        pushDebugGroup = nullptr;
+        popDebugGroup = nullptr;
+    }
+}
+
+void Trace::setThreadName(const QString &name)
+{
+    currentBuffer()->name = name;
+}
+
+void Trace::record(const char *name, qint64 begin, qint64 end, AllocTracker::Counts allocations)
+{
+    ThreadBuffer *buffer = currentBuffer();
+    quint64 written = buffer->written.load(std::memory_order_relaxed);
+    Span &span = buffer->ring[written % ringCapacity];
+    span.name = name;
+    span.begin = begin;
+    span.end = end;
+    span.allocations = allocations;
+    buffer->written.store(written + 1, std::memory_order_release);
+}
+
+qint64 Trace::now()
+{
+    static QElapsedTimer clock = [] { QElapsedTimer timer; timer.start(); return timer; }();
+    return clock.nsecsElapsed();
+}
+
+/**
+ * @brief Trace::writeChromeJson
+ *
+ * Writes every recorded span as a complete ("X") event, plus the thread names
+ * as metadata events. Timestamps are in microseconds; allocation counts, when
+ * tracked, are in the args of each event.
+ */
+bool Trace::writeChromeJson(const QString &file)
+{
+    QJsonArray events;
+
+    QMutexLocker locker(&buffersMutex);
+    for (ThreadBuffer *buffer : buffers) {
+        QJsonObject threadName;
+        threadName["name"] = "thread_name";
+        threadName["ph"] = "M";
+        threadName["pid"] = 1;
+        threadName["tid"] = buffer->tid;
+        threadName["args"] = QJsonObject{{"name", buffer->name}};
+        events.append(threadName);
+
+        quint64 written = buffer->written.load(std::memory_order_acquire);
+        quint64 first = written > quint64(ringCapacity) ? written - ringCapacity : 0;
+        for (quint64 idx = first; idx != written; ++idx) {
+            const Span &span = buffer->ring[idx % ringCapacity];
+            QJsonObject event;
+            event["name"] = span.name;
+            event["ph"] = "X";
+            event["pid"] = 1;
+            event["tid"] = buffer->tid;
+            event["ts"] = span.begin / 1e3;
+            event["dur"] = (span.end - span.begin) / 1e3;
+            if (AllocTracker::isEnabled()) {
+                event["args"] = QJsonObject{{"allocations", double(span.allocations.allocations)},
+                                            {"bytes", double(span.allocations.bytes)}};
+            }
+            events.append(event);
+        }
+    }
+    locker.unlock();
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    QSaveFile out(file);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << ":: Could not write trace" << file;
+        return false;
+    }
+    out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!out.commit()) {
+        qWarning() << ":: Could not write trace" << file;
+        return false;
+    }
+    qDebug() << ":: Wrote" << events.size() << "trace events to" << file;
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "alloctracker.h"
+
+#include <QString>
+
+// Records a CPU span named name for the rest of the enclosing block.
+#define TRACE_SCOPE(name) Trace::Scope TRACE_NAME(traceScope_, __LINE__)(name)
+
+// Like TRACE_SCOPE, and also wraps the GL calls of the block in a KHR_debug
+// group, so GL capture tools show the same structure. GL thread only.
+#define TRACE_GL_SCOPE(name) Trace::GlScope TRACE_NAME(traceScope_, __LINE__)(name)
+
+#define TRACE_NAME(prefix, line) TRACE_NAME_(prefix, line)
+#define TRACE_NAME_(prefix, line) prefix##line
+
+/**
+ * @brief The Trace class
+ *
+ * Low-overhead timeline of CPU spans, exported as Chrome trace_event JSON
+ * (chrome://tracing, ui.perfetto.dev). Every thread records into its own
+ * fixed-size ring buffer, so recording takes no locks; a thread only takes a
+ * lock once, to register its buffer. When a ring is full the oldest spans
+ * are overwritten.
+ *
+ * Tracing is off until setEnabled(true); disabled scopes cost one branch.
+ * Span names must outlive the trace, string literals are intended. With
+ * ALLOC_TRACKING, every span also records the allocations made in it.
+ */
+class Trace
+{
+public:
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name);
+        ~Scope();
+
+    private:
+        const char *name;
+        qint64 begin; // -1 when tracing is disabled
+#ifdef ALLOC_TRACKING
+        AllocTracker::Counts allocations;
+#endif
+    };
+
+    class GlScope
+    {
+    public:
+        explicit GlScope(const char *name);
+        ~GlScope();
+
+    private:
+        Scope scope;
+        bool pushed;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Resolves the KHR_debug group functions of the current context.
+    static void initializeGL();
+
+    // Names the calling thread in the exported trace.
+    static void setThreadName(const QString &name);
+
+    // Should be called when no other thread is recording.
+    static bool writeChromeJson(const QString &file);
+
+    static void record(const char *name, qint64 begin, qint64 end,
+                       AllocTracker::Counts allocations = AllocTracker::Counts());
+    static qint64 now(); // nanoseconds since the first call
+};
+
+#endif // TRACE_H
@@ -9,15 +9,14 @@ void MainView::keyPressEvent(QKeyEvent *ev)
 {
     switch(ev->key()) {
     case 'A': qDebug() << "A pressed"; break;
+    case 'S': toggleStats(); break;
+    case Qt::Key_Space: toggleAnimation(); break;
     default:
         // ev->key() is an integer. For alpha numeric characters keys it equivalent with the char value ('A' == 65, '1' == 49)
         // Alternatively, you could use Qt Key enums, see http://doc.qt.io/qt-5/qt.html#Key-enum
         qDebug() << ev->key() << "pressed";
         break;
     }
-
-    // Used to update the screen after changes
-    update();
 }
 
 // Triggered by releasing a key
@@ -29,8 +28,6 @@ void MainView::keyReleaseEvent(QKeyEvent *ev)
         qDebug() << ev->key() << "released";
         break;
     }
-
-    update();
 }
 
 // Triggered by clicking two subsequent times on any mouse button
@@ -38,15 +35,11 @@ void MainView::keyReleaseEvent(QKeyEvent *ev)
 void MainView::mouseDoubleClickEvent(QMouseEvent *ev)
 {
     qDebug() << "Mouse double clicked:" << ev->button();
-
-    update();
 }
 
 // Triggered when moving the mouse inside the window (only when the mouse is clicked!)
 void MainView::mouseMoveEvent(QMouseEvent *ev)
 {
-    qDebug() << "x" << ev->x() << "y" << ev->y();
-
     int xDiff = curX - ev->x();
     int yDiff = curY - ev->y();
 
@@ -56,8 +49,6 @@ void MainView::mouseMoveEvent(QMouseEvent *ev)
 //    else
 //        setViewRotation(yDiff, 0, 0);
     setViewRotation(mouseScale * yDiff, mouseScale * xDiff, 0);
-
-    update();
 }
 
 // Triggered when pressing any mouse button
@@ -68,7 +59,6 @@ void MainView::mousePressEvent(QMouseEvent *ev)
     curX = ev->x();
     curY = ev->y();
 
-    update();
     // Do not remove the line below, clicking must focus on this widget!
     this->setFocus();
 }
@@ -77,8 +67,6 @@ void MainView::mousePressEvent(QMouseEvent *ev)
 void MainView::mouseReleaseEvent(QMouseEvent *ev)
 {
     qDebug() << "Mouse button released" << ev->button();
-
-    update();
 }
 
 // Triggered when clicking scrolling with the scroll wheel on the mouse
@@ -87,6 +75,4 @@ void MainView::wheelEvent(QWheelEvent *ev)
     // Implement something
     qDebug() << "Mouse wheel:" << ev->delta();
     updateViewDistance(ev->delta());
-
-    update();
 }
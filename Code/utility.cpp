@@ -1,4 +1,7 @@
 #include "mainview.h"
+#include "trace.h"
+
+#include <QFile>
 
 QVector<quint8> MainView::imageToBytes(QImage image) {
     // needed since (0,0) is bottom left in OpenGL
@@ -27,3 +30,41 @@ QVector<quint8> MainView::imageToBytes(QImage image) {
     }
     return pixelData;
 }
+
+/**
+ * @brief MainView::decodeTexture
+ *
+ * Loads an image and builds its complete mip chain, halving each level
+ * with a smooth filter down to 1x1.
+ *
+ * @param file
+ * @return mip chain, finest level first
+ */
+TextureStreamer::MipChain MainView::decodeTexture(QString file) {
+    TRACE_SCOPE("texture decode");
+    QImage image(file);
+    TextureStreamer::MipChain mips;
+
+    while (!image.isNull()) {
+        TextureStreamer::MipLevel level;
+        level.width = image.width();
+        level.height = image.height();
+        level.pixels = imageToBytes(image);
+        mips.append(level);
+
+        if (image.width() == 1 && image.height() == 1)
+            break;
+        image = image.scaled(qMax(1, image.width() / 2), qMax(1, image.height() / 2),
+                             Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    return mips;
+}
+
+QByteArray MainView::readFile(QString file) {
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        qDebug() << ":: Could not open" << file;
+        return QByteArray();
+    }
+    return in.readAll();
+}
@@ -0,0 +1,110 @@
+#include "waterdisplacement.h"
+
+#include "trace.h"
+#include "waveset.h"
+
+#include <QDebug>
+
+namespace {
+// The DISPLACE outputs of vertshader_uber.glsl, interleaved as x, y, z, nx, ny, nz, u, v.
+const char *varyings[] = { "displacedPosition", "displacedNormal", "displacedTexCoords" };
+}
+
+WaterDisplacement::WaterDisplacement()
+{
+}
+
+/**
+ * @brief WaterDisplacement::initialize
+ *
+ * The captured outputs have to be named before linking, so the program is
+ * linked here instead of by the ShaderBuilder; it is a single small vertex
+ * shader without a fragment stage.
+ */
+bool WaterDisplacement::initialize(const QByteArray &vertexShader)
+{
+    TRACE_GL_SCOPE("displacement link");
+    initializeOpenGLFunctions();
+
+    program.create();
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader);
+    glTransformFeedbackVaryings(program.programId(), 3, varyings, GL_INTERLEAVED_ATTRIBS);
+    if (!program.link()) {
+        qWarning() << ":: Could not link the displacement pass:" << qPrintable(program.log());
+        return false;
+    }
+    GLuint wavesBlock = glGetUniformBlockIndex(program.programId(), "Waves");
+    if (wavesBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(program.programId(), wavesBlock, WaveSet::binding);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &output);
+    initialized = true;
+    return true;
+}
+
+void WaterDisplacement::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteBuffers(1, &output);
+    glDeleteVertexArrays(1, &vao);
+    initialized = false;
+}
+
+void WaterDisplacement::setSource(GLuint source, int count)
+{
+    this->count = count;
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, source);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+
+    // Written and read by the GPU only.
+    glBindBuffer(GL_ARRAY_BUFFER, output);
+    glBufferData(GL_ARRAY_BUFFER, count * 8 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void WaterDisplacement::update()
+{
+    TRACE_GL_SCOPE("displacement pass");
+    program.bind();
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(vao);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, output);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    program.release();
+}
+
+GLuint WaterDisplacement::buffer() const
+{
+    return output;
+}
+
+int WaterDisplacement::vertexCount() const
+{
+    return count;
+}
+
+void WaterDisplacement::readBack(QVector<float> &vertices)
+{
+    vertices.resize(count * 8);
+    glBindBuffer(GL_ARRAY_BUFFER, output);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
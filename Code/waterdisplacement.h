@@ -0,0 +1,52 @@
+#ifndef WATERDISPLACEMENT_H
+#define WATERDISPLACEMENT_H
+
+#include <QByteArray>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector>
+
+/**
+ * @brief The WaterDisplacement class
+ *
+ * Displaces the water vertices once per frame on the GPU: the uber vertex
+ * shader, built with DISPLACE and the wave count, runs over the undisplaced
+ * vertices as points with rasterization discarded, and transform feedback
+ * writes position, normal and texture coordinates into an output buffer in
+ * the WaterGrid layout. Every pass drawing the surface afterwards reads that
+ * buffer through a WAVES_DISPLACED variant, so the wave sum is evaluated
+ * once per vertex and frame however many passes there are.
+ *
+ * The Waves uniform block is bound to WaveSet::binding; the wave buffer has
+ * to be bound, and updated to the frame, when update() runs.
+ *
+ * GL functions must be called with the GL context current.
+ */
+class WaterDisplacement : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    WaterDisplacement();
+
+    // Links the program; false if it does not.
+    bool initialize(const QByteArray &vertexShader);
+    void destroy();
+
+    // Reads count undisplaced vertices in the WaterGrid layout from source.
+    void setSource(GLuint source, int count);
+    // Displaces all vertices by the phases in the bound wave buffer.
+    void update();
+
+    GLuint buffer() const;
+    int vertexCount() const;
+    // Copies the displaced vertices back, waiting for the pass.
+    void readBack(QVector<float> &vertices);
+
+private:
+    bool initialized = false;
+    QOpenGLShaderProgram program;
+    GLuint vao = 0;
+    GLuint output = 0;
+    int count = 0;
+};
+
+#endif // WATERDISPLACEMENT_H
@@ -0,0 +1,198 @@
+#include "watergrid.h"
+
+#include "trace.h"
+
+WaterGrid::WaterGrid()
+{
+}
+
+/**
+ * @brief WaterGrid::generate
+ *
+ * Vertices are shared within a tile and duplicated along tile borders.
+ * Triangles wind counter-clockwise seen from +z.
+ */
+WaterGrid::Mesh WaterGrid::generate(int resolution, bool strips)
+{
+    TRACE_SCOPE("generate grid");
+    resolution = qBound(1, resolution, maxResolution);
+    int tiles = (resolution + maxTileQuads - 1) / maxTileQuads;
+
+    Mesh mesh;
+    mesh.strips = strips;
+    mesh.vertices.reserve((resolution + tiles) * (resolution + tiles) * 8);
+    mesh.indices.reserve(resolution * resolution * (strips ? 2 : 6) + resolution * tiles * 4);
+
+    for (int tileY = 0; tileY < tiles; ++tileY) {
+        for (int tileX = 0; tileX < tiles; ++tileX) {
+            int x0 = tileX * maxTileQuads;
+            int y0 = tileY * maxTileQuads;
+            int columns = qMin(maxTileQuads, resolution - x0) + 1; // vertices per row
+            int rows = qMin(maxTileQuads, resolution - y0) + 1;
+
+            mesh.tileBaseVertices.append(mesh.vertices.size() / 8);
+            for (int y = 0; y < rows; ++y) {
+                for (int x = 0; x < columns; ++x) {
+                    float u = float(x0 + x) / resolution;
+                    float v = float(y0 + y) / resolution;
+                    const float vertex[8] = { 2 * u - 1, 2 * v - 1, 0, 0, 0, 1, u, v };
+                    for (float value : vertex)
+                        mesh.vertices.append(value);
+                }
+            }
+
+            int first = mesh.indices.size();
+            mesh.tileFirstIndices.append(first);
+            for (int y = 0; y + 1 < rows; ++y) {
+                GLushort row = y * columns;
+                GLushort above = row + columns;
+                if (strips) {
+                    if (y > 0)
+                        mesh.indices.append(restartIndex);
+                    for (int x = 0; x < columns; ++x) {
+                        mesh.indices.append(above + x);
+                        mesh.indices.append(row + x);
+                    }
+                } else {
+                    for (int x = 0; x + 1 < columns; ++x) {
+                        GLushort a = row + x, b = row + x + 1, c = above + x + 1, d = above + x;
+                        const GLushort quad[6] = { a, b, c, a, c, d };
+                        for (GLushort index : quad)
+                            mesh.indices.append(index);
+                    }
+                }
+            }
+            mesh.tileCounts.append(mesh.indices.size() - first);
+        }
+    }
+    return mesh;
+}
+
+void WaterGrid::initialize()
+{
+    initializeOpenGLFunctions();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    pointAttributes(vbo);
+    initialized = true;
+}
+
+void WaterGrid::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    initialized = false;
+}
+
+void WaterGrid::setResolution(int resolution, bool strips)
+{
+    Mesh mesh = generate(resolution, strips);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.constData(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLushort), mesh.indices.constData(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gridResolution = qBound(1, resolution, maxResolution);
+    this->strips = strips;
+    meshVertices = mesh.vertices;
+    counts = mesh.tileCounts;
+    baseVertices = mesh.tileBaseVertices;
+    offsets.resize(0);
+    for (int first : mesh.tileFirstIndices)
+        offsets.append(reinterpret_cast<const void *>(first * sizeof(GLushort)));
+}
+
+int WaterGrid::resolution() const
+{
+    return gridResolution;
+}
+
+quint64 WaterGrid::triangles() const
+{
+    return 2 * quint64(gridResolution) * gridResolution;
+}
+
+const QVector<float> &WaterGrid::vertices() const
+{
+    return meshVertices;
+}
+
+// Orphans the buffer, so the upload never waits on last frame's draw.
+qint64 WaterGrid::uploadVertices(const QVector<float> &vertices)
+{
+    qint64 bytes = vertices.size() * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.constData());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return bytes;
+}
+
+GLuint WaterGrid::vertexBuffer() const
+{
+    return vbo;
+}
+
+int WaterGrid::vertexCount() const
+{
+    return meshVertices.size() / 8;
+}
+
+void WaterGrid::setDrawBuffer(GLuint buffer)
+{
+    pointAttributes(buffer ? buffer : vbo);
+}
+
+void WaterGrid::draw()
+{
+    glBindVertexArray(vao);
+    if (strips) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(restartIndex);
+    }
+
+    glMultiDrawElementsBaseVertex(strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES, counts.constData(), GL_UNSIGNED_SHORT,
+                                  offsets.constData(), counts.size(), baseVertices.data());
+
+    if (strips)
+        glDisable(GL_PRIMITIVE_RESTART);
+    glBindVertexArray(0);
+}
+
+// --- Helpers
+
+// The attributes remember the buffer bound when they were set.
+void WaterGrid::pointAttributes(GLuint buffer)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // Set vertex coordinates to location 0
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+    glEnableVertexAttribArray(0);
+
+    // Set vertex normals to location 1
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Set vertex texture coordinates to location 2
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,85 @@
+#ifndef WATERGRID_H
+#define WATERGRID_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QVector>
+
+/**
+ * @brief The WaterGrid class
+ *
+ * A flat, indexed grid over [-1, 1] x [-1, 1] at z = 0, generated instead of
+ * loaded, with the interleaved position, normal and texture coordinate
+ * layout of the meshes (locations 0, 1 and 2).
+ *
+ * The grid is cut into square tiles of at most maxTileQuads quads per side,
+ * each with its own block of vertices, so 16-bit indices suffice at any
+ * resolution. Within a tile the indices walk row by row, which keeps the
+ * vertices shared by consecutive rows in the post-transform cache. Tiles are
+ * either triangle lists or one triangle strip per row, separated by a
+ * primitive restart index. All tiles are drawn with a single
+ * glMultiDrawElementsBaseVertex.
+ *
+ * GL functions must be called with the GL context current.
+ */
+class WaterGrid : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    static const int maxTileQuads = 64;
+    static const int maxResolution = 4096;
+    static const GLushort restartIndex = 0xffff;
+
+    struct Mesh
+    {
+        QVector<float> vertices;  // x, y, z, nx, ny, nz, u, v
+        QVector<GLushort> indices;
+        QVector<GLsizei> tileCounts;      // indices per tile
+        QVector<GLint> tileBaseVertices;  // first vertex of every tile
+        QVector<int> tileFirstIndices;    // first index of every tile
+        bool strips;
+    };
+
+    WaterGrid();
+
+    // resolution is the number of quads per side.
+    static Mesh generate(int resolution, bool strips);
+
+    void initialize();
+    void destroy();
+
+    // Regenerates and uploads the grid.
+    void setResolution(int resolution, bool strips);
+    int resolution() const;
+    quint64 triangles() const;
+
+    // The undisplaced vertices of the current resolution.
+    const QVector<float> &vertices() const;
+    // Replaces the vertex data, which must have the layout and count of
+    // vertices(), for geometry animated on the CPU. Returns the bytes uploaded.
+    qint64 uploadVertices(const QVector<float> &vertices);
+
+    // The buffer holding vertices(), and their count.
+    GLuint vertexBuffer() const;
+    int vertexCount() const;
+    // Draws the vertices of another buffer in the same layout, such as the
+    // output of a displacement pass; 0 for the grid's own.
+    void setDrawBuffer(GLuint buffer);
+
+    void draw();
+
+private:
+    void pointAttributes(GLuint buffer);
+
+    bool initialized = false;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ibo = 0;
+
+    int gridResolution = 0;
+    bool strips = false;
+    QVector<float> meshVertices;
+    QVector<GLsizei> counts;
+    QVector<GLint> baseVertices;
+    QVector<const void *> offsets;
+};
+
+#endif // WATERGRID_H
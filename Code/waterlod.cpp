@@ -0,0 +1,151 @@
+#include "waterlod.h"
+
+#include "trace.h"
+#include "watergrid.h"
+
+#include <cmath>
+
+namespace {
+// A level's range in patch sizes of that level, and the part of the range
+// over which its patches morph into the next level.
+const float rangeScale = 3;
+const float morphStart = 0.7f;
+}
+
+WaterLod::WaterLod()
+{
+}
+
+void WaterLod::initialize(float extent, float finestSpacing)
+{
+    initializeOpenGLFunctions();
+
+    finestSize = patchQuads * finestSpacing;
+    levelCount = qBound(1, static_cast<int>(std::ceil(std::log2(2 * extent / finestSize))) + 1, maxLevels);
+    rootSize = finestSize * (1 << (levelCount - 1));
+    for (int level = 0; level < levelCount; ++level)
+        ranges[level] = QVector2D(morphStart * lodRange(level), lodRange(level));
+    patches.reserve(maxPatches);
+
+    // The patch is a WaterGrid over [-1, 1]; the shader maps it onto the node.
+    WaterGrid::Mesh mesh = WaterGrid::generate(patchQuads, false);
+    indexCount = mesh.indices.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    glGenBuffers(1, &instanceVbo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.constData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLushort), mesh.indices.constData(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // One Patch per instance at location 3.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, maxPatches * sizeof(Patch), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Patch), 0);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    initialized = true;
+}
+
+void WaterLod::destroy()
+{
+    if (!initialized)
+        return;
+
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    initialized = false;
+}
+
+qint64 WaterLod::update(const QVector3D &camera)
+{
+    TRACE_SCOPE("lod selection");
+    this->camera = camera;
+    patches.resize(0);
+    select(-0.5f * rootSize, -0.5f * rootSize, rootSize, levelCount - 1);
+
+    // Orphan the buffer, so the upload never waits on last frame's draw.
+    qint64 bytes = patches.size() * sizeof(Patch);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, maxPatches * sizeof(Patch), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, patches.constData());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return bytes;
+}
+
+void WaterLod::draw()
+{
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0, patches.size());
+    glBindVertexArray(0);
+}
+
+int WaterLod::levels() const
+{
+    return levelCount;
+}
+
+const QVector2D *WaterLod::morphRanges() const
+{
+    return ranges;
+}
+
+int WaterLod::patchCount() const
+{
+    return patches.size();
+}
+
+quint64 WaterLod::triangles() const
+{
+    return quint64(patches.size()) * 2 * patchQuads * patchQuads;
+}
+
+// --- Helpers
+
+// Keeps a node whole unless the camera is within the range of the finer
+// level; patches beyond maxPatches are dropped.
+void WaterLod::select(float x, float y, float size, int level)
+{
+    if (level == 0 || !intersects(x, y, size, lodRange(level - 1))) {
+        if (patches.size() < maxPatches)
+            patches.append({ x, y, size, static_cast<float>(level) });
+        return;
+    }
+
+    float half = 0.5f * size;
+    select(x, y, half, level - 1);
+    select(x + half, y, half, level - 1);
+    select(x, y + half, half, level - 1);
+    select(x + half, y + half, half, level - 1);
+}
+
+// Whether the sphere of radius around the camera touches the node.
+bool WaterLod::intersects(float x, float y, float size, float radius) const
+{
+    float dx = qMax(0.f, qMax(x - camera.x(), camera.x() - (x + size)));
+    float dy = qMax(0.f, qMax(y - camera.y(), camera.y() - (y + size)));
+    float dz = camera.z();
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+float WaterLod::lodRange(int level) const
+{
+    return rangeScale * finestSize * (1 << level);
+}
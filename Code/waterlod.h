@@ -0,0 +1,81 @@
+#ifndef WATERLOD_H
+#define WATERLOD_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector>
+
+/**
+ * @brief The WaterLod class
+ *
+ * Continuous level of detail for the water plane (CDLOD, Strugar 2010). A
+ * quadtree over [-extent, extent]^2 at z = 0 is refined around the camera:
+ * a node of level L is split while the camera is within lodRange(L - 1) of
+ * it, so the patch size doubles with every range. Every selected node is
+ * one instance of the same small grid patch, so all of them are drawn with
+ * one instanced draw call and the vertex count grows only with the number
+ * of levels, the log of the extent.
+ *
+ * The vertex shader (LOD_MORPH in vertshader_uber.glsl) moves the odd
+ * vertices of a patch onto its even ones as the distance to the camera
+ * approaches the end of the level's range. At that distance the patch has
+ * the vertices of the next coarser level, so neighbouring levels meet
+ * without cracks and nodes change level without popping.
+ *
+ * initialize(), destroy(), update() and draw() must be called with the GL
+ * context current.
+ */
+class WaterLod : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    static const int maxLevels = 16;   // LOD_MAX_LEVELS in vertshader_uber.glsl
+    static const int patchQuads = 16;  // quads per patch side
+    static const int maxPatches = 4096;
+
+    struct Patch
+    {
+        float x, y;  // lower left corner, grid space
+        float size;
+        float level;
+    };
+
+    WaterLod();
+
+    // finestSpacing is the distance between vertices of level 0.
+    void initialize(float extent, float finestSpacing = 1.0f / 64);
+    void destroy();
+
+    // Selects the patches for a camera at camera, in grid space, and uploads them.
+    // Returns the bytes uploaded.
+    qint64 update(const QVector3D &camera);
+    void draw();
+
+    int levels() const;
+    // Morph start and end distance per level, for the lodRanges uniform.
+    const QVector2D *morphRanges() const;
+    int patchCount() const;
+    quint64 triangles() const;
+
+private:
+    void select(float x, float y, float size, int level);
+    bool intersects(float x, float y, float size, float radius) const;
+    float lodRange(int level) const;
+
+    bool initialized = false;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ibo = 0;
+    GLuint instanceVbo = 0;
+    GLsizei indexCount = 0;
+
+    float rootSize = 0;
+    float finestSize = 0; // of a level 0 patch
+    int levelCount = 0;
+    QVector2D ranges[maxLevels];
+
+    QVector3D camera;
+    QVector<Patch> patches;
+};
+
+#endif // WATERLOD_H
@@ -0,0 +1,294 @@
+#include "waterquery.h"
+
+#include "oceanfft.h"
+#include "ripples.h"
+#include "simdmath.h"
+#include "trace.h"
+
+#include <cmath>
+
+namespace {
+// Keeps Newton steps finite near the cusps of waves of steepness 1, where the surface folds.
+const float minDeterminant = 0.01f;
+
+// The floor of x as a texel index repeated into [0, n).
+int repeat(float x, int n)
+{
+    int texel = static_cast<int>(std::floor(x)) % n;
+    return texel < 0 ? texel + n : texel;
+}
+
+// GL_LINEAR with GL_REPEAT over n x n RGBA texels, as the ocean textures are sampled.
+void sampleRepeat(const float *texels, int n, float u, float v, float out[3])
+{
+    float s = u * n - 0.5f;
+    float r = v * n - 0.5f;
+    float fx = s - std::floor(s);
+    float fy = r - std::floor(r);
+    int x0 = repeat(s, n);
+    int y0 = repeat(r, n);
+    int x1 = x0 + 1 < n ? x0 + 1 : 0;
+    int y1 = y0 + 1 < n ? y0 + 1 : 0;
+
+    const float *a = texels + 4 * (y0 * n + x0);
+    const float *b = texels + 4 * (y0 * n + x1);
+    const float *c = texels + 4 * (y1 * n + x0);
+    const float *d = texels + 4 * (y1 * n + x1);
+    for (int channel = 0; channel < 3; ++channel) {
+        float bottom = a[channel] + fx * (b[channel] - a[channel]);
+        float top = c[channel] + fx * (d[channel] - c[channel]);
+        out[channel] = bottom + fy * (top - bottom);
+    }
+}
+
+// GL_LINEAR with GL_CLAMP_TO_EDGE over n x n single floats, as the ripple texture is sampled.
+float sampleClamp(const float *texels, int n, float u, float v)
+{
+    float s = u * n - 0.5f;
+    float r = v * n - 0.5f;
+    float fx = s - std::floor(s);
+    float fy = r - std::floor(r);
+    int x0 = static_cast<int>(std::floor(s));
+    int y0 = static_cast<int>(std::floor(r));
+    int x1 = qBound(0, x0 + 1, n - 1);
+    int y1 = qBound(0, y0 + 1, n - 1);
+    x0 = qBound(0, x0, n - 1);
+    y0 = qBound(0, y0, n - 1);
+
+    float bottom = texels[y0 * n + x0] + fx * (texels[y0 * n + x1] - texels[y0 * n + x0]);
+    float top = texels[y1 * n + x0] + fx * (texels[y1 * n + x1] - texels[y1 * n + x0]);
+    return bottom + fy * (top - bottom);
+}
+}
+
+void WaterQuery::Batch::resize(int count)
+{
+    this->count = count;
+    int padded = (count + 3) & ~3;
+    for (QVector<float> *array : { &x, &y, &height, &normalX, &normalY, &normalZ })
+        array->resize(padded);
+}
+
+int WaterQuery::Batch::size() const
+{
+    return count;
+}
+
+WaterQuery::WaterQuery()
+{
+}
+
+void WaterQuery::setWaves(const QVector<WaveSet::Wave> &waves)
+{
+    waveList = waves;
+    WaveSet::pack(waves, waveData);
+    horizontal = false;
+    for (const WaveSet::Wave &wave : waves)
+        horizontal = horizontal || wave.steepness > 0;
+}
+
+void WaterQuery::setOcean(const OceanFft *ocean, float tileSize)
+{
+    this->ocean = ocean;
+    oceanTileSize = tileSize;
+}
+
+void WaterQuery::setRipples(const Ripples *ripples)
+{
+    this->ripples = ripples && !ripples->config().gpu ? ripples : nullptr;
+}
+
+void WaterQuery::query(Batch &batch, double t)
+{
+    TRACE_SCOPE("water query");
+    if (ocean)
+        queryOcean(batch);
+    else
+        queryWaves(batch, t);
+    if (ripples)
+        addRipples(batch);
+}
+
+// --- Helpers
+
+/**
+ * @brief WaterQuery::queryWaves
+ *
+ * The NUM_WAVES loop of vertshader_uber.glsl: theta = k dot(D, p) plus the
+ * wrapped phase - w t that WaveSet uploads, the offset (Q A cos(theta) D, A sin(theta)) and the slope, summed
+ * over the waves at the rest position p of the vertex.
+ */
+void WaterQuery::queryWaves(Batch &batch, double t)
+{
+    const int stride = WaveSet::floatsPerWave;
+    int waves = waveList.size();
+    WaveSet::pack(waveList, waveData, t);
+    const float *data = waveData.constData();
+    int idx = 0;
+
+#ifdef __SSE2__
+    int padded = batch.x.size();
+    for (; idx + 4 <= padded; idx += 4) {
+        __m128 targetX = _mm_loadu_ps(batch.x.constData() + idx);
+        __m128 targetY = _mm_loadu_ps(batch.y.constData() + idx);
+        __m128 px = targetX;
+        __m128 py = targetY;
+        for (int step = 0; horizontal && step < inversionSteps; ++step) {
+            // The residual p + offset(p) - point and the symmetric Jacobian I - sum(Q A k sin(theta) D D^T).
+            __m128 residualX = _mm_sub_ps(px, targetX);
+            __m128 residualY = _mm_sub_ps(py, targetY);
+            __m128 jacobianXX = _mm_set1_ps(1);
+            __m128 jacobianXY = _mm_setzero_ps();
+            __m128 jacobianYY = _mm_set1_ps(1);
+            for (int i = 0; i < waves; ++i) {
+                const float *wave = data + i * stride;
+                __m128 dx = _mm_set1_ps(wave[0]);
+                __m128 dy = _mm_set1_ps(wave[1]);
+                __m128 theta = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(wave[2]),
+                                                     _mm_add_ps(_mm_mul_ps(dx, px), _mm_mul_ps(dy, py))),
+                                          _mm_set1_ps(wave[5]));
+                __m128 c = _mm_mul_ps(_mm_set1_ps(wave[6]), SimdMath::cos4(theta));
+                __m128 w = _mm_mul_ps(_mm_set1_ps(wave[6] * wave[2]), SimdMath::sin4(theta));
+                residualX = _mm_add_ps(residualX, _mm_mul_ps(c, dx));
+                residualY = _mm_add_ps(residualY, _mm_mul_ps(c, dy));
+                jacobianXX = _mm_sub_ps(jacobianXX, _mm_mul_ps(w, _mm_set1_ps(wave[0] * wave[0])));
+                jacobianXY = _mm_sub_ps(jacobianXY, _mm_mul_ps(w, _mm_set1_ps(wave[0] * wave[1])));
+                jacobianYY = _mm_sub_ps(jacobianYY, _mm_mul_ps(w, _mm_set1_ps(wave[1] * wave[1])));
+            }
+            __m128 determinant = _mm_max_ps(_mm_sub_ps(_mm_mul_ps(jacobianXX, jacobianYY),
+                                                       _mm_mul_ps(jacobianXY, jacobianXY)),
+                                            _mm_set1_ps(minDeterminant));
+            __m128 inverse = _mm_div_ps(_mm_set1_ps(1), determinant);
+            px = _mm_sub_ps(px, _mm_mul_ps(inverse, _mm_sub_ps(_mm_mul_ps(jacobianYY, residualX),
+                                                               _mm_mul_ps(jacobianXY, residualY))));
+            py = _mm_sub_ps(py, _mm_mul_ps(inverse, _mm_sub_ps(_mm_mul_ps(jacobianXX, residualY),
+                                                               _mm_mul_ps(jacobianXY, residualX))));
+        }
+
+        __m128 height = _mm_setzero_ps();
+        __m128 slopeX = _mm_setzero_ps();
+        __m128 slopeY = _mm_setzero_ps();
+        __m128 slopeZ = _mm_set1_ps(1);
+        for (int i = 0; i < waves; ++i) {
+            const float *wave = data + i * stride;
+            __m128 dx = _mm_set1_ps(wave[0]);
+            __m128 dy = _mm_set1_ps(wave[1]);
+            __m128 theta = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(wave[2]),
+                                                 _mm_add_ps(_mm_mul_ps(dx, px), _mm_mul_ps(dy, py))),
+                                      _mm_set1_ps(wave[5]));
+            __m128 s = SimdMath::sin4(theta);
+            __m128 c = _mm_mul_ps(_mm_set1_ps(wave[2] * wave[3]), SimdMath::cos4(theta));
+            height = _mm_add_ps(height, _mm_mul_ps(_mm_set1_ps(wave[3]), s));
+            slopeX = _mm_sub_ps(slopeX, _mm_mul_ps(dx, c));
+            slopeY = _mm_sub_ps(slopeY, _mm_mul_ps(dy, c));
+            slopeZ = _mm_sub_ps(slopeZ, _mm_mul_ps(_mm_set1_ps(wave[6] * wave[2]), s));
+        }
+
+        __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(slopeX, slopeX), _mm_mul_ps(slopeY, slopeY)),
+                                    _mm_mul_ps(slopeZ, slopeZ));
+        __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1), _mm_sqrt_ps(length2));
+        _mm_storeu_ps(batch.height.data() + idx, height);
+        _mm_storeu_ps(batch.normalX.data() + idx, _mm_mul_ps(slopeX, inverseLength));
+        _mm_storeu_ps(batch.normalY.data() + idx, _mm_mul_ps(slopeY, inverseLength));
+        _mm_storeu_ps(batch.normalZ.data() + idx, _mm_mul_ps(slopeZ, inverseLength));
+    }
+#endif
+
+    for (; idx < batch.size(); ++idx) {
+        float px = batch.x[idx];
+        float py = batch.y[idx];
+        for (int step = 0; horizontal && step < inversionSteps; ++step) {
+            float residual[2] = { px - batch.x[idx], py - batch.y[idx] };
+            float jacobian[3] = { 1, 0, 1 }; // xx, xy, yy
+            for (int i = 0; i < waves; ++i) {
+                const float *wave = data + i * stride;
+                float theta = wave[2] * (wave[0] * px + wave[1] * py) + wave[5];
+                float c = wave[6] * std::cos(theta);
+                float w = wave[6] * wave[2] * std::sin(theta);
+                residual[0] += c * wave[0];
+                residual[1] += c * wave[1];
+                jacobian[0] -= w * (wave[0] * wave[0]);
+                jacobian[1] -= w * (wave[0] * wave[1]);
+                jacobian[2] -= w * (wave[1] * wave[1]);
+            }
+            float inverse = 1 / qMax(jacobian[0] * jacobian[2] - jacobian[1] * jacobian[1], minDeterminant);
+            px -= inverse * (jacobian[2] * residual[0] - jacobian[1] * residual[1]);
+            py -= inverse * (jacobian[0] * residual[1] - jacobian[1] * residual[0]);
+        }
+
+        float height = 0;
+        float slope[3] = { 0, 0, 1 };
+        for (int i = 0; i < waves; ++i) {
+            const float *wave = data + i * stride;
+            float theta = wave[2] * (wave[0] * px + wave[1] * py) + wave[5];
+            float s = std::sin(theta);
+            float c = wave[2] * wave[3] * std::cos(theta);
+            height += wave[3] * s;
+            slope[0] -= wave[0] * c;
+            slope[1] -= wave[1] * c;
+            slope[2] -= wave[6] * wave[2] * s;
+        }
+
+        float inverseLength = 1 / std::sqrt(slope[0] * slope[0] + slope[1] * slope[1] + slope[2] * slope[2]);
+        batch.height[idx] = height;
+        batch.normalX[idx] = slope[0] * inverseLength;
+        batch.normalY[idx] = slope[1] * inverseLength;
+        batch.normalZ[idx] = slope[2] * inverseLength;
+    }
+}
+
+// WAVES_FFT: the displacement and normal textures at the rest position, in tiles.
+void WaterQuery::queryOcean(Batch &batch) const
+{
+    const float *displacement = ocean->displacement().constData();
+    const float *normals = ocean->normals().constData();
+    int n = ocean->config().size;
+    bool choppy = ocean->config().choppiness > 0;
+
+    for (int idx = 0; idx < batch.size(); ++idx) {
+        float px = batch.x[idx];
+        float py = batch.y[idx];
+        float offset[3];
+        for (int step = 0; choppy && step < inversionSteps; ++step) {
+            sampleRepeat(displacement, n, px / oceanTileSize, py / oceanTileSize, offset);
+            px = batch.x[idx] - offset[0] * oceanTileSize;
+            py = batch.y[idx] - offset[1] * oceanTileSize;
+        }
+        sampleRepeat(displacement, n, px / oceanTileSize, py / oceanTileSize, offset);
+
+        float normal[3];
+        sampleRepeat(normals, n, px / oceanTileSize, py / oceanTileSize, normal);
+        float inverseLength = 1 / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        batch.height[idx] = offset[2] * oceanTileSize;
+        batch.normalX[idx] = normal[0] * inverseLength;
+        batch.normalY[idx] = normal[1] * inverseLength;
+        batch.normalZ[idx] = normal[2] * inverseLength;
+    }
+}
+
+// RIPPLES: the height at the displaced position, and its slope from two texels apart.
+void WaterQuery::addRipples(Batch &batch) const
+{
+    const QVector<float> &heights = ripples->heights();
+    int n = ripples->config().resolution;
+    if (heights.size() != n * n)
+        return;
+    const float *cells = heights.constData();
+    float texel = 1.0f / n;
+
+    for (int idx = 0; idx < batch.size(); ++idx) {
+        float u = batch.x[idx] * 0.5f + 0.5f;
+        float v = batch.y[idx] * 0.5f + 0.5f;
+        float slopeX = (sampleClamp(cells, n, u + texel, v) - sampleClamp(cells, n, u - texel, v)) / (4 * texel);
+        float slopeY = (sampleClamp(cells, n, u, v + texel) - sampleClamp(cells, n, u, v - texel)) / (4 * texel);
+        batch.height[idx] += sampleClamp(cells, n, u, v);
+
+        float scale = 1 / qMax(batch.normalZ[idx], 0.1f);
+        float normal[3] = { batch.normalX[idx] * scale - slopeX, batch.normalY[idx] * scale - slopeY,
+                            batch.normalZ[idx] * scale };
+        float inverseLength = 1 / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        batch.normalX[idx] = normal[0] * inverseLength;
+        batch.normalY[idx] = normal[1] * inverseLength;
+        batch.normalZ[idx] = normal[2] * inverseLength;
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef WATERQUERY_H
+#define WATERQUERY_H
+
+#include "waveset.h"
+
+#include <QVector>
+
+class OceanFft;
+class Ripples;
+
+/**
+ * @brief The WaterQuery class
+ *
+ * Answers where the rendered water surface is: the height and normal of the
+ * surface above any number of points of the grid plane, for floating
+ * objects. It evaluates the same function as vertshader_uber.glsl, in
+ * single precision and in the same order of operations, for the wave model
+ * the scene draws with:
+ *
+ *  - the Gerstner waves of NUM_WAVES, also when SineWaves or the
+ *    displacement pass evaluate them, four points at a time with SSE2 and
+ *    the polynomial sine of SineWaves;
+ *  - or the textures of an OceanFft, bilinearly filtered and repeated as
+ *    the GPU samples them, one point at a time;
+ *  - plus the height and slope of CPU Ripples, clamped at the border like
+ *    their texture. GPU ripples stay on the GPU and are left out.
+ *
+ * The shader moves every vertex sideways as well as up, so the surface above
+ * a point belongs to the vertex that came from somewhere else. Its rest
+ * position p solves p + offset(p) = point: for the waves with Newton steps,
+ * whose 2 x 2 Jacobian comes from the same sines and cosines, for the ocean
+ * by fixed-point iteration p = point - offset(p). Without steepness or
+ * choppiness there is nothing to solve.
+ *
+ * The ocean and ripples are read as they are, so query after their update()
+ * of the frame. Nothing allocates once a batch has its size.
+ */
+class WaterQuery
+{
+public:
+    // Points in separate arrays, padded to whole SSE registers.
+    struct Batch
+    {
+        QVector<float> x, y;                      // grid units, filled by the caller
+        QVector<float> height;                    // of the surface above x, y
+        QVector<float> normalX, normalY, normalZ; // unit length
+
+        void resize(int count);
+        int size() const;
+
+    private:
+        int count = 0;
+    };
+
+    // Iterations that find the rest position of the vertex above a point.
+    static const int inversionSteps = 3;
+
+    WaterQuery();
+
+    void setWaves(const QVector<WaveSet::Wave> &waves);
+    // Samples the ocean's last simulated frame instead of the waves; nullptr for the waves.
+    void setOcean(const OceanFft *ocean, float tileSize);
+    // Adds the heights of CPU ripples; nullptr or GPU ripples for none.
+    void setRipples(const Ripples *ripples);
+
+    void query(Batch &batch, double t);
+
+private:
+    void queryWaves(Batch &batch, double t);
+    void queryOcean(Batch &batch) const;
+    void addRipples(Batch &batch) const;
+
+    QVector<WaveSet::Wave> waveList;
+    QVector<float> waveData; // WaveSet::pack() at the time of the query
+    bool horizontal = false;
+
+    const OceanFft *ocean = nullptr;
+    float oceanTileSize = 2;
+    const Ripples *ripples = nullptr;
+};
+
+#endif // WATERQUERY_H
@@ -0,0 +1,290 @@
+#include "waveset.h"
+
+#include "simulation.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtMath>
+#include <cmath>
+#include <random>
+
+namespace {
+const double pi = 3.14159265358979;
+const float twoPi = 6.2831853f;
+
+using Simulation::uniform;
+
+// Deep water dispersion, w^2 = g k.
+float deepWaterSpeed(float wavelength)
+{
+    return std::sqrt(Simulation::gravity * wavelength / twoPi);
+}
+
+QVector2D directionAt(float degrees)
+{
+    return QVector2D(std::cos(qDegreesToRadians(degrees)), std::sin(qDegreesToRadians(degrees)));
+}
+}
+
+void WaveSet::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "waves", "Displace the water with the Gerstner waves of a JSON wave set.", "file" },
+        { "wave-count", "Displace the water with count Gerstner waves from a wind spectrum.", "count" },
+        { "wave-seed", "Seed of the generated waves.", "seed" }
+    });
+}
+
+bool WaveSet::configure(const QCommandLineParser &parser, QVector<Wave> &waves)
+{
+    if (parser.isSet("waves"))
+        return load(parser.value("waves"), waves);
+    if (!parser.isSet("wave-count") && !parser.isSet("wave-seed"))
+        return true;
+
+    Spectrum spectrum;
+    if (parser.isSet("wave-count"))
+        spectrum.count = parser.value("wave-count").toInt();
+    if (parser.isSet("wave-seed"))
+        spectrum.seed = parser.value("wave-seed").toUInt();
+    if (spectrum.count < 1 || spectrum.count > maxWaves) {
+        qWarning() << ":: The wave count must be between 1 and" << maxWaves;
+        return false;
+    }
+    waves = generate(spectrum);
+    return true;
+}
+
+/**
+ * @brief WaveSet::fromSines
+ *
+ * a sin(f pi x + phase + t) is a wave of wavelength 2 / f travelling
+ * towards -x at 1 / (f pi): with D = (-1, 0) its angle is the negated one
+ * plus pi, and sin(pi - a) = sin(a).
+ */
+QVector<WaveSet::Wave> WaveSet::fromSines(const QVector<SineWaves::Wave> &sines)
+{
+    QVector<Wave> waves;
+    waves.reserve(sines.size());
+    for (const SineWaves::Wave &sine : sines) {
+        Wave wave;
+        wave.direction = QVector2D(-1, 0);
+        wave.wavelength = 2 / sine.frequency;
+        wave.amplitude = sine.amplitude;
+        wave.steepness = 0;
+        wave.speed = 1 / (sine.frequency * static_cast<float>(pi));
+        wave.phase = static_cast<float>(pi) - sine.phase;
+        waves.append(wave);
+    }
+    return waves;
+}
+
+/**
+ * @brief WaveSet::generate
+ *
+ * Wavelengths step geometrically from four times the peak down to an eighth
+ * of it, directions are spread uniformly around the wind. The amplitude per
+ * wavelength rises linearly, like waves of equal steepness, and falls off
+ * above the peak; the set is then scaled to the total amplitude.
+ */
+QVector<WaveSet::Wave> WaveSet::generate(const Spectrum &spectrum)
+{
+    std::mt19937 rng(spectrum.seed);
+    QVector<Wave> waves;
+    waves.reserve(spectrum.count);
+    float total = 0;
+    for (int idx = 0; idx < spectrum.count; ++idx) {
+        float octave = spectrum.count > 1 ? static_cast<float>(idx) / (spectrum.count - 1) : 0.6f;
+        float relative = std::pow(2.0f, 2 - 5 * octave);
+
+        Wave wave;
+        wave.direction = directionAt(spectrum.windDirection + uniform(rng, -spectrum.spread, spectrum.spread));
+        wave.wavelength = spectrum.peakWavelength * relative;
+        wave.amplitude = relative * std::exp(-0.5f * relative * relative);
+        wave.steepness = spectrum.steepness;
+        wave.speed = deepWaterSpeed(wave.wavelength);
+        wave.phase = uniform(rng, 0, twoPi);
+        total += wave.amplitude;
+        waves.append(wave);
+    }
+    for (Wave &wave : waves)
+        wave.amplitude *= spectrum.amplitude / total;
+    return waves;
+}
+
+/**
+ * @brief WaveSet::load
+ *
+ * Reads { "waves": [ { "direction": [x, y], "wavelength": ..., "amplitude":
+ * ..., "steepness": ..., "speed": ..., "phase": ... }, ... ] }. The direction
+ * can also be an angle in degrees from +x. Steepness and phase default to
+ * 0, the speed to that of deep water.
+ */
+bool WaveSet::load(const QString &file, QVector<Wave> &waves)
+{
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        qWarning() << ":: Could not read" << file;
+        return false;
+    }
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(in.readAll(), &error);
+    if (document.isNull()) {
+        qWarning() << ":: Could not parse" << file << ":" << error.errorString();
+        return false;
+    }
+
+    QJsonArray list = document.object().value("waves").toArray();
+    if (list.isEmpty() || list.size() > maxWaves) {
+        qWarning() << ":: A wave set has between 1 and" << maxWaves << "waves," << file << "has" << list.size();
+        return false;
+    }
+
+    QVector<Wave> loaded;
+    loaded.reserve(list.size());
+    for (const QJsonValue &value : list) {
+        QJsonObject object = value.toObject();
+        Wave wave;
+        QJsonValue direction = object.value("direction");
+        if (direction.isArray())
+            wave.direction = QVector2D(direction.toArray().at(0).toDouble(), direction.toArray().at(1).toDouble());
+        else
+            wave.direction = directionAt(direction.toDouble());
+        wave.wavelength = object.value("wavelength").toDouble();
+        wave.amplitude = object.value("amplitude").toDouble();
+        wave.steepness = object.value("steepness").toDouble(0);
+        wave.speed = object.value("speed").toDouble(deepWaterSpeed(wave.wavelength));
+        wave.phase = object.value("phase").toDouble(0);
+
+        if (wave.direction.isNull() || wave.wavelength <= 0 || wave.amplitude < 0
+                || wave.steepness < 0 || wave.steepness > 1) {
+            qWarning() << ":: Invalid wave" << loaded.size() << "in" << file;
+            return false;
+        }
+        wave.direction.normalize();
+        loaded.append(wave);
+    }
+    waves = loaded;
+    return true;
+}
+
+QVector3D WaveSet::displace(const QVector<Wave> &waves, QVector2D p, double t, QVector3D *normal)
+{
+    double position[3] = { p.x(), p.y(), 0 };
+    double slope[3] = { 0, 0, 1 };
+    for (const Wave &wave : waves) {
+        double k = 2 * pi / wave.wavelength;
+        double horizontal = wave.steepness / (k * waves.size());
+        double angle = k * (wave.direction.x() * p.x() + wave.direction.y() * p.y()) - k * wave.speed * t + wave.phase;
+        double c = std::cos(angle);
+        double s = std::sin(angle);
+
+        position[0] += horizontal * wave.direction.x() * c;
+        position[1] += horizontal * wave.direction.y() * c;
+        position[2] += wave.amplitude * s;
+        slope[0] -= wave.direction.x() * k * wave.amplitude * c;
+        slope[1] -= wave.direction.y() * k * wave.amplitude * c;
+        slope[2] -= horizontal * k * s;
+    }
+    if (normal)
+        *normal = QVector3D(slope[0], slope[1], slope[2]).normalized();
+    return QVector3D(position[0], position[1], position[2]);
+}
+
+// w t is a whole number of periods plus the part that matters; in double
+// precision that part keeps about 1e-9 of its accuracy per million units of t.
+float WaveSet::phaseAt(const Wave &wave, double t)
+{
+    double omega = 2 * pi / wave.wavelength * wave.speed;
+    return static_cast<float>(std::remainder(wave.phase - omega * t, 2 * pi));
+}
+
+void WaveSet::pack(const QVector<Wave> &waves, QVector<float> &data, double t)
+{
+    data.resize(waves.size() * floatsPerWave);
+    float *out = data.data();
+    for (const Wave &wave : waves) {
+        float k = twoPi / wave.wavelength;
+        out[0] = wave.direction.x();
+        out[1] = wave.direction.y();
+        out[2] = k;
+        out[3] = wave.amplitude;
+        out[4] = k * wave.speed;
+        out[5] = phaseAt(wave, t);
+        out[6] = wave.steepness / (k * waves.size());
+        out[7] = 0;
+        out += floatsPerWave;
+    }
+}
+
+WaveSet::WaveSet()
+{
+}
+
+void WaveSet::setWaves(const QVector<Wave> &waves)
+{
+    waveList = waves;
+}
+
+const QVector<WaveSet::Wave> &WaveSet::waves() const
+{
+    return waveList;
+}
+
+int WaveSet::count() const
+{
+    return waveList.size();
+}
+
+float WaveSet::amplitude() const
+{
+    float sum = 0;
+    for (const Wave &wave : waveList)
+        sum += wave.amplitude;
+    return sum;
+}
+
+void WaveSet::initialize()
+{
+    initializeOpenGLFunctions();
+
+    pack(waveList, packed);
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, packed.size() * sizeof(float), packed.constData(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    initialized = true;
+}
+
+void WaveSet::destroy()
+{
+    if (!initialized)
+        return;
+    glDeleteBuffers(1, &ubo);
+    ubo = 0;
+    initialized = false;
+}
+
+/**
+ * @brief WaveSet::update
+ *
+ * The whole block is rewritten; with the phases every eighth float, a
+ * single upload costs less than one per wave.
+ */
+qint64 WaveSet::update(double t)
+{
+    pack(waveList, packed, t);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, packed.size() * sizeof(float), packed.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return packed.size() * sizeof(float);
+}
+
+void WaveSet::bind()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+}
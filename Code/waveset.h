@@ -0,0 +1,106 @@
+#ifndef WAVESET_H
+#define WAVESET_H
+
+#include "sinewaves.h"
+
+#include <QCommandLineParser>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector>
+
+/**
+ * @brief The WaveSet class
+ *
+ * Directional Gerstner waves for NUM_WAVES in vertshader_uber.glsl. Every
+ * wave moves the point p of the plane by
+ *
+ *     (Q A D cos(theta), A sin(theta)),  theta = k dot(D, p) - w t + phase
+ *
+ * with k = 2 pi / wavelength and w = k speed. Q is the wave's steepness
+ * divided by k A and the number of waves, so a set with all steepnesses at
+ * 1 has the sharpest crests that do not loop over themselves.
+ *
+ * A set is read from a JSON file, generated from a directional spectrum, or
+ * converted from the old sum of sines along x, which it reproduces exactly.
+ * It lives in a uniform buffer bound to WaveSet::binding: two vec4s per
+ * wave, in the std140 layout of the shader's Waves block. The shader is
+ * compiled with the wave count as NUM_WAVES, so its loop has a constant
+ * bound and nothing but the buffer depends on the waves.
+ *
+ * The shader gets no time. update() evaluates phase - w t of every wave in
+ * double precision, wraps it into [-pi, pi) and uploads only that, so the
+ * float angle in the shader stays as exact after days of uptime as in the
+ * first second, where a float t would have quantized the waves to steps of
+ * its last bit.
+ *
+ * initialize(), destroy(), update() and bind() must be called with the GL
+ * context current.
+ */
+class WaveSet : protected QOpenGLFunctions_3_3_Core
+{
+public:
+    struct Wave
+    {
+        QVector2D direction;  // of travel, unit length
+        float wavelength;     // grid units
+        float amplitude;      // grid units
+        float steepness = 0;  // 0 for a sine, up to 1
+        float speed;          // grid units per unit of t
+        float phase = 0;
+    };
+
+    struct Spectrum
+    {
+        int count = 64;
+        float peakWavelength = 1;  // grid units
+        float windDirection = 180; // degrees from +x, the way the sines travel
+        float spread = 60;         // degrees either side of the wind
+        float amplitude = 0.171f;  // of all waves together, as the six sines
+        float steepness = 0.5f;
+        quint32 seed = 1;
+    };
+
+    static const int maxWaves = 256;    // 8 KB of uniforms, half the minimum block size
+    static const int floatsPerWave = 8;
+    static const GLuint binding = 0;    // uniform buffer binding of the Waves block
+
+    static void addOptions(QCommandLineParser &parser);
+    // Fills waves from the options added by addOptions(), if any was given.
+    static bool configure(const QCommandLineParser &parser, QVector<Wave> &waves);
+
+    static QVector<Wave> fromSines(const QVector<SineWaves::Wave> &sines);
+    static QVector<Wave> generate(const Spectrum &spectrum);
+    static bool load(const QString &file, QVector<Wave> &waves);
+
+    // The position of the plane point p at time t and its normal, in double precision.
+    static QVector3D displace(const QVector<Wave> &waves, QVector2D p, double t, QVector3D *normal = nullptr);
+    // phase - w t, wrapped into [-pi, pi).
+    static float phaseAt(const Wave &wave, double t);
+    // The buffer contents at time t: (D.x, D.y, k, A) and (w, phaseAt(t), Q A, 0) per wave.
+    static void pack(const QVector<Wave> &waves, QVector<float> &data, double t = 0);
+
+    WaveSet();
+
+    // Takes effect at initialize().
+    void setWaves(const QVector<Wave> &waves);
+    const QVector<Wave> &waves() const;
+    int count() const;
+    // Sum of the amplitudes, the highest the surface can get.
+    float amplitude() const;
+
+    void initialize();
+    void destroy();
+    // Uploads the phases at time t. Returns the bytes uploaded.
+    qint64 update(double t);
+    void bind();
+
+private:
+    QVector<Wave> waveList;
+    QVector<float> packed;
+
+    bool initialized = false;
+    GLuint ubo = 0;
+};
+
+#endif // WAVESET_H
@@ -12,17 +12,62 @@ TARGET = OpenGL_animation
 TEMPLATE = app
 CONFIG += c++14
 
+# Shared with the animation project
+INCLUDEPATH += ../Code
+
 SOURCES += main.cpp\
     mainwindow.cpp \
     mainview.cpp \
     user_input.cpp \
     model.cpp \
-    utility.cpp
+    utility.cpp \
+    ../Code/shadercache.cpp \
+    ../Code/shaderbuilder.cpp \
+    ../Code/shaderpermutations.cpp \
+    ../Code/gpuprofiler.cpp \
+    ../Code/trace.cpp \
+    ../Code/alloctracker.cpp \
+    ../Code/framestats.cpp \
+    ../Code/statsoverlay.cpp \
+    ../Code/inputlog.cpp \
+    ../Code/gldebug.cpp \
+    ../Code/watergrid.cpp \
+    ../Code/waterlod.cpp \
+    ../Code/oceanfft.cpp \
+    ../Code/sinewaves.cpp \
+    ../Code/waveset.cpp \
+    ../Code/waterdisplacement.cpp \
+    ../Code/ripples.cpp \
+    ../Code/waterquery.cpp \
+    ../Code/floaters.cpp \
+    ../Code/spray.cpp
 
 HEADERS  += mainwindow.h \
     mainview.h \
     model.h \
-    vertex.h
+    vertex.h \
+    ../Code/shadercache.h \
+    ../Code/shaderbuilder.h \
+    ../Code/shaderpermutations.h \
+    ../Code/gpuprofiler.h \
+    ../Code/trace.h \
+    ../Code/alloctracker.h \
+    ../Code/framestats.h \
+    ../Code/statsoverlay.h \
+    ../Code/inputlog.h \
+    ../Code/gldebug.h \
+    ../Code/watergrid.h \
+    ../Code/waterlod.h \
+    ../Code/oceanfft.h \
+    ../Code/simdmath.h \
+    ../Code/simulation.h \
+    ../Code/sinewaves.h \
+    ../Code/waveset.h \
+    ../Code/waterdisplacement.h \
+    ../Code/ripples.h \
+    ../Code/waterquery.h \
+    ../Code/floaters.h \
+    ../Code/spray.h
 
 FORMS    += mainwindow.ui
 
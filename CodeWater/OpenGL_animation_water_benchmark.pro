@@ -0,0 +1,83 @@
+#-------------------------------------------------
+#
+# Headless frame time benchmark of the water scene,
+# see ../Code/benchmark.cpp
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = OpenGL_animation_water_benchmark
+TEMPLATE = app
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+DEFINES += BENCHMARK_SCENE=\\\"water\\\"
+# Relative to ../Code/benchmark.cpp
+DEFINES += BENCHMARK_MAINVIEW=\\\"../CodeWater/mainview.h\\\"
+
+# Fails the run when a steady-state frame allocates, see alloctracker.h
+DEFINES += ALLOC_TRACKING
+
+# Accepts the water grid options of the application, see watergrid.h
+DEFINES += WATER_GRID
+
+# Shared with the animation project
+INCLUDEPATH += ../Code
+
+SOURCES += ../Code/benchmark.cpp \
+    mainview.cpp \
+    user_input.cpp \
+    model.cpp \
+    utility.cpp \
+    ../Code/shadercache.cpp \
+    ../Code/shaderbuilder.cpp \
+    ../Code/shaderpermutations.cpp \
+    ../Code/gpuprofiler.cpp \
+    ../Code/trace.cpp \
+    ../Code/alloctracker.cpp \
+    ../Code/framestats.cpp \
+    ../Code/statsoverlay.cpp \
+    ../Code/inputlog.cpp \
+    ../Code/gldebug.cpp \
+    ../Code/watergrid.cpp \
+    ../Code/waterlod.cpp \
+    ../Code/oceanfft.cpp \
+    ../Code/sinewaves.cpp \
+    ../Code/waveset.cpp \
+    ../Code/waterdisplacement.cpp \
+    ../Code/ripples.cpp \
+    ../Code/waterquery.cpp \
+    ../Code/floaters.cpp \
+    ../Code/spray.cpp
+
+HEADERS  += mainview.h \
+    model.h \
+    vertex.h \
+    ../Code/shadercache.h \
+    ../Code/shaderbuilder.h \
+    ../Code/shaderpermutations.h \
+    ../Code/gpuprofiler.h \
+    ../Code/trace.h \
+    ../Code/alloctracker.h \
+    ../Code/framestats.h \
+    ../Code/statsoverlay.h \
+    ../Code/inputlog.h \
+    ../Code/gldebug.h \
+    ../Code/watergrid.h \
+    ../Code/waterlod.h \
+    ../Code/oceanfft.h \
+    ../Code/simdmath.h \
+    ../Code/simulation.h \
+    ../Code/sinewaves.h \
+    ../Code/waveset.h \
+    ../Code/waterdisplacement.h \
+    ../Code/ripples.h \
+    ../Code/waterquery.h \
+    ../Code/floaters.h \
+    ../Code/spray.h
+
+RESOURCES += \
+    resources.qrc
@@ -1,5 +1,8 @@
 #include "mainwindow.h"
+#include "mainview.h"
+#include "trace.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 #include <ctime>
 
@@ -8,11 +11,61 @@ int main(int argc, char *argv[])
     std::srand(std::time(nullptr));
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption traceOption("trace", "Record a Chrome trace and write it to file on exit.", "file");
+    parser.addOption(traceOption);
+    QCommandLineOption recordOption("record", "Record the input of this session to file, for replay by the benchmark.", "file");
+    parser.addOption(recordOption);
+    QCommandLineOption onDemandOption("on-demand", "Only repaint when something changed; space pauses the animation.");
+    parser.addOption(onDemandOption);
+    QCommandLineOption glDebugOption("gl-debug", "GL debug output: off, async or sync.", "tier",
+                                     GlDebug::tierName(GlDebug::defaultTier()));
+    parser.addOption(glDebugOption);
+    QCommandLineOption gridOption("grid", "Quads per side of the water grid.", "resolution", "99");
+    parser.addOption(gridOption);
+    QCommandLineOption stripsOption("strips", "Draw the water grid as triangle strips with primitive restart.");
+    parser.addOption(stripsOption);
+    QCommandLineOption lodOption("lod", "Draw a level-of-detail water surface over [-extent, extent] instead of the grid.", "extent");
+    parser.addOption(lodOption);
+    OceanFft::addOptions(parser);
+    QCommandLineOption cpuWavesOption("cpu-waves", "Displace the water grid on the CPU and stream it every frame.");
+    parser.addOption(cpuWavesOption);
+    WaveSet::addOptions(parser);
+    QCommandLineOption displacementOption("displacement-pass", "Displace the water grid once per frame with transform feedback.");
+    parser.addOption(displacementOption);
+    Ripples::addOptions(parser);
+    Floaters::addOptions(parser);
+    Spray::addOptions(parser);
+    parser.process(a);
+    Trace::setEnabled(parser.isSet(traceOption));
+
+    GlDebug::Tier glDebugTier;
+    if (!GlDebug::parseTier(parser.value(glDebugOption), glDebugTier))
+        return 1;
+    GlDebug::setTier(glDebugTier);
+
+    OceanFft::Config oceanConfig;
+    if (!OceanFft::configure(parser, oceanConfig))
+        return 1;
+    QVector<WaveSet::Wave> waves;
+    if (!WaveSet::configure(parser, waves))
+        return 1;
+    Ripples::Config rippleConfig;
+    if (!Ripples::configure(parser, rippleConfig))
+        return 1;
+    Floaters::Config boatConfig;
+    if (!Floaters::configure(parser, boatConfig))
+        return 1;
+    Spray::Config sprayConfig;
+    if (!Spray::configure(parser, sprayConfig))
+        return 1;
+
     // Request OpenGL 3.3 Core
     QSurfaceFormat glFormat;
     glFormat.setProfile(QSurfaceFormat::CoreProfile);
     glFormat.setVersion(3, 3);
-    glFormat.setOption(QSurfaceFormat::DebugContext);
+    GlDebug::configureFormat(glFormat);
 
     // Some platforms need to explicitly set the depth buffer size (24 bits)
     glFormat.setDepthBufferSize(24);
@@ -20,7 +73,34 @@ int main(int argc, char *argv[])
     QSurfaceFormat::setDefaultFormat(glFormat);
 
     MainWindow w;
+    w.mainView()->setRenderOnDemand(parser.isSet(onDemandOption));
+    w.mainView()->setGrid(parser.value(gridOption).toInt(), parser.isSet(stripsOption));
+    w.mainView()->setLod(parser.value(lodOption).toFloat());
+    if (parser.isSet("ocean"))
+        w.mainView()->setOcean(oceanConfig);
+    w.mainView()->setCpuWaves(parser.isSet(cpuWavesOption));
+    if (!waves.isEmpty())
+        w.mainView()->setWaves(waves);
+    w.mainView()->setDisplacementPass(parser.isSet(displacementOption));
+    if (parser.isSet("ripples"))
+        w.mainView()->setRipples(rippleConfig);
+    if (parser.isSet("boats"))
+        w.mainView()->setBoats(boatConfig);
+    if (parser.isSet("spray"))
+        w.mainView()->setSpray(sprayConfig);
+    InputLog inputLog;
+    if (parser.isSet(recordOption))
+        w.mainView()->startRecording(&inputLog);
     w.show();
 
-    return a.exec();
+    int result = a.exec();
+
+    if (parser.isSet(recordOption)) {
+        w.mainView()->stopRecording();
+        inputLog.save(parser.value(recordOption));
+    }
+
+    if (parser.isSet(traceOption))
+        Trace::writeChromeJson(parser.value(traceOption));
+    return result;
 }
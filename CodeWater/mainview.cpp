@@ -1,10 +1,19 @@
 #include "mainview.h"
 #include "model.h"
+#include "trace.h"
 #include "vertex.h"
 
 #include <math.h>
 #include <QDateTime>
 
+namespace {
+const int frameInterval = 1000 / 60; // milliseconds
+const int oceanDisplacementUnit = 1;
+const int oceanNormalUnit = 2;
+const int rippleUnit = 3;
+const float impulseRadius = 0.05f; // grid units
+}
+
 /**
  * @brief MainView::MainView
  *
@@ -15,7 +24,10 @@
 MainView::MainView(QWidget *parent) : QOpenGLWidget(parent) {
     qDebug() << "MainView constructor";
 
-    connect(&timer, SIGNAL(timeout()), this, SLOT(update()));
+    connect(&timer, SIGNAL(timeout()), this, SLOT(onTimer()));
+    // Keep the framebuffer between frames, so paintGL() can skip a frame
+    // that would look the same when rendering on demand.
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
 }
 
 /**
@@ -27,13 +39,30 @@ MainView::MainView(QWidget *parent) : QOpenGLWidget(parent) {
  *
  */
 MainView::~MainView() {
-    debugLogger->stopLogging();
-
     qDebug() << "MainView destructor";
 
+    makeCurrent();
+
+    glDebug.destroy();
+    statsOverlay.destroy();
+    gpuProfiler.destroy();
+    while (!shaderBuilder.isIdle())
+        shaderBuilder.poll();
+    shaderPermutations.destroy();
+
     glDeleteTextures(1, &texturePtr);
 
-    destroyModelBuffers();
+    grid.destroy();
+    waterLod.destroy();
+    ocean.destroy();
+    waveSet.destroy();
+    displacement.destroy();
+    ripples.destroy();
+    spray.destroy();
+    if (boatsEnabled) {
+        glDeleteBuffers(1, &boatBuffer);
+        glDeleteVertexArrays(1, &boatVao);
+    }
 }
 
 // --- OpenGL initialization
@@ -48,15 +77,8 @@ void MainView::initializeGL() {
     qDebug() << ":: Initializing OpenGL";
     initializeOpenGLFunctions();
 
-    debugLogger = new QOpenGLDebugLogger();
-    connect( debugLogger, SIGNAL( messageLogged( QOpenGLDebugMessage ) ),
-             this, SLOT( onMessageLogged( QOpenGLDebugMessage ) ), Qt::DirectConnection );
-
-    if ( debugLogger->initialize() ) {
-        qDebug() << ":: Logging initialized";
-        debugLogger->startLogging( QOpenGLDebugLogger::SynchronousLogging );
-        debugLogger->enableMessages();
-    }
+    glDebug.initialize();
+    Trace::initializeGL();
 
     QString glVersion;
     glVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
@@ -67,121 +89,153 @@ void MainView::initializeGL() {
     glDepthFunc(GL_LEQUAL);
     glClearColor(0.0, 1.0, 0.0, 1.0);
 
-    createShaderProgram();
+    gpuProfiler.initialize();
+    statsOverlay.initialize();
+
+    if (sprayEnabled && (lodExtent > 0 || oceanEnabled)) {
+        qWarning() << ":: Spray is seeded from the displaced grid, not the LOD surface or the ocean; disabled";
+        sprayEnabled = false;
+    }
+    if (sprayEnabled && !cpuWavesEnabled && !displacementPass) {
+        qDebug() << ":: Spray turns on the displacement pass";
+        displacementPass = true;
+    }
+    if (displacementPass && (lodExtent > 0 || oceanEnabled || cpuWavesEnabled)) {
+        qWarning() << ":: The displacement pass only displaces the grid by the wave set; disabled";
+        displacementPass = false;
+    }
     initializeWaterProperties();
-    loadMesh();
+    createShaderProgram();
+    grid.initialize();
+    grid.setResolution(gridResolution, gridStrips);
+    if (displacementPass) {
+        ShaderPermutations::Features features = { ShaderPermutations::FALLBACK, false, waveSet.count() };
+        features.displace = true;
+        displacementPass = displacement.initialize(shaderPermutations.vertexShader(features));
+    }
+    if (displacementPass) {
+        displacement.setSource(grid.vertexBuffer(), grid.vertexCount());
+        grid.setDrawBuffer(displacement.buffer());
+    }
+    if (lodExtent > 0) {
+        waterLod.initialize(lodExtent);
+        qDebug() << ":: Water LOD:" << waterLod.levels() << "levels over" << 2 * lodExtent << "units";
+    }
+    if (oceanEnabled)
+        ocean.initialize(oceanConfig);
+    if (ripplesEnabled)
+        ripples.initialize(rippleConfig);
+    if (cpuWavesEnabled && (lodExtent > 0 || oceanEnabled)) {
+        qWarning() << ":: CPU waves only displace the grid; disabled";
+        cpuWavesEnabled = false;
+    }
+    if (cpuWavesEnabled && customWaves) {
+        qWarning() << ":: CPU waves only evaluate the default sines; disabled";
+        cpuWavesEnabled = false;
+    }
+    if (cpuWavesEnabled)
+        cpuWaves.setVertices(grid.vertices());
+    if (sprayEnabled && !displacementPass && !cpuWavesEnabled) {
+        qWarning() << ":: Spray needs the displacement pass or the CPU waves; disabled";
+        sprayEnabled = false;
+    }
+    if (sprayEnabled)
+        sprayEnabled = spray.initialize(sprayConfig);
+    if (sprayEnabled)
+        spray.setSource(displacementPass ? displacement.buffer() : grid.vertexBuffer(), grid.vertexCount());
+    if (boatsEnabled) {
+        waterQuery.setWaves(waveSet.waves());
+        if (oceanEnabled)
+            waterQuery.setOcean(&ocean, oceanTileSize);
+        if (ripplesEnabled && rippleConfig.gpu)
+            qDebug() << ":: GPU ripples stay on the GPU; the boats do not feel them";
+        waterQuery.setRipples(ripplesEnabled ? &ripples : nullptr);
+        boats.initialize(boatConfig);
+        loadBoat();
+    }
 
     // Initialize transformations
     updateProjectionTransform();
     updateModelTransforms();
 
-    timer.start(1000.0 / 60.0);
+    timer.start(frameInterval);
 }
 
 void MainView::initializeWaterProperties()
 {
-    // number of waves
-    numwaves = 6;
-
-    // Frequencies
-    frequencies = new float[numwaves];
-    frequencies[0] = 5.3;
-    frequencies[1] = 2*sqrt(2);
-    frequencies[2] = M_PI/2;
-    frequencies[3] = 6.3;
-    frequencies[4] = 1.5;
-    frequencies[5] = 0.55;
-
-    // phases
-    phases = new float[numwaves];
-    phases[0] = 0.3;
-    phases[1] = 2.0;
-    phases[2] = 0.2;
-    phases[3] = 1.0;
-    phases[4] = 1.3;
-    phases[5] = 3.8;
-
-    amplitudes = new float[numwaves];
-    amplitudes[0] = 0.041;
-    amplitudes[1] = 0.033;
-    amplitudes[2] = 0.034;
-    amplitudes[3] = 0.015;
-    amplitudes[4] = 0.019;
-    amplitudes[5] = 0.029;
-
+    // The six sines, which SineWaves also evaluates on the CPU.
+    QVector<SineWaves::Wave> sines = SineWaves::defaultWaves();
+    cpuWaves.setWaves(sines);
+    if (!customWaves)
+        waveSet.setWaves(WaveSet::fromSines(sines));
+    waveSet.initialize();
+    qDebug() << ":: Water waves:" << waveSet.count() << (customWaves ? "Gerstner waves" : "sines");
 }
 
 void MainView::createShaderProgram()
 {
-    // Create Normal Shader program
-    normalShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                           ":/shaders/vertshader_normal.glsl");
-    normalShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                           ":/shaders/fragshader_normal.glsl");
-    normalShaderProgram.link();
-
-    // Create Phong Shader program
-    phongShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                           ":/shaders/vertshader_phong.glsl");
-    phongShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                           ":/shaders/fragshader_phong.glsl");
-    phongShaderProgram.link();
-
-    // Get the uniforms for the normal shader.
-    uniformModelViewTransformNormal  = normalShaderProgram.uniformLocation("modelViewTransform");
-    uniformProjectionTransformNormal = normalShaderProgram.uniformLocation("projectionTransform");
-    uniformNormalTransformNormal     = normalShaderProgram.uniformLocation("normalTransform");
-    // waves
-    uniformNumWaves = normalShaderProgram.uniformLocation("numwaves");
-    uniformAmplitudes = normalShaderProgram.uniformLocation("amplitude");
-    uniformPhases = normalShaderProgram.uniformLocation("phase");
-    uniformFrequencies = normalShaderProgram.uniformLocation("frequency");
-    uniformT = normalShaderProgram.uniformLocation("t");
-
-    // Get the uniforms for the phong shader.
-    uniformModelViewTransformPhong  = phongShaderProgram.uniformLocation("modelViewTransform");
-    uniformProjectionTransformPhong = phongShaderProgram.uniformLocation("projectionTransform");
-    uniformNormalTransformPhong     = phongShaderProgram.uniformLocation("normalTransform");
-    uniformMaterialPhong            = phongShaderProgram.uniformLocation("material");
-    uniformLightPositionPhong       = phongShaderProgram.uniformLocation("lightPosition");
-    uniformLightColourPhong         = phongShaderProgram.uniformLocation("lightColour");
-    // waves
-    uniformNumWavesPhong = phongShaderProgram.uniformLocation("numwaves");
-    uniformAmplitudesPhong = phongShaderProgram.uniformLocation("amplitude");
-    uniformPhasesPhong = phongShaderProgram.uniformLocation("phase");
-    uniformFrequenciesPhong = phongShaderProgram.uniformLocation("frequency");
-    uniformTPhong = phongShaderProgram.uniformLocation("t");
-}
-
-void MainView::loadMesh()
-{
-    Model model(":/models/grid.obj");
-    model.unitize();
-    QVector<float> meshData = model.getVNTInterleaved();
-
-    this->meshSize = model.getVertices().size();
-
-    // Generate VAO
-    glGenVertexArrays(1, &meshVAO);
-    glBindVertexArray(meshVAO);
-
-    // Generate VBO
-    glGenBuffers(1, &meshVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
-
-    // Write the data to the buffer
-    glBufferData(GL_ARRAY_BUFFER, meshData.size() * sizeof(float), meshData.data(), GL_STATIC_DRAW);
-
-    // Set vertex coordinates to location 0
+    shaderCache.initialize();
+    shaderBuilder.initialize(&shaderCache);
+    shaderPermutations.initialize(&shaderCache, &shaderBuilder,
+                                  readFile(":/shaders/vertshader_uber.glsl"),
+                                  readFile(":/shaders/fragshader_uber.glsl"));
+
+    // Submit every shading mode, the selected one last so it is built first.
+    if (boatsEnabled) {
+        for (ShadingMode shading : { GOURAUD, NORMAL, PHONG, currentShader })
+            shaderPermutations.variant(boatFeaturesFor(shading));
+    }
+    for (ShadingMode shading : { GOURAUD, NORMAL, PHONG, currentShader })
+        shaderPermutations.variant(shaderFeaturesFor(shading));
+}
+
+ShaderPermutations::Features MainView::shaderFeaturesFor(ShadingMode shading)
+{
+    bool displaced = cpuWavesEnabled || displacementPass;
+    int waves = oceanEnabled || displaced ? 0 : waveSet.count();
+    ShaderPermutations::Features features = { ShaderPermutations::FALLBACK, false, waves, lodExtent > 0,
+                                              oceanEnabled, displaced };
+    features.ripples = ripplesEnabled;
+    switch (shading) {
+    case NORMAL: features.lighting = ShaderPermutations::NORMAL; return features;
+    case GOURAUD: features.lighting = ShaderPermutations::GOURAUD; return features;
+    case PHONG: features.lighting = ShaderPermutations::PHONG; return features;
+    }
+    return { ShaderPermutations::FALLBACK, false, 0 };
+}
+
+ShaderPermutations::Features MainView::boatFeaturesFor(ShadingMode shading)
+{
+    return { shaderFeaturesFor(shading).lighting, false, 0 };
+}
+
+void MainView::loadBoat()
+{
+    Model boat(":/models/boat.obj");
+    boat.unitize();
+    QVector<float> vertices = boat.getVNTInterleaved();
+    boatVertices = vertices.size() / 8;
+
+    glGenVertexArrays(1, &boatVao);
+    glGenBuffers(1, &boatBuffer);
+    glBindVertexArray(boatVao);
+    glBindBuffer(GL_ARRAY_BUFFER, boatBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.constData(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
     glEnableVertexAttribArray(0);
-
-    // Set vertex normals to location 1
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // boat.obj is y up and longest along z: its z becomes the length, x the width and y the height.
+    float size = boatConfig.length / 2;
+    boatShape = QMatrix4x4(0, 0, size, 0,
+                           size, 0, 0, 0,
+                           0, size, 0, 0,
+                           0, 0, 0, 1);
 }
 
 // --- OpenGL drawing
@@ -193,30 +247,144 @@ void MainView::loadMesh()
  *
  */
 void MainView::paintGL() {
-    t = t + 2.0/60;
+    // Nothing changed: with PartialUpdate QOpenGLWidget keeps and presents the
+    // last frame.
+    if (renderOnDemand && !dirty)
+        return;
+
+    TRACE_GL_SCOPE("paintGL");
+    AllocTracker::Scope allocations;
+    applyReplay();
+    if (animating)
+        t = t + 2.0/60;
+    frameStats.beginFrame();
+    gpuProfiler.beginFrame();
+
     // Clear the screen before rendering
     glClearColor(0.2f, 0.2f, 0.2f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Choose the selected shader.
-    QOpenGLShaderProgram *shaderProgram = &normalShaderProgram;
-    switch (currentShader) {
-    case NORMAL:
-        shaderProgram = &normalShaderProgram;
-        shaderProgram->bind();
-        updateNormalUniforms();
-        break;
-    case PHONG:
-        shaderProgram = &phongShaderProgram;
-        shaderProgram->bind();
-        updatePhongUniforms();
-        break;
+    shaderPermutations.poll();
+
+    if (oceanEnabled) {
+        frameStats.current().bufferBytes += ocean.update(t);
+        ocean.bind(oceanDisplacementUnit, oceanNormalUnit);
+    }
+    if (cpuWavesEnabled) {
+        cpuWaves.evaluate(t);
+        frameStats.current().bufferBytes += grid.uploadVertices(cpuWaves.vertices());
+    }
+    if (!oceanEnabled && !cpuWavesEnabled) {
+        frameStats.current().bufferBytes += waveSet.update(t);
+        waveSet.bind();
+        frameStats.addStateChange();
+    }
+    if (displacementPass) {
+        gpuProfiler.begin("displacement");
+        displacement.update();
+        gpuProfiler.end();
+        frameStats.addStateChange();
+        frameStats.addDraw(0);
+    }
+    if (ripplesEnabled) {
+        gpuProfiler.begin("ripples");
+        frameStats.current().bufferBytes += ripples.update(t);
+        gpuProfiler.end();
+        ripples.bind(rippleUnit);
+        frameStats.addStateChange();
+    }
+    if (boatsEnabled)
+        boats.update(waterQuery, t);
+    if (sprayEnabled) {
+        gpuProfiler.begin("spray");
+        spray.update(t, frameStats);
+        gpuProfiler.end();
+        frameStats.current().particles = spray.living();
+        frameStats.current().particleCapacity = spray.capacity();
     }
 
-    glBindVertexArray(meshVAO);
-    glDrawArrays(GL_TRIANGLES, 0, meshSize);
+    // Choose the selected shader, or the fallback while it is still being built.
+    ShaderVariant *shader = shaderPermutations.variant(shaderFeaturesFor(currentShader));
+    if (!shader->ready)
+        shader = shaderPermutations.fallback();
+    QOpenGLShaderProgram *shaderProgram = &shader->program;
+    shaderProgram->bind();
+    frameStats.addStateChange();
+    updateUniforms(shader);
+
+    gpuProfiler.begin("water");
+    {
+        TRACE_GL_SCOPE("draw submission");
+        if (lodExtent > 0) {
+            frameStats.current().bufferBytes += waterLod.update(lodCamera);
+            waterLod.draw();
+            frameStats.addStateChange();
+            frameStats.addDraw(waterLod.triangles());
+        } else {
+            grid.draw();
+            frameStats.addStateChange();
+            frameStats.addDraw(grid.triangles());
+        }
+    }
+    gpuProfiler.end();
 
     shaderProgram->release();
+
+    if (boatsEnabled)
+        drawBoats();
+
+    // Last, blended over everything without writing depth.
+    if (sprayEnabled) {
+        gpuProfiler.begin("spray sprites");
+        spray.draw(projectionTransform, meshTransform, frameStats);
+        gpuProfiler.end();
+    }
+
+    if (showStats)
+        statsOverlay.draw(frameStats.last(), width() * devicePixelRatio(), height() * devicePixelRatio(), frameStats);
+
+    gpuProfiler.endFrame();
+    const QVector<GpuProfiler::Timing> &gpuTimes = gpuProfiler.results();
+    if (sprayEnabled)
+        frameStats.current().simulationMilliseconds = gpuProfiler.milliseconds("spray");
+    frameStats.endFrame(gpuTimes.isEmpty() ? 0 : gpuTimes.first().milliseconds);
+
+    // Until the selected shader is in, keep painting.
+    dirty = (!shader->ready || isLoading()) ? LOADING : 0;
+    if (dirty && !timer.isActive())
+        timer.start(frameInterval);
+
+    frameAllocations = allocations.counts();
+    ++tick;
+}
+
+// Every boat is a draw of its own; there are few, and they are small.
+void MainView::drawBoats()
+{
+    ShaderVariant *shader = shaderPermutations.variant(boatFeaturesFor(currentShader));
+    if (!shader->ready)
+        return;
+    shader->program.bind();
+    frameStats.addStateChange();
+    updateUniforms(shader);
+
+    gpuProfiler.begin("boats");
+    glBindVertexArray(boatVao);
+    frameStats.addStateChange();
+    for (int idx = 0; idx < boats.bodies().size(); ++idx) {
+        QMatrix4x4 modelView = meshTransform * boats.transform(idx) * boatShape;
+        QMatrix3x3 normalTransform = modelView.normalMatrix();
+        glUniformMatrix4fv(shader->uniformModelViewTransform, 1, GL_FALSE, modelView.data());
+        frameStats.addUniformBytes(shader->uniformModelViewTransform, 16 * sizeof(float));
+        glUniformMatrix3fv(shader->uniformNormalTransform, 1, GL_FALSE, normalTransform.data());
+        frameStats.addUniformBytes(shader->uniformNormalTransform, 9 * sizeof(float));
+        glDrawArrays(GL_TRIANGLES, 0, boatVertices);
+        frameStats.addDraw(boatVertices / 3);
+    }
+    glBindVertexArray(0);
+    gpuProfiler.end();
+
+    shader->program.release();
 }
 
 /**
@@ -232,96 +400,334 @@ void MainView::resizeGL(int newWidth, int newHeight)
     Q_UNUSED(newWidth)
     Q_UNUSED(newHeight)
     updateProjectionTransform();
+    dirty |= SCENE;
 }
 
-void MainView::updateNormalUniforms()
+void MainView::updateUniforms(const ShaderVariant *variant)
 {
-    glUniformMatrix4fv(uniformProjectionTransformNormal, 1, GL_FALSE, projectionTransform.data());
-    glUniformMatrix4fv(uniformModelViewTransformNormal, 1, GL_FALSE, meshTransform.data());
-    glUniformMatrix3fv(uniformNormalTransformNormal, 1, GL_FALSE, meshNormalTransform.data());
-    glUniform1fv(uniformAmplitudes, numwaves, amplitudes);
-    glUniform1fv(uniformFrequencies, numwaves, frequencies);
-    glUniform1fv(uniformPhases, numwaves, phases);
-    glUniform1i(uniformNumWaves, numwaves);
-    glUniform1f(uniformT, t);
+    TRACE_GL_SCOPE("uniform upload");
+    glUniformMatrix4fv(variant->uniformProjectionTransform, 1, GL_FALSE, projectionTransform.data());
+    frameStats.addUniformBytes(variant->uniformProjectionTransform, 16 * sizeof(float));
+    glUniformMatrix4fv(variant->uniformModelViewTransform, 1, GL_FALSE, meshTransform.data());
+    frameStats.addUniformBytes(variant->uniformModelViewTransform, 16 * sizeof(float));
+    glUniformMatrix3fv(variant->uniformNormalTransform, 1, GL_FALSE, meshNormalTransform.data());
+    frameStats.addUniformBytes(variant->uniformNormalTransform, 9 * sizeof(float));
+
+    // Uniforms the variant does not use have location -1, are ignored and not counted.
+    glUniform4fv(variant->uniformMaterial, 1, &material[0]);
+    frameStats.addUniformBytes(variant->uniformMaterial, 4 * sizeof(float));
+    glUniform3fv(variant->uniformLightPosition, 1, &lightPosition[0]);
+    frameStats.addUniformBytes(variant->uniformLightPosition, 3 * sizeof(float));
+    glUniform3fv(variant->uniformLightColour, 1, &lightColour[0]);
+    frameStats.addUniformBytes(variant->uniformLightColour, 3 * sizeof(float));
+
+    // The waves and their phases are in waveSet's uniform buffer.
+
+    if (lodExtent > 0) {
+        glUniform3fv(variant->uniformLodCamera, 1, &lodCamera[0]);
+        frameStats.addUniformBytes(variant->uniformLodCamera, 3 * sizeof(float));
+        glUniform2fv(variant->uniformLodRanges, waterLod.levels(), &waterLod.morphRanges()[0][0]);
+        frameStats.addUniformBytes(variant->uniformLodRanges, 2 * waterLod.levels() * sizeof(float));
+        glUniform1f(variant->uniformLodPatchQuads, WaterLod::patchQuads);
+        frameStats.addUniformBytes(variant->uniformLodPatchQuads, sizeof(float));
+    }
+
+    if (oceanEnabled) {
+        glUniform1i(variant->uniformOceanDisplacement, oceanDisplacementUnit);
+        frameStats.addUniformBytes(variant->uniformOceanDisplacement, sizeof(GLint));
+        glUniform1i(variant->uniformOceanNormals, oceanNormalUnit);
+        frameStats.addUniformBytes(variant->uniformOceanNormals, sizeof(GLint));
+        glUniform1f(variant->uniformOceanTileSize, oceanTileSize);
+        frameStats.addUniformBytes(variant->uniformOceanTileSize, sizeof(float));
+        glUniform1f(variant->uniformOceanAmplitude, ocean.amplitude());
+        frameStats.addUniformBytes(variant->uniformOceanAmplitude, sizeof(float));
+    }
+
+    if (ripplesEnabled) {
+        glUniform1i(variant->uniformRippleHeight, rippleUnit);
+        frameStats.addUniformBytes(variant->uniformRippleHeight, sizeof(GLint));
+    }
+
+    // CPU waves only run with the default set, which has the same amplitude.
+    if (cpuWavesEnabled || displacementPass) {
+        glUniform1f(variant->uniformWaveAmplitude, waveSet.amplitude());
+        frameStats.addUniformBytes(variant->uniformWaveAmplitude, sizeof(float));
+    }
 }
 
-void MainView::updatePhongUniforms()
+bool MainView::pickWaterPlane(const QPoint &position, QVector2D &point) const
 {
-    glUniformMatrix4fv(uniformProjectionTransformPhong, 1, GL_FALSE, projectionTransform.data());
-    glUniformMatrix4fv(uniformModelViewTransformPhong, 1, GL_FALSE, meshTransform.data());
-    glUniformMatrix3fv(uniformNormalTransformPhong, 1, GL_FALSE, meshNormalTransform.data());
-
-    glUniform4fv(uniformMaterialPhong, 1, &material[0]);
-    glUniform3fv(uniformLightPositionPhong, 1, &lightPosition[0]);
-    glUniform3fv(uniformLightColourPhong, 1, &lightColour[0]);
-    glUniform1fv(uniformAmplitudesPhong, numwaves, amplitudes);
-    glUniform1fv(uniformFrequenciesPhong, numwaves, frequencies);
-    glUniform1fv(uniformPhasesPhong, numwaves, phases);
-    glUniform1i(uniformNumWavesPhong, numwaves);
-    glUniform1f(uniformTPhong, t);
+    float x = 2.0f * position.x() / width() - 1;
+    float y = 1 - 2.0f * position.y() / height();
+    QMatrix4x4 inverse = (projectionTransform * meshTransform).inverted();
+    QVector3D nearPoint = inverse.map(QVector3D(x, y, -1));
+    QVector3D farPoint = inverse.map(QVector3D(x, y, 1));
+    if (qFuzzyCompare(nearPoint.z(), farPoint.z()))
+        return false;
+
+    float along = nearPoint.z() / (nearPoint.z() - farPoint.z());
+    if (along < 0 || along > 1)
+        return false;
+    point = (nearPoint + along * (farPoint - nearPoint)).toVector2D();
+    return true;
 }
 
 void MainView::updateProjectionTransform()
 {
     float aspect_ratio = static_cast<float>(width()) / static_cast<float>(height());
     projectionTransform.setToIdentity();
-    projectionTransform.perspective(60, aspect_ratio, 0.2, 20);
+    projectionTransform.perspective(60, aspect_ratio, 0.2, farPlane);
 }
 
 void MainView::updateModelTransforms()
 {
+    TRACE_SCOPE("transform update");
     meshTransform.setToIdentity();
     meshTransform.translate(0, 0, -4);
     meshTransform.scale(scale);
     meshTransform.rotate(QQuaternion::fromEulerAngles(rotation));
     meshNormalTransform = meshTransform.normalMatrix();
-
-    update();
-}
-
-// --- OpenGL cleanup helpers
-
-void MainView::destroyModelBuffers()
-{
-    glDeleteBuffers(1, &meshVBO);
-    glDeleteVertexArrays(1, &meshVAO);
+    // The camera sits at the view space origin.
+    lodCamera = meshTransform.inverted().map(QVector3D());
 }
 
 // --- Public interface
 
 void MainView::setRotation(int rotateX, int rotateY, int rotateZ)
 {
+    recordInput(InputLog::ROTATION, rotateX, rotateY, rotateZ);
+
     rotation = { static_cast<float>(rotateX), static_cast<float>(rotateY), static_cast<float>(rotateZ) };
     updateModelTransforms();
+    markDirty(SCENE);
 }
 
 void MainView::setScale(int newScale)
 {
+    recordInput(InputLog::SCALE, newScale);
+
     scale = static_cast<float>(newScale) / 100.f;
     updateModelTransforms();
+    markDirty(SCENE);
 }
 
 void MainView::setShadingMode(ShadingMode shading)
 {
-    if (shading==GOURAUD)
-        qDebug() << "Gouraud is not implemented";
-    else {
-        qDebug() << "Changed shading to" << shading;
-        currentShader = shading;
+    recordInput(InputLog::SHADING_MODE, shading);
+
+    qDebug() << "Changed shading to" << shading;
+    currentShader = shading;
+    markDirty(SCENE);
+}
+
+void MainView::setGrid(int resolution, bool strips)
+{
+    recordInput(InputLog::GRID, resolution, strips);
+
+    gridResolution = qBound(1, resolution, WaterGrid::maxResolution);
+    gridStrips = strips;
+    if (grid.resolution() > 0) {
+        makeCurrent();
+        grid.setResolution(gridResolution, gridStrips);
+        if (cpuWavesEnabled)
+            cpuWaves.setVertices(grid.vertices());
+        if (displacementPass)
+            displacement.setSource(grid.vertexBuffer(), grid.vertexCount());
+        if (sprayEnabled)
+            spray.setSource(displacementPass ? displacement.buffer() : grid.vertexBuffer(), grid.vertexCount());
+        qDebug() << ":: Water grid:" << gridResolution << "x" << gridResolution << (gridStrips ? "strips" : "triangles");
     }
+    markDirty(SCENE);
+}
+
+void MainView::setLod(float extent)
+{
+    lodExtent = qMax(0.f, extent);
+    farPlane = qMax(20.f, 4 + 2 * lodExtent);
+}
+
+void MainView::setOcean(const OceanFft::Config &config)
+{
+    oceanConfig = config;
+    oceanEnabled = true;
+}
+
+void MainView::setCpuWaves(bool enabled)
+{
+    cpuWavesEnabled = enabled;
+}
+
+void MainView::setWaves(const QVector<WaveSet::Wave> &waves)
+{
+    waveSet.setWaves(waves);
+    customWaves = true;
+}
+
+void MainView::setDisplacementPass(bool enabled)
+{
+    displacementPass = enabled;
+}
+
+void MainView::setRipples(const Ripples::Config &config)
+{
+    rippleConfig = config;
+    ripplesEnabled = true;
+}
+
+void MainView::setBoats(const Floaters::Config &config)
+{
+    boatConfig = config;
+    boatsEnabled = true;
+}
+
+void MainView::setSpray(const Spray::Config &config)
+{
+    sprayConfig = config;
+    sprayEnabled = true;
+}
+
+void MainView::addImpulse(float x, float y, float strength)
+{
+    recordInput(InputLog::IMPULSE, x, y, strength);
+
+    if (ripplesEnabled)
+        ripples.addImpulse(x, y, impulseRadius, strength);
+    markDirty(ANIMATION);
+}
+
+void MainView::setRenderOnDemand(bool onDemand)
+{
+    renderOnDemand = onDemand;
+    if (!renderOnDemand && !timer.isActive())
+        timer.start(frameInterval);
+    markDirty(SCENE);
+}
+
+void MainView::setAnimating(bool animate)
+{
+    if (animate != animating)
+        toggleAnimation();
+}
+
+void MainView::startRecording(InputLog *log)
+{
+    recorder = log;
+    recorder->startRecording();
+    recordStart = tick;
+}
+
+void MainView::stopRecording()
+{
+    if (recorder)
+        recorder->finish(tick - recordStart, size() * devicePixelRatio());
+    recorder = nullptr;
+}
+
+void MainView::startReplay(const InputLog *log)
+{
+    replay = log;
+    replayStart = tick;
+    replayCursor = 0;
+}
+
+bool MainView::isReplaying() const
+{
+    return replay && tick - replayStart < replay->length();
+}
+
+const FrameCounters &MainView::frameCounters() const
+{
+    return frameStats.last();
+}
+
+void MainView::finishLoading()
+{
+    makeCurrent();
+    while (!shaderBuilder.isIdle())
+        shaderPermutations.poll();
 }
 
 // --- Private helpers
 
+void MainView::recordInput(InputLog::Action action, float x, float y, float z)
+{
+    if (recorder)
+        recorder->record(tick - recordStart, action, x, y, z);
+}
+
+void MainView::toggleStats()
+{
+    recordInput(InputLog::TOGGLE_STATS);
+    showStats = !showStats;
+    markDirty(SCENE);
+}
+
+void MainView::toggleAnimation()
+{
+    recordInput(InputLog::TOGGLE_ANIMATION);
+    animating = !animating;
+    markDirty(ANIMATION);
+}
+
+// Repaints once soon; update() requests are merged by Qt.
+void MainView::markDirty(quint32 flags)
+{
+    dirty |= flags;
+    if (renderOnDemand && !timer.isActive() && (animating || isLoading()))
+        timer.start(frameInterval);
+    update();
+}
+
+bool MainView::isLoading() const
+{
+    return !shaderBuilder.isIdle();
+}
+
+// Applies the replayed events that happened before the frame about to render.
+void MainView::applyReplay()
+{
+    if (!replay)
+        return;
+
+    const QVector<InputLog::Event> &events = replay->events();
+    while (replayCursor < events.size() && events[replayCursor].tick <= tick - replayStart)
+        applyInputEvent(events[replayCursor++]);
+}
+
+// The water scene has no view rotation or distance; those events are skipped.
+void MainView::applyInputEvent(const InputLog::Event &event)
+{
+    const float *values = event.values;
+    switch (event.action) {
+    case InputLog::ROTATION: setRotation(values[0], values[1], values[2]); break;
+    case InputLog::SCALE: setScale(values[0]); break;
+    case InputLog::SHADING_MODE: setShadingMode(static_cast<ShadingMode>(values[0])); break;
+    case InputLog::TOGGLE_STATS: toggleStats(); break;
+    case InputLog::TOGGLE_ANIMATION: toggleAnimation(); break;
+    case InputLog::GRID: setGrid(values[0], values[1] != 0); break;
+    case InputLog::IMPULSE: addImpulse(values[0], values[1], values[2]); break;
+    default: break;
+    }
+}
+
 /**
- * @brief MainView::onMessageLogged
+ * @brief MainView::onTimer
  *
- * OpenGL logging function, do not change
- *
- * @param Message
+ * Called at 60 Hz. Always repaints, unless rendering on demand: then it
+ * only repaints while the water moves or shaders load, and stops itself
+ * when idle.
  */
-void MainView::onMessageLogged( QOpenGLDebugMessage Message ) {
-    qDebug() << " → Log:" << Message;
-}
+void MainView::onTimer()
+{
+    if (!renderOnDemand) {
+        update();
+        return;
+    }
 
+    if (animating)
+        dirty |= ANIMATION;
+    if (dirty)
+        update();
+    else
+        timer.stop();
+}
@@ -1,15 +1,34 @@
 #ifndef MAINVIEW_H
 #define MAINVIEW_H
 
+#include "alloctracker.h"
+#include "floaters.h"
+#include "framestats.h"
+#include "gldebug.h"
+#include "gpuprofiler.h"
+#include "inputlog.h"
 #include "model.h"
+#include "oceanfft.h"
+#include "ripples.h"
+#include "shaderbuilder.h"
+#include "shadercache.h"
+#include "shaderpermutations.h"
+#include "sinewaves.h"
+#include "spray.h"
+#include "statsoverlay.h"
+#include "waterdisplacement.h"
+#include "watergrid.h"
+#include "waterlod.h"
+#include "waterquery.h"
+#include "waveset.h"
 
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions_3_3_Core>
-#include <QOpenGLDebugLogger>
 #include <QOpenGLShaderProgram>
 #include <QTimer>
+#include <QVector2D>
 #include <QVector3D>
 #include <QImage>
 #include <QVector>
@@ -19,41 +38,87 @@
 class MainView : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core {
     Q_OBJECT
 
-    QOpenGLDebugLogger *debugLogger;
+    // The headless benchmark drives initializeGL and paintGL itself.
+    friend class Benchmark;
+
+    GlDebug glDebug;
     QTimer timer; // timer used for animation
 
-    QOpenGLShaderProgram normalShaderProgram,
-                         phongShaderProgram;
-
-    // Uniforms for the normal shader.
-    GLint uniformModelViewTransformNormal;
-    GLint uniformProjectionTransformNormal;
-    GLint uniformNormalTransformNormal;
-    GLint uniformNumWaves ;
-    GLint uniformAmplitudes;
-    GLint uniformPhases;
-    GLint uniformFrequencies;
-    GLint uniformT;
-
-    // Uniforms for the phong shader.
-    GLint uniformModelViewTransformPhong;
-    GLint uniformProjectionTransformPhong;
-    GLint uniformNormalTransformPhong;
-
-    GLint uniformMaterialPhong;
-    GLint uniformLightPositionPhong;
-    GLint uniformLightColourPhong;
-
-    GLint uniformNumWavesPhong ;
-    GLint uniformAmplitudesPhong;
-    GLint uniformPhasesPhong;
-    GLint uniformFrequenciesPhong;
-    GLint uniformTPhong;
-
-    // Buffers
-    GLuint meshVAO;
-    GLuint meshVBO;
-    GLuint meshSize;
+    // Render on demand: repaint only when something visible changed, and
+    // stop the timer while nothing animates or loads.
+    enum DirtyFlag : quint32
+    {
+        SCENE = 1, ANIMATION = 2, LOADING = 4
+    };
+    bool renderOnDemand = false;
+    bool animating = true; // toggled with space
+    quint32 dirty = SCENE;
+
+    // Every shading mode is a permutation of the shared uber-shader.
+    ShaderCache shaderCache;
+    ShaderBuilder shaderBuilder;
+    ShaderPermutations shaderPermutations;
+
+    GpuProfiler gpuProfiler;
+    FrameStats frameStats;
+    StatsOverlay statsOverlay;
+    bool showStats = false; // toggled with S
+
+    // Simulation tick, the number of frames rendered so far.
+    quint32 tick = 0;
+    InputLog *recorder = nullptr;
+    quint32 recordStart = 0;
+    const InputLog *replay = nullptr;
+    quint32 replayStart = 0;
+    int replayCursor = 0;
+    AllocTracker::Counts frameAllocations = {0, 0}; // of the last paintGL, with ALLOC_TRACKING
+
+    // The water surface, generated at gridResolution quads per side.
+    WaterGrid grid;
+    int gridResolution = 99; // the resolution of the former grid.obj
+    bool gridStrips = false;
+
+    // With lodExtent > 0 the surface is a WaterLod over [-lodExtent, lodExtent]
+    // instead of the grid.
+    WaterLod waterLod;
+    float lodExtent = 0;
+    QVector3D lodCamera; // in grid space
+
+    // With an ocean, its FFT textures displace the surface instead of the sines.
+    OceanFft ocean;
+    OceanFft::Config oceanConfig;
+    bool oceanEnabled = false;
+    float oceanTileSize = 2; // grid units, one tile over the [-1, 1] grid
+
+    // With CPU waves the sines are evaluated by SineWaves and the displaced
+    // grid is streamed every frame; not with the LOD surface or the ocean.
+    SineWaves cpuWaves;
+    bool cpuWavesEnabled = false;
+
+    // With the displacement pass the wave set displaces the grid once per
+    // frame into a buffer, which every pass then draws.
+    WaterDisplacement displacement;
+    bool displacementPass = false;
+
+    // Ripples from the mouse and floating objects, added to the waves.
+    Ripples ripples;
+    Ripples::Config rippleConfig;
+    bool ripplesEnabled = false;
+
+    // Boats riding the surface, which the water query tells where it is.
+    WaterQuery waterQuery;
+    Floaters boats;
+    Floaters::Config boatConfig;
+    bool boatsEnabled = false;
+    GLuint boatVao = 0;
+    GLuint boatBuffer = 0;
+    int boatVertices = 0;
+    QMatrix4x4 boatShape; // from boat.obj into hull space
+
+    // Spray thrown off the steep water, seeded from the displaced grid.
+    Spray spray;
+    Spray::Config sprayConfig;
+    bool sprayEnabled = false;
 
     // Texture
     GLuint texturePtr;
@@ -62,6 +127,7 @@ class MainView : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core {
     float scale = 1.f;
     QVector3D rotation;
     QMatrix4x4 projectionTransform;
+    float farPlane = 20;
     QMatrix3x3 meshNormalTransform;
     QMatrix4x4 meshTransform;
 
@@ -70,12 +136,12 @@ class MainView : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core {
     QVector3D lightPosition = {1, 20, 1};
     QVector3D lightColour = {1, 1, 1};
 
-    // Water properties
-    int numwaves;
-    float *frequencies;
-    float *phases;
-    float *amplitudes;
-    float t = 0;
+    // Water properties: the Gerstner waves of the shader, the six sines
+    // unless setWaves() gave others.
+    WaveSet waveSet;
+    bool customWaves = false;
+    // The water clock; kept in double precision, only wrapped phases reach the GPU.
+    double t = 0;
 
 public:
     enum ShadingMode : GLuint
@@ -90,6 +156,47 @@ public:
     void setRotation(int rotateX, int rotateY, int rotateZ);
     void setScale(int scale);
     void setShadingMode(ShadingMode shading);
+    // Regenerates the water grid, also after initialization.
+    void setGrid(int resolution, bool strips);
+    // Draws a level-of-detail surface of the extent instead, 0 for the grid.
+    // Must be called before initialization.
+    void setLod(float extent);
+    // Displaces the surface with an FFT ocean. Must be called before initialization.
+    void setOcean(const OceanFft::Config &config);
+    // Displaces the grid on the CPU. Must be called before initialization.
+    void setCpuWaves(bool enabled);
+    // Replaces the default waves. Must be called before initialization.
+    void setWaves(const QVector<WaveSet::Wave> &waves);
+    // Displaces the grid in a transform feedback pass of its own. Must be
+    // called before initialization.
+    void setDisplacementPass(bool enabled);
+    // Adds a ripple simulation. Must be called before initialization.
+    void setRipples(const Ripples::Config &config);
+    // Floats boats on the water. Must be called before initialization.
+    void setBoats(const Floaters::Config &config);
+    // Throws spray off the steep water. It is seeded from the grid displaced
+    // by the displacement pass, which it turns on, or by the CPU waves. Must
+    // be called before initialization.
+    void setSpray(const Spray::Config &config);
+    // Disturbs the water at a point of the grid, if there are ripples.
+    void addImpulse(float x, float y, float strength);
+
+    // Without animation or loading, an on-demand view does no work at all.
+    void setRenderOnDemand(bool onDemand);
+    void setAnimating(bool animate);
+
+    // Records every view change into log, until stopRecording().
+    void startRecording(InputLog *log);
+    void stopRecording();
+    // Applies the events of log at their ticks, counted from the next frame.
+    void startReplay(const InputLog *log);
+    bool isReplaying() const;
+
+    // Counters of the last complete frame.
+    const FrameCounters &frameCounters() const;
+
+    // Blocks until asynchronous loading (shader builds) has finished.
+    void finishLoading();
 
 protected:
     void initializeGL();
@@ -108,28 +215,42 @@ protected:
     void wheelEvent(QWheelEvent *ev);
 
 private slots:
-    void onMessageLogged( QOpenGLDebugMessage Message );
+    void onTimer();
 
 private:
     void createShaderProgram();
-    void loadMesh();
+    ShaderPermutations::Features shaderFeaturesFor(ShadingMode shading);
+    // The boats are lit like the water, without waves.
+    ShaderPermutations::Features boatFeaturesFor(ShadingMode shading);
 
     // Loads texture data into the buffer of texturePtr.
     void loadTextures();
     void loadTexture(QString file, GLuint texturePtr);
     void initializeWaterProperties();
+    void loadBoat();
+    void drawBoats();
 
-    void destroyModelBuffers();
+    void markDirty(quint32 flags);
+    bool isLoading() const;
 
     void updateProjectionTransform();
     void updateModelTransforms();
 
-    void updateNormalUniforms();
-    void updatePhongUniforms();
+    void updateUniforms(const ShaderVariant *variant);
+    // Where the view ray through a widget position meets the undisplaced water plane.
+    bool pickWaterPlane(const QPoint &position, QVector2D &point) const;
+
+    void recordInput(InputLog::Action action, float x = 0, float y = 0, float z = 0);
+    void toggleStats();
+    void toggleAnimation();
+    void applyReplay();
+    void applyInputEvent(const InputLog::Event &event);
 
     // Useful utility method to convert image to bytes.
     QVector<quint8> imageToBytes(QImage image);
 
+    static QByteArray readFile(QString file);
+
     // The current shader to use.
     ShadingMode currentShader = PHONG;
 };
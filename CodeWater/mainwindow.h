@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+class MainView;
+
 namespace Ui {
 class MainWindow;
 }
@@ -17,6 +19,8 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    MainView *mainView() const;
+
 private slots:
     void on_ResetRotationButton_clicked(bool checked);
     void on_RotationDialX_sliderMoved(int value);
@@ -255,20 +255,28 @@ void Model::parseTexture(QStringList tokens) {
     tex.append(QVector2D(u,v));
 }
 
+/**
+ * @brief Model::parseFace
+ *
+ * Polygons with more than three corners, like the quads of boat.obj, are
+ * split into a fan of triangles around their first corner.
+ */
 void Model::parseFace(QStringList tokens) {
     QStringList elements;
 
-    for( int i = 1; i != tokens.size(); ++i ) {
-        elements = tokens[i].split("/");
-        // -1 since .obj count from 1
-        indices.append(elements[0].toInt()-1);
+    for( int i = 3; i < tokens.size(); ++i ) {
+        for ( int corner : { 1, i - 1, i } ) {
+            elements = tokens[corner].split("/");
+            // -1 since .obj count from 1
+            indices.append(elements[0].toInt()-1);
 
-        if ( elements.size() > 1 && ! elements[1].isEmpty() ) {
-            texcoord_indices.append(elements[1].toInt()-1);
-        }
+            if ( elements.size() > 1 && ! elements[1].isEmpty() ) {
+                texcoord_indices.append(elements[1].toInt()-1);
+            }
 
-        if (elements.size() > 2 && ! elements[2].isEmpty() ) {
-            normal_indices.append(elements[2].toInt()-1);
+            if (elements.size() > 2 && ! elements[2].isEmpty() ) {
+                normal_indices.append(elements[2].toInt()-1);
+            }
         }
     }
 }
@@ -356,4 +364,12 @@ void Model::unpackIndexes() {
             textureCoords.append(tex[texcoord_indices[i]]);
         }
     }
+
+    // Without normals in the file, every triangle gets its face normal.
+    if ( !hNorms ) {
+        for ( int i = 0; i + 2 < vertices.size(); i += 3 ) {
+            QVector3D normal = QVector3D::normal(vertices[i], vertices[i + 1], vertices[i + 2]);
+            normals << normal << normal << normal;
+        }
+    }
 }
@@ -11,9 +11,8 @@
  * @brief The Model class
  *
  * Loads all data from a Wavefront .obj file
- * IMPORTANT! Current only supports TRIANGLE meshes!
- *
- * Support for other meshes can be implemented by students
+ * Polygons are triangulated, and files without normals get flat ones
+ * for glDrawArrays().
  *
  */
 class Model
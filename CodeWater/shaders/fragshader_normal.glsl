@@ -1,23 +0,0 @@
-#version 330 core
-
-// Define constants
-#define M_PI 3.141593
-
-// Specify the inputs to the fragment shader
-// These must have the same type and name!
-in vec2 uv;
-in vec3 vertNormal;
-in vec3 vertCoords;
-
-// Specify the Uniforms of the fragment shaders
-// uniform vec3 lightPosition; // for example
-
-// Specify the output of the fragment shader
-// Usually a vec4 describing a color (Red, Green, Blue, Alpha/Transparency)
-out vec4 fColor;
-
-void main()
-{
-    //fColor = vec4(vertCoords.x, vertCoords.y, vertCoords.z, 1.0);
-    fColor = vec4(vertNormal*0.5+0.5, 1.0);
-}
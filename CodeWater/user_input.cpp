@@ -2,20 +2,27 @@
 
 #include <QDebug>
 
+namespace {
+// Height added under the mouse, in grid units; a press pushes the water down.
+const float pressImpulse = -0.03f;
+const float dragImpulse = -0.008f;
+}
+
 // Triggered by pressing a key
 void MainView::keyPressEvent(QKeyEvent *ev)
 {
     switch(ev->key()) {
     case 'A': qDebug() << "A pressed"; break;
+    case 'S': toggleStats(); break;
+    case Qt::Key_Space: toggleAnimation(); break;
+    case Qt::Key_Plus: setGrid(gridResolution * 2, gridStrips); break;
+    case Qt::Key_Minus: setGrid(gridResolution / 2, gridStrips); break;
     default:
         // ev->key() is an integer. For alpha numeric characters keys it equivalent with the char value ('A' == 65, '1' == 49)
         // Alternatively, you could use Qt Key enums, see http://doc.qt.io/qt-5/qt.html#Key-enum
         qDebug() << ev->key() << "pressed";
         break;
     }
-
-    // Used to update the screen after changes
-    update();
 }
 
 // Triggered by releasing a key
@@ -27,8 +34,6 @@ void MainView::keyReleaseEvent(QKeyEvent *ev)
         qDebug() << ev->key() << "released";
         break;
     }
-
-    update();
 }
 
 // Triggered by clicking two subsequent times on any mouse button
@@ -36,16 +41,15 @@ void MainView::keyReleaseEvent(QKeyEvent *ev)
 void MainView::mouseDoubleClickEvent(QMouseEvent *ev)
 {
     qDebug() << "Mouse double clicked:" << ev->button();
-
-    update();
 }
 
 // Triggered when moving the mouse inside the window (only when the mouse is clicked!)
 void MainView::mouseMoveEvent(QMouseEvent *ev)
 {
-    qDebug() << "x" << ev->x() << "y" << ev->y();
-
-    update();
+    // Dragging over the water leaves a trail of ripples.
+    QVector2D point;
+    if (ripplesEnabled && pickWaterPlane(ev->pos(), point))
+        addImpulse(point.x(), point.y(), dragImpulse);
 }
 
 // Triggered when pressing any mouse button
@@ -53,7 +57,10 @@ void MainView::mousePressEvent(QMouseEvent *ev)
 {
     qDebug() << "Mouse button pressed:" << ev->button();
 
-    update();
+    QVector2D point;
+    if (ripplesEnabled && pickWaterPlane(ev->pos(), point))
+        addImpulse(point.x(), point.y(), pressImpulse);
+
     // Do not remove the line below, clicking must focus on this widget!
     this->setFocus();
 }
@@ -62,8 +69,6 @@ void MainView::mousePressEvent(QMouseEvent *ev)
 void MainView::mouseReleaseEvent(QMouseEvent *ev)
 {
     qDebug() << "Mouse button released" << ev->button();
-
-    update();
 }
 
 // Triggered when clicking scrolling with the scroll wheel on the mouse
@@ -71,6 +76,4 @@ void MainView::wheelEvent(QWheelEvent *ev)
 {
     // Implement something
     qDebug() << "Mouse wheel:" << ev->delta();
-
-    update();
 }
@@ -1,5 +1,7 @@
 #include "mainview.h"
 
+#include <QFile>
+
 QVector<quint8> MainView::imageToBytes(QImage image) {
     // needed since (0,0) is bottom left in OpenGL
     QImage im = image.mirrored();
@@ -27,3 +29,12 @@ QVector<quint8> MainView::imageToBytes(QImage image) {
     }
     return pixelData;
 }
+
+QByteArray MainView::readFile(QString file) {
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        qDebug() << ":: Could not open" << file;
+        return QByteArray();
+    }
+    return in.readAll();
+}